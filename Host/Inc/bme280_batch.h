@@ -0,0 +1,106 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+/**
+ * @brief The host library compensating the uncompensated ADC data returned by the <i>Raw</i> command or streamed with
+ *   the <i>Stream Raw</i> command in bulk, using the calibration data returned by the <i>Calib</i> command. The results
+ *   match the firmware <i>BME280_Compensate</i> function ones bit for bit.
+ * @note The library does not depend on the firmware sources.
+ */
+
+#ifndef BME_READER_BME280_BATCH_H
+#define BME_READER_BME280_BATCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Defines the length of the raw calibration data block returned by the <i>Calib</i> command.
+ */
+#define BME280_BATCH_CALIBRATION_LENGTH 42
+
+/**
+ * @brief Defines the number of samples the structure-of-arrays compensation processes at once. Bounds the stack usage
+ *   of the intermediate values.
+ */
+#define BME280_BATCH_BLOCK_LENGTH 256
+
+/**
+ * @brief The compensation engines enumeration. Matches the firmware <i>BME280_Compensation</i> enumeration.
+ * @note The floating-point engine results match the firmware ones only if both are built with the same floating-point
+ *   contraction and precision settings, while the integer engines match on any platform.
+ */
+typedef enum BME280Batch_Engine
+{
+  BME280_BATCH_ENGINE_FLOAT,
+  BME280_BATCH_ENGINE_INT32,
+  BME280_BATCH_ENGINE_INT64
+} BME280Batch_Engine;
+
+/**
+ * @brief The decoded calibration data.
+ */
+typedef struct BME280Batch_Calibration
+{
+  int32_t digT[3];
+  int32_t digP[9];
+  int32_t digH[6];
+  float t[3];
+  float p[9];
+  float h[6];
+} BME280Batch_Calibration;
+
+/**
+ * @brief The uncompensated ADC data of a sample.
+ */
+typedef struct BME280Batch_RawData
+{
+  int32_t pressure;
+  int32_t temperature;
+  int32_t humidity;
+} BME280Batch_RawData;
+
+/**
+ * @brief The compensated sample: the temperature in degC, the pressure in Pa, and the relative humidity in %.
+ */
+typedef struct BME280Batch_Measurement
+{
+  float temperature;
+  float pressure;
+  float humidity;
+} BME280Batch_Measurement;
+
+/**
+ * @brief The uncompensated ADC data of the samples in the structure-of-arrays layout.
+ */
+typedef struct BME280Batch_RawArrays
+{
+  const int32_t *pressure;
+  const int32_t *temperature;
+  const int32_t *humidity;
+} BME280Batch_RawArrays;
+
+/**
+ * @brief The output arrays of the compensated samples in the structure-of-arrays layout.
+ */
+typedef struct BME280Batch_MeasurementArrays
+{
+  float *temperature;
+  float *pressure;
+  float *humidity;
+} BME280Batch_MeasurementArrays;
+
+void BME280Batch_ParseCalibration(const uint8_t *data, BME280Batch_Calibration *calibration);
+
+void BME280Batch_Compensate(const BME280Batch_Calibration *calibration, BME280Batch_Engine engine,
+  const BME280Batch_RawData *rawData, BME280Batch_Measurement *measurements, size_t count);
+
+void BME280Batch_CompensateArrays(const BME280Batch_Calibration *calibration, BME280Batch_Engine engine,
+  const BME280Batch_RawArrays *rawData, const BME280Batch_MeasurementArrays *measurements, size_t count);
+
+#endif //BME_READER_BME280_BATCH_H
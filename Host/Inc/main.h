@@ -0,0 +1,263 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+/**
+ * @brief The host replacement of the <i>Core/Inc/main.h</i> header.
+ * @note Provides the subset of the CMSIS and LL driver definitions used by the <i>Project</i> sources, so that they can
+ *   be compiled for the host machine. The peripherals are backed by the simulator (see <i>sim.h</i>).
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define __IO volatile
+#define SET_BIT(REG, BIT)     ((REG) |= (BIT))
+#define CLEAR_BIT(REG, BIT)   ((REG) &= ~(BIT))
+#define READ_BIT(REG, BIT)    ((REG) & (BIT))
+#define WRITE_REG(REG, VAL)   ((REG) = (VAL))
+#define READ_REG(REG)         ((REG))
+
+/* I2C peripheral registers. */
+typedef struct
+{
+  __IO uint32_t CR1;
+  __IO uint32_t CR2;
+  __IO uint32_t OAR1;
+  __IO uint32_t OAR2;
+  __IO uint32_t DR;
+  __IO uint32_t SR1;
+  __IO uint32_t SR2;
+  __IO uint32_t CCR;
+  __IO uint32_t TRISE;
+  __IO uint32_t FLTR;
+} I2C_TypeDef;
+
+#define I2C_CR1_PE        (0x1UL << 0)
+#define I2C_CR1_START     (0x1UL << 8)
+#define I2C_CR1_STOP      (0x1UL << 9)
+#define I2C_CR1_ACK       (0x1UL << 10)
+#define I2C_CR1_SWRST     (0x1UL << 15)
+#define I2C_CR2_ITERREN   (0x1UL << 8)
+#define I2C_CR2_ITEVTEN   (0x1UL << 9)
+#define I2C_CR2_ITBUFEN   (0x1UL << 10)
+#define I2C_CR2_DMAEN     (0x1UL << 11)
+#define I2C_CR2_LAST      (0x1UL << 12)
+#define I2C_SR1_SB        (0x1UL << 0)
+#define I2C_SR1_ADDR      (0x1UL << 1)
+#define I2C_SR1_BTF       (0x1UL << 2)
+#define I2C_SR1_RXNE      (0x1UL << 6)
+#define I2C_SR1_TXE       (0x1UL << 7)
+#define I2C_SR1_BERR      (0x1UL << 8)
+#define I2C_SR1_ARLO      (0x1UL << 9)
+#define I2C_SR1_AF        (0x1UL << 10)
+#define I2C_SR2_BUSY      (0x1UL << 1)
+
+#define LL_I2C_ACK        I2C_CR1_ACK
+#define LL_I2C_NACK       0x00000000U
+
+/* DMA stream registers. The memory address is kept as a host pointer. */
+typedef struct
+{
+  __IO uint32_t CR;
+  __IO uint32_t NDTR;
+  uintptr_t PAR;
+  uintptr_t M0AR;
+} DMA_Stream_TypeDef;
+
+/* DMA controller registers. */
+typedef struct
+{
+  __IO uint32_t LISR;
+  __IO uint32_t HISR;
+  DMA_Stream_TypeDef Stream[8];
+} DMA_TypeDef;
+
+#define DMA_SxCR_EN       (0x1UL << 0)
+#define DMA_SxCR_TEIE     (0x1UL << 2)
+#define DMA_SxCR_TCIE     (0x1UL << 4)
+#define DMA_LISR_TEIF0    (0x1UL << 3)
+#define DMA_LISR_TCIF0    (0x1UL << 5)
+
+#define LL_DMA_STREAM_0                   0x00000000U
+#define LL_DMA_CHANNEL_1                  (0x1UL << 25)
+#define LL_DMA_DIRECTION_PERIPH_TO_MEMORY 0x00000000U
+#define LL_DMA_MODE_NORMAL                0x00000000U
+#define LL_DMA_PERIPH_NOINCREMENT         0x00000000U
+#define LL_DMA_MEMORY_INCREMENT           (0x1UL << 10)
+#define LL_DMA_PDATAALIGN_BYTE            0x00000000U
+#define LL_DMA_MDATAALIGN_BYTE            0x00000000U
+#define LL_DMA_PRIORITY_HIGH              (0x2UL << 16)
+
+#define LL_AHB1_GRP1_PERIPH_DMA1          (0x1UL << 21)
+
+/* GPIO peripheral registers. */
+typedef struct
+{
+  __IO uint32_t MODER;
+  __IO uint32_t IDR;
+  __IO uint32_t ODR;
+} GPIO_TypeDef;
+
+#define LL_GPIO_PIN_8     (0x1UL << 8)
+#define LL_GPIO_PIN_9     (0x1UL << 9)
+#define LL_GPIO_PIN_13    (0x1UL << 13)
+#define LL_GPIO_MODE_INPUT      0x0U
+#define LL_GPIO_MODE_OUTPUT     0x1U
+#define LL_GPIO_MODE_ALTERNATE  0x2U
+
+/* RTC peripheral registers. */
+typedef struct
+{
+  __IO uint32_t BKP[20];
+} RTC_TypeDef;
+
+#define LL_RTC_BKP_DR0    0x0U
+
+#define LL_APB1_GRP1_PERIPH_PWR (0x1UL << 28)
+
+/* Flash programming HAL definitions. The flash addresses are kept as host pointers. */
+typedef enum
+{
+  HAL_OK = 0x00U,
+  HAL_ERROR = 0x01U,
+  HAL_BUSY = 0x02U,
+  HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+typedef struct
+{
+  uint32_t TypeErase;
+  uint32_t Banks;
+  uint32_t Sector;
+  uint32_t NbSectors;
+  uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEERASE_SECTORS 0x00000000U
+#define FLASH_VOLTAGE_RANGE_3   0x00000002U
+#define FLASH_TYPEPROGRAM_WORD  0x00000002U
+#define FLASH_SECTOR_6          6U
+#define FLASH_SECTOR_7          7U
+
+extern I2C_TypeDef Sim_I2c1;
+extern DMA_TypeDef Sim_Dma1;
+extern GPIO_TypeDef Sim_GpioB;
+extern GPIO_TypeDef Sim_GpioC;
+extern RTC_TypeDef Sim_Rtc;
+
+#define I2C1 (&Sim_I2c1)
+#define DMA1 (&Sim_Dma1)
+#define GPIOB (&Sim_GpioB)
+#define GPIOC (&Sim_GpioC)
+#define RTC (&Sim_Rtc)
+
+void LL_I2C_Enable(I2C_TypeDef *I2Cx);
+void LL_I2C_Disable(I2C_TypeDef *I2Cx);
+void LL_I2C_EnableReset(I2C_TypeDef *I2Cx);
+void LL_I2C_DisableReset(I2C_TypeDef *I2Cx);
+void LL_I2C_GenerateStartCondition(I2C_TypeDef *I2Cx);
+void LL_I2C_GenerateStopCondition(I2C_TypeDef *I2Cx);
+void LL_I2C_AcknowledgeNextData(I2C_TypeDef *I2Cx, uint32_t TypeAcknowledge);
+void LL_I2C_TransmitData8(I2C_TypeDef *I2Cx, uint8_t Data);
+uint8_t LL_I2C_ReceiveData8(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_SB(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_ADDR(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_BTF(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_RXNE(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_AF(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_BUSY(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_TXE(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_BERR(I2C_TypeDef *I2Cx);
+uint32_t LL_I2C_IsActiveFlag_ARLO(I2C_TypeDef *I2Cx);
+void LL_I2C_ClearFlag_ADDR(I2C_TypeDef *I2Cx);
+void LL_I2C_ClearFlag_AF(I2C_TypeDef *I2Cx);
+void LL_I2C_ClearFlag_BERR(I2C_TypeDef *I2Cx);
+void LL_I2C_ClearFlag_ARLO(I2C_TypeDef *I2Cx);
+void LL_I2C_EnableIT_EVT(I2C_TypeDef *I2Cx);
+void LL_I2C_EnableIT_BUF(I2C_TypeDef *I2Cx);
+void LL_I2C_DisableIT_BUF(I2C_TypeDef *I2Cx);
+void LL_I2C_EnableIT_ERR(I2C_TypeDef *I2Cx);
+void LL_I2C_EnableDMAReq_RX(I2C_TypeDef *I2Cx);
+void LL_I2C_DisableDMAReq_RX(I2C_TypeDef *I2Cx);
+void LL_I2C_EnableLastDMA(I2C_TypeDef *I2Cx);
+void LL_I2C_DisableLastDMA(I2C_TypeDef *I2Cx);
+uintptr_t LL_I2C_DMA_GetRegAddr(I2C_TypeDef *I2Cx);
+
+void LL_DMA_ConfigTransfer(DMA_TypeDef *DMAx, uint32_t Stream, uint32_t Configuration);
+void LL_DMA_SetChannelSelection(DMA_TypeDef *DMAx, uint32_t Stream, uint32_t Channel);
+void LL_DMA_SetPeriphAddress(DMA_TypeDef *DMAx, uint32_t Stream, uintptr_t PeriphAddress);
+void LL_DMA_SetMemoryAddress(DMA_TypeDef *DMAx, uint32_t Stream, uintptr_t MemoryAddress);
+void LL_DMA_SetDataLength(DMA_TypeDef *DMAx, uint32_t Stream, uint32_t NbData);
+void LL_DMA_EnableStream(DMA_TypeDef *DMAx, uint32_t Stream);
+void LL_DMA_DisableStream(DMA_TypeDef *DMAx, uint32_t Stream);
+void LL_DMA_EnableIT_TC(DMA_TypeDef *DMAx, uint32_t Stream);
+void LL_DMA_EnableIT_TE(DMA_TypeDef *DMAx, uint32_t Stream);
+uint32_t LL_DMA_IsActiveFlag_TC0(DMA_TypeDef *DMAx);
+uint32_t LL_DMA_IsActiveFlag_TE0(DMA_TypeDef *DMAx);
+void LL_DMA_ClearFlag_TC0(DMA_TypeDef *DMAx);
+void LL_DMA_ClearFlag_TE0(DMA_TypeDef *DMAx);
+
+void LL_GPIO_SetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask);
+void LL_GPIO_ResetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask);
+uint32_t LL_GPIO_IsInputPinSet(GPIO_TypeDef *GPIOx, uint32_t PinMask);
+void LL_GPIO_SetPinMode(GPIO_TypeDef *GPIOx, uint32_t Pin, uint32_t Mode);
+
+void LL_RTC_BAK_SetRegister(RTC_TypeDef *RTCx, uint32_t BackupRegister, uint32_t Data);
+uint32_t LL_RTC_BAK_GetRegister(RTC_TypeDef *RTCx, uint32_t BackupRegister);
+void LL_APB1_GRP1_EnableClock(uint32_t Periphs);
+void LL_AHB1_GRP1_EnableClock(uint32_t Periphs);
+void LL_PWR_EnableBkUpAccess(void);
+void LL_RCC_EnableRTC(void);
+
+uint32_t LL_GetUID_Word0(void);
+uint32_t LL_GetUID_Word1(void);
+uint32_t LL_GetUID_Word2(void);
+
+void LL_mDelay(uint32_t Delay);
+uint32_t HAL_GetTick(void);
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+void __set_MSP(uint32_t topOfMainStack);
+#define __DMB() __sync_synchronize()
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t priMask);
+void __disable_irq(void);
+void __enable_irq(void);
+void __WFI(void);
+
+/* Interrupt numbers. */
+typedef enum
+{
+  DMA1_Stream0_IRQn = 11,
+  I2C1_EV_IRQn = 31,
+  I2C1_ER_IRQn = 32
+} IRQn_Type;
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_SystemReset(void) __attribute__((__noreturn__));
+
+void Error_Handler(void);
+
+#define LED_Pin LL_GPIO_PIN_13
+#define LED_GPIO_Port GPIOC
+#define SCL_Pin LL_GPIO_PIN_8
+#define SCL_GPIO_Port GPIOB
+#define SDA_Pin LL_GPIO_PIN_9
+#define SDA_GPIO_Port GPIOB
+
+void MX_GPIO_Init(void);
+void MX_I2C1_Init(void);
+
+#endif /* __MAIN_H */
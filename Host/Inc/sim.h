@@ -0,0 +1,117 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_SIM_H
+#define BME_READER_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "main.h"
+
+/**
+ * @brief Defines the simulated I2C bit time in microseconds (400 kHz bus clock).
+ */
+#define SIM_I2C_BIT_TIME_US 2.5
+
+/**
+ * @brief Defines the simulated flash word programming time in microseconds (x32 parallelism).
+ */
+#define SIM_FLASH_PROGRAM_TIME_US 16.0
+
+/**
+ * @brief Defines the simulated 128 KB flash sector erase time in microseconds (x32 parallelism).
+ */
+#define SIM_FLASH_ERASE_TIME_US 1000000.0
+
+/**
+ * @brief Defines the simulated BME280 I2C address.
+ */
+#define SIM_BME280_ADDRESS 0x76
+
+/**
+ * @brief The simulated BME280 raw ADC values structure.
+ */
+typedef struct Sim_Bme280Adc
+{
+  uint32_t pressure;
+  uint32_t temperature;
+  uint32_t humidity;
+} Sim_Bme280Adc;
+
+/**
+ * @brief The simulated BME280 noise structure. Every conversion adds the normally distributed noise to the raw ADC
+ *   values. Its RMS value in the ADC counts is <i>sqrt(white^2 / N + floor^2)</i> for the oversampling factor <i>N</i>.
+ */
+typedef struct Sim_Bme280Noise
+{
+  float pressure;
+  float temperature;
+  float humidity;
+  float pressureFloor;
+  float temperatureFloor;
+  float humidityFloor;
+} Sim_Bme280Noise;
+
+/**
+ * @brief The simulated BME280 trimming parameters as they are stored in the device registers.
+ */
+typedef struct Sim_Bme280Calibration
+{
+  uint16_t t1;
+  int16_t t2;
+  int16_t t3;
+  uint16_t p1;
+  int16_t p2;
+  int16_t p3;
+  int16_t p4;
+  int16_t p5;
+  int16_t p6;
+  int16_t p7;
+  int16_t p8;
+  int16_t p9;
+  uint8_t h1;
+  int16_t h2;
+  uint8_t h3;
+  int16_t h4;
+  int16_t h5;
+  int8_t h6;
+} Sim_Bme280Calibration;
+
+extern const Sim_Bme280Calibration Sim_Bme280DefaultCalibration;
+
+uint64_t Sim_GetMicros();
+void Sim_AdvanceMicros(double micros);
+
+void Sim_I2cSetDevicePresent(bool isPresent);
+uint32_t Sim_I2cGetTransferredBytes();
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+void DMA1_Stream0_IRQHandler(void);
+
+uint32_t Sim_FlashGetProgramCount();
+uint32_t Sim_FlashGetEraseCount();
+void Sim_FlashSetProgramLimit(uint32_t count);
+
+void Sim_Bme280PowerOn(const Sim_Bme280Calibration *calibration);
+void Sim_Bme280SetAdc(const Sim_Bme280Adc *adc);
+void Sim_Bme280SetNoise(const Sim_Bme280Noise *noise);
+uint8_t Sim_Bme280GetRegister(uint8_t address);
+uint64_t Sim_Bme280GetActiveMicros();
+uint32_t Sim_Bme280GetConversionCount();
+bool Sim_Bme280Start(uint8_t address, bool read);
+void Sim_Bme280Write(uint8_t byte);
+uint8_t Sim_Bme280Read();
+void Sim_Bme280Stop();
+
+void Sim_CdcService();
+void Sim_CdcSetOutput(void (*output)(const char *data, uint16_t length));
+uint32_t Sim_CdcGetPacketCount();
+void Sim_CdcBusReset();
+
+#endif //BME_READER_SIM_H
@@ -0,0 +1,34 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+/**
+ * @brief The host replacement of the <i>USB_DEVICE/App/usbd_cdc_if.h</i> header.
+ * @note The CDC interface is backed by the simulator (see <i>sim.h</i>).
+ */
+
+#ifndef __USBD_CDC_IF_H__
+#define __USBD_CDC_IF_H__
+
+#include <stdint.h>
+
+#define APP_RX_DATA_SIZE  128
+#define APP_TX_DATA_SIZE  128
+
+#define CDC_DATA_FS_MAX_PACKET_SIZE 64U
+
+typedef enum
+{
+  USBD_OK = 0U,
+  USBD_BUSY,
+  USBD_EMEM,
+  USBD_FAIL,
+} USBD_StatusTypeDef;
+
+uint8_t CDC_Transmit_FS(uint8_t *Buf, uint16_t Len);
+
+#endif /* __USBD_CDC_IF_H__ */
@@ -0,0 +1,2044 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "sim.h"
+#include "project.h"
+#include "bme280_batch.h"
+
+/**
+ * @brief Defines the number of distinct raw samples used by the benchmarks.
+ */
+#define BENCH_SAMPLES 4096
+
+/**
+ * @brief Defines the number of passes over the samples for the timing measurements.
+ */
+#define BENCH_PASSES 200
+
+/**
+ * @brief Defines the number of commands sent by the pipelining benchmarks.
+ */
+#define BENCH_COMMANDS 2000
+
+/**
+ * @brief Defines the command sent by the pipelining benchmarks.
+ */
+#define BENCH_COMMAND "Measure All\n"
+
+/**
+ * @brief Defines the number of commands sent by the on-demand measurement benchmarks.
+ */
+#define BENCH_ON_DEMAND_REQUESTS 20
+
+/**
+ * @brief Defines the number of USB frames (milliseconds) between the commands sent by the on-demand measurement
+ *   benchmarks.
+ */
+#define BENCH_ON_DEMAND_GAP 250
+
+/**
+ * @brief Defines the duration of every noise trace phase in USB frames (milliseconds). The noise is measured over the
+ *   second half of the phase, after the adaptive oversampling has settled.
+ */
+#define BENCH_NOISE_PHASE_LENGTH 30000
+
+/**
+ * @brief Defines the number of USB frames (milliseconds) the noise trace pressure ADC value drifts by one count in.
+ */
+#define BENCH_NOISE_DRIFT_PERIOD 250
+
+/**
+ * @brief Defines the main loop iteration time in microseconds simulated by the sensor initialization benchmark, so
+ *   that its steps are not aligned to the USB frames.
+ */
+#define BENCH_LOOP_TIME_US 50
+
+/**
+ * @brief Defines the number of the setting changes saved by the settings store benchmark.
+ */
+#define BENCH_STORE_WRITES 100000
+
+/**
+ * @brief Defines the number of the flash words programmed by the compactions interrupted by the store power loss
+ *   benchmark, one compaction per number.
+ */
+#define BENCH_STORE_POWER_LOSSES 40
+
+/**
+ * @brief Defines the number of the signals preempting the main context by every latest sample snapshot benchmark.
+ */
+#define BENCH_SNAPSHOT_SIGNALS 20000
+
+/**
+ * @brief Defines the interval between the signals preempting the main context in microseconds.
+ */
+#define BENCH_SNAPSHOT_SIGNAL_INTERVAL 20
+
+/**
+ * @brief Defines the number of the USB bus resets simulated with a response in flight.
+ */
+#define BENCH_BUS_RESETS 10
+
+/**
+ * @brief Defines the number of random messages checked by the tokenizer robustness pass.
+ */
+#define BENCH_RANDOM_MESSAGES 200000
+
+/**
+ * @brief Defines the number of random values checked by the number formatting robustness pass.
+ */
+#define BENCH_RANDOM_VALUES 1000000
+
+/**
+ * @brief Defines the size of the hash table used by the command lookup benchmarks. Must be a power of two.
+ */
+#define BENCH_HASH_TABLE_SIZE 256
+
+/**
+ * @brief Defines the 100-command table used by the command lookup benchmarks, in the <i>COMMAND_TABLE</i> format
+ *   without the identifier and callback columns.
+ */
+#define BENCH_COMMAND_TABLE(X) \
+  X(Abort, 'a', 't') \
+  X(Accel, 'a', 'l') \
+  X(Adc, 'a', 'c') \
+  X(Address, 'a', 's') \
+  X(Alarm, 'a', 'm') \
+  X(Align, 'a', 'n') \
+  X(Append, 'a', 'd') \
+  X(Apply, 'a', 'y') \
+  X(Arm, 'a', 'm') \
+  X(Attach, 'a', 'h') \
+  X(Audio, 'a', 'o') \
+  X(Auto, 'a', 'o') \
+  X(Backup, 'b', 'p') \
+  X(Band, 'b', 'd') \
+  X(Beep, 'b', 'p') \
+  X(Bias, 'b', 's') \
+  X(Blink, 'b', 'k') \
+  X(Boot, 'b', 't') \
+  X(Bound, 'b', 'd') \
+  X(Buffer, 'b', 'r') \
+  X(Burst, 'b', 't') \
+  X(Bus, 'b', 's') \
+  X(Cache, 'c', 'e') \
+  X(Calib, 'c', 'b') \
+  X(Cancel, 'c', 'l') \
+  X(Capture, 'c', 'e') \
+  X(Channel, 'c', 'l') \
+  X(Charge, 'c', 'e') \
+  X(Check, 'c', 'k') \
+  X(Clear, 'c', 'r') \
+  X(Commit, 'c', 't') \
+  X(Config, 'c', 'g') \
+  X(Connect, 'c', 't') \
+  X(Copy, 'c', 'y') \
+  X(Count, 'c', 't') \
+  X(Crc, 'c', 'c') \
+  X(Date, 'd', 'e') \
+  X(Debug, 'd', 'g') \
+  X(Delete, 'd', 'e') \
+  X(Detach, 'd', 'h') \
+  X(Detect, 'd', 't') \
+  X(Dump, 'd', 'p') \
+  X(Enable, 'e', 'e') \
+  X(Erase, 'e', 'e') \
+  X(Event, 'e', 't') \
+  X(Export, 'e', 't') \
+  X(Fetch, 'f', 'h') \
+  X(Format, 'f', 't') \
+  X(Freeze, 'f', 'e') \
+  X(Gain, 'g', 'n') \
+  X(Gate, 'g', 'e') \
+  X(Get, 'g', 't') \
+  X(Group, 'g', 'p') \
+  X(Halt, 'h', 't') \
+  X(Help, 'h', 'p') \
+  X(History, 'h', 'y') \
+  X(Hold, 'h', 'd') \
+  X(Humid, 'h', 'd') \
+  X(Id, 'i', 'd') \
+  X(Import, 'i', 't') \
+  X(Info, 'i', 'o') \
+  X(Init, 'i', 't') \
+  X(Input, 'i', 't') \
+  X(Join, 'j', 'n') \
+  X(Key, 'k', 'y') \
+  X(Latch, 'l', 'h') \
+  X(Launch, 'l', 'h') \
+  X(Limit, 'l', 't') \
+  X(Link, 'l', 'k') \
+  X(List, 'l', 't') \
+  X(Load, 'l', 'd') \
+  X(Log, 'l', 'g') \
+  X(Loop, 'l', 'p') \
+  X(Mark, 'm', 'k') \
+  X(Memory, 'm', 'y') \
+  X(Merge, 'm', 'e') \
+  X(Mode, 'm', 'e') \
+  X(Monitor, 'm', 'r') \
+  X(Mount, 'm', 't') \
+  X(Name, 'n', 'e') \
+  X(Noise, 'n', 'e') \
+  X(Notify, 'n', 'y') \
+  X(Open, 'o', 'n') \
+  X(Pause, 'p', 'e') \
+  X(Peek, 'p', 'k') \
+  X(Ping, 'p', 'g') \
+  X(Pin, 'p', 'n') \
+  X(Power, 'p', 'r') \
+  X(Pressure, 'p', 'e') \
+  X(Profile, 'p', 'e') \
+  X(Raw, 'r', 'w') \
+  X(Read, 'r', 'd') \
+  X(Record, 'r', 'd') \
+  X(Reset, 'r', 't') \
+  X(Resume, 'r', 'e') \
+  X(Rate, 'r', 'e') \
+  X(Ring, 'r', 'g') \
+  X(Run, 'r', 'n') \
+  X(Sample, 's', 'e') \
+  X(Scan, 's', 'n')
+
+/**
+ * @brief Expands a <i>BENCH_COMMAND_TABLE</i> entry to its command identifier enumeration value.
+ */
+#define BENCH_COMMAND_ID(name, first, last) BENCH_COMMAND_##name,
+
+/**
+ * @brief Expands a <i>BENCH_COMMAND_TABLE</i> entry to its command name string.
+ */
+#define BENCH_COMMAND_NAME(name, first, last) #name,
+
+/**
+ * @brief Expands a <i>BENCH_COMMAND_TABLE</i> entry to a hash table entry.
+ */
+#define BENCH_COMMAND_HASH_ENTRY(name, first, last) \
+  [COMMAND_HASH(first, last, sizeof(#name) - 1, BENCH_HASH_TABLE_SIZE)] = BENCH_COMMAND_##name + 1,
+
+/**
+ * @brief Expands a <i>BENCH_COMMAND_TABLE</i> entry to a case label of its hash.
+ */
+#define BENCH_COMMAND_HASH_CASE(name, first, last) \
+  case COMMAND_HASH(first, last, sizeof(#name) - 1, BENCH_HASH_TABLE_SIZE):
+
+/**
+ * @brief The command messages parsed by the tokenizer benchmarks.
+ */
+static const char *const Bench_Messages[] = {
+  "Measure All",
+  "measure t",
+  "Id",
+  "  Reset   Bootloader  ",
+  "Config Set\tFilter 16",
+  "Unknown command with too many tokens",
+  "",
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKL"
+};
+
+/**
+ * @brief The command descriptor structure used before the tokenizer has been introduced. Kept for comparison.
+ */
+typedef struct Bench_LegacyDescriptor
+{
+  char name[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+  char param[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+  char value[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+} Bench_LegacyDescriptor;
+
+/**
+ * @brief The command identifiers of the command lookup benchmarks.
+ */
+typedef enum Bench_CommandId
+{
+  BENCH_COMMAND_TABLE(BENCH_COMMAND_ID)
+  BENCH_COMMAND_COUNT
+} Bench_CommandId;
+
+/**
+ * @brief The climatic data computed with the double-precision reference formulas.
+ */
+typedef struct Bench_Reference
+{
+  double temperature;
+  double pressure;
+  double humidity;
+} Bench_Reference;
+
+/**
+ * @brief The noise trace phase structure.
+ */
+typedef struct Bench_NoisePhase
+{
+  const char *name;
+  Sim_Bme280Noise noise;
+} Bench_NoisePhase;
+
+/**
+ * @brief The compensation function type.
+ */
+typedef void (*Bench_CompensationFunction)(const BME280_TrimmingParams *params, const BME280_RawData *rawData,
+  uint8_t channels, BME280_Measurement *measurement);
+
+static BME280_TrimmingParams Bench_Params;
+static float Bench_RawParams[18];
+static BME280_RawData Bench_RawData[BENCH_SAMPLES];
+static Bench_Reference Bench_References[BENCH_SAMPLES];
+
+/**
+ * @brief The simulated noise trace: the noise levels of a typical device in the ADC counts (about 3.3 Pa, 0.005 degC,
+ *   and 0.02 %RH without oversampling, and 1.3 Pa with the x16 one), and the three times higher white noise caused by
+ *   an airflow.
+ */
+static const Bench_NoisePhase Bench_NoiseTrace[] = {
+  {"Quiet", {.pressure = 17.0F, .temperature = 16.0F, .humidity = 4.0F, .pressureFloor = 5.5F,
+    .temperatureFloor = 2.0F, .humidityFloor = 1.0F}},
+  {"Airflow", {.pressure = 51.0F, .temperature = 48.0F, .humidity = 12.0F, .pressureFloor = 5.5F,
+    .temperatureFloor = 2.0F, .humidityFloor = 1.0F}},
+  {"Quiet again", {.pressure = 17.0F, .temperature = 16.0F, .humidity = 4.0F, .pressureFloor = 5.5F,
+    .temperatureFloor = 2.0F, .humidityFloor = 1.0F}}
+};
+
+static const char *const Bench_CommandNames[BENCH_COMMAND_COUNT] = {BENCH_COMMAND_TABLE(BENCH_COMMAND_NAME)};
+static const uint8_t Bench_CommandHashTable[BENCH_HASH_TABLE_SIZE] = {BENCH_COMMAND_TABLE(BENCH_COMMAND_HASH_ENTRY)};
+
+/**
+ * @brief Never called. Fails the compilation if any of the benchmark command name hashes collide.
+ */
+__unused static inline void Bench_CheckHashCollisions(uint32_t hash)
+{
+  switch (hash)
+  {
+    BENCH_COMMAND_TABLE(BENCH_COMMAND_HASH_CASE)
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief A sink preventing the benchmarked computations from being optimized out.
+ */
+static volatile float Bench_Sink;
+
+/**
+ * @brief The number of responses received by the pipelining benchmarks.
+ */
+static uint32_t Bench_Responses;
+
+/**
+ * @brief The number of response bytes received by the pipelining benchmarks.
+ */
+static uint32_t Bench_ResponseBytes;
+
+/**
+ * @brief The number of invalid or failed responses received by the pipelining benchmarks.
+ */
+static uint32_t Bench_ResponseErrors;
+
+/**
+ * @brief The flag indicating if the pipelining benchmarks receive the binary response frames.
+ */
+static bool Bench_IsBinary;
+
+/**
+ * @brief The buffer assembling the response being received by the pipelining benchmarks.
+ */
+static uint8_t Bench_Response[256];
+
+/**
+ * @brief The length of the response assembled in the <i>Bench_Response</i> buffer.
+ */
+static uint16_t Bench_ResponseLength;
+
+/**
+ * @brief The values of the last streamed sample: the text message part following the timestamp, or the binary frame
+ *   payload following the timestamp.
+ */
+static uint8_t Bench_StreamedValues[sizeof(Bench_Response)];
+
+/**
+ * @brief The length of the values in the <i>Bench_StreamedValues</i> buffer.
+ */
+static uint16_t Bench_StreamedValuesLength;
+
+/**
+ * @brief The number of the streamed samples repeating the values of the previous one.
+ */
+static uint32_t Bench_StreamRepeats;
+
+/**
+ * @brief Gets the current timestamp in CPU cycles (time stamp counter ticks) or nanoseconds if cycles are unavailable.
+ */
+static uint64_t Bench_GetCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+#endif
+}
+
+/**
+ * @brief Gets the current monotonic timestamp in nanoseconds.
+ */
+static uint64_t Bench_GetNanos()
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+/**
+ * @brief Gets a pseudo-random value in the specified range.
+ */
+static int32_t Bench_GetRandom(int32_t min, int32_t max)
+{
+  static uint32_t state = 12345;
+  state = state * 1664525 + 1013904223;
+  return min + (int32_t) ((state >> 8) % (uint32_t) (max - min + 1));
+}
+
+/**
+ * @brief Computes the climatic data using the double-precision formulas from the Bosch BME280 datasheet, section 8.1.
+ */
+static void Bench_Compensate(const Sim_Bme280Calibration *c, const BME280_RawData *rawData, Bench_Reference *ref)
+{
+  double var1 = ((double) rawData->temperature / 16384.0 - (double) c->t1 / 1024.0) * (double) c->t2;
+  double var2 = ((double) rawData->temperature / 131072.0 - (double) c->t1 / 8192.0);
+  var2 = var2 * var2 * (double) c->t3;
+  double tFine = var1 + var2;
+  ref->temperature = tFine / 5120.0;
+
+  var1 = tFine / 2.0 - 64000.0;
+  var2 = var1 * var1 * (double) c->p6 / 32768.0;
+  var2 = var2 + var1 * (double) c->p5 * 2.0;
+  var2 = var2 / 4.0 + (double) c->p4 * 65536.0;
+  var1 = ((double) c->p3 * var1 * var1 / 524288.0 + (double) c->p2 * var1) / 524288.0;
+  var1 = (1.0 + var1 / 32768.0) * (double) c->p1;
+  double p = 1048576.0 - (double) rawData->pressure;
+  p = (p - var2 / 4096.0) * 6250.0 / var1;
+  var1 = (double) c->p9 * p * p / 2147483648.0;
+  var2 = p * (double) c->p8 / 32768.0;
+  ref->pressure = p + (var1 + var2 + (double) c->p7) / 16.0;
+
+  double h = tFine - 76800.0;
+  h = ((double) rawData->humidity - ((double) c->h4 * 64.0 + (double) c->h5 / 16384.0 * h)) *
+    ((double) c->h2 / 65536.0 * (1.0 + (double) c->h6 / 67108864.0 * h * (1.0 + (double) c->h3 / 67108864.0 * h)));
+  h = h * (1.0 - (double) c->h1 * h / 524288.0);
+  ref->humidity = h > 100.0 ? 100.0 : h < 0.0 ? 0.0 : h;
+}
+
+/**
+ * @brief Computes the climatic data using the single-precision formulas applied to the raw trimming parameter values,
+ *   as it was done before the coefficients preparation has been introduced. Kept for comparison.
+ */
+static void Bench_CompensateUnprepared(__unused const BME280_TrimmingParams *params, const BME280_RawData *rawData,
+  __unused uint8_t channels, BME280_Measurement *measurement)
+{
+  const float *t = &Bench_RawParams[0];
+  const float *p = &Bench_RawParams[3];
+  const float *h = &Bench_RawParams[12];
+  float tData = (float) rawData->temperature;
+  float pData = (float) rawData->pressure;
+  float hData = (float) rawData->humidity;
+
+  float t1 = (tData / 16384.0F - t[0] / 1024.0F) * t[1];
+  float t2 = ((tData / 131072.0F - t[0] / 8192.0F) * (tData / 131072.0F - t[0] / 8192.0F)) * t[2];
+  float tFine = t1 + t2;
+  measurement->temperature = (t1 + t2) / 5120.0F;
+
+  float p1 = tFine / 2.0F - 64000.0F;
+  float p2 = p1 * p1 * p[5] / 32768.0F;
+  p2 = p2 + p1 * p[4] * 2.0F;
+  p2 = p2 / 4.0F + p[3] * 65536.0F;
+  p1 = (p[2] * p1 * p1 / 524288.0F + p[1] * p1) / 524288.0F;
+  p1 = (1.0F + p1 / 32768.0F) * p[0];
+  float p3 = 1048576.0F - pData;
+  p3 = (p3 - p2 / 4096.0F) * 6250.0F / p1;
+  p1 = p[8] * p3 * p3 / 2147483648.0F;
+  p2 = p3 * p[7] / 32768.0F;
+  measurement->pressure = p3 + (p1 + p2 + p[6]) / 16.0F;
+
+  float hv = tFine - 76800.0F;
+  hv = (hData - (h[3] * 64.0F + h[4] / 16384.0F * hv)) *
+    (h[1] / 65536.0F * (1.0F + h[5] / 67108864.0F * hv * (1.0F + h[2] / 67108864.0F * hv)));
+  hv = hv * (1.0F - h[0] * hv / 524288.0F);
+  measurement->humidity = hv > 100.0F ? 100.0F : hv < 0.0F ? 0.0F : hv;
+}
+
+/**
+ * @brief Prepares the trimming parameters read from the simulated device and the raw samples spanning the sensor
+ *   operating range.
+ */
+static void Bench_Prepare()
+{
+  Sim_Bme280PowerOn(NULL);
+  MX_I2C1_Init();
+  if (BME280_GetTrimmingParams(I2C1, &Bench_Params) != I2C_RESULT_OK)
+    fprintf(stderr, "Failed to read the trimming parameters.\n");
+  for (uint8_t index = 0; index < 3; index++)
+    Bench_RawParams[index] = (float) Bench_Params.digT[index];
+  for (uint8_t index = 0; index < 9; index++)
+    Bench_RawParams[3 + index] = (float) Bench_Params.digP[index];
+  for (uint8_t index = 0; index < 6; index++)
+    Bench_RawParams[12 + index] = (float) Bench_Params.digH[index];
+
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    Bench_RawData[index].temperature = Bench_GetRandom(380000, 640000);
+    Bench_RawData[index].pressure = Bench_GetRandom(250000, 500000);
+    Bench_RawData[index].humidity = Bench_GetRandom(20000, 45000);
+    Bench_Compensate(&Sim_Bme280DefaultCalibration, &Bench_RawData[index], &Bench_References[index]);
+  }
+}
+
+/**
+ * @brief Benchmarks a compensation function and prints its cost and maximal errors against the reference.
+ */
+static void Bench_RunCompensation(const char *name, Bench_CompensationFunction compensate)
+{
+  BME280_Measurement measurement;
+  double maxErrors[3] = {0};
+
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    compensate(&Bench_Params, &Bench_RawData[index], BME280_CHANNEL_ALL, &measurement);
+    double errors[3] = {
+      fabs(measurement.temperature - Bench_References[index].temperature),
+      fabs(measurement.pressure - Bench_References[index].pressure),
+      fabs(measurement.humidity - Bench_References[index].humidity)
+    };
+    for (uint8_t channel = 0; channel < 3; channel++)
+      maxErrors[channel] = errors[channel] > maxErrors[channel] ? errors[channel] : maxErrors[channel];
+  }
+
+  uint64_t start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+  {
+    for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+    {
+      compensate(&Bench_Params, &Bench_RawData[index], BME280_CHANNEL_ALL, &measurement);
+      Bench_Sink = measurement.pressure;
+    }
+  }
+  double cycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * BENCH_SAMPLES);
+
+  printf("%-24s %10.1f %14.6f %14.6f %14.6f\n", name, cycles, maxErrors[0], maxErrors[1], maxErrors[2]);
+}
+
+/**
+ * @brief Benchmarks the host batch compensation library against the firmware compensation engines applied sample by
+ *   sample, and checks the results match bit for bit.
+ */
+static void Bench_RunBatch()
+{
+  static const Bench_CompensationFunction engines[] = {BME280_CompensateFloat, BME280_CompensateInt32,
+    BME280_CompensateInt64};
+  static const char *const names[] = {"Float", "Int32", "Int64"};
+  static BME280_Measurement expected[BENCH_SAMPLES];
+  static BME280Batch_Measurement actual[BENCH_SAMPLES];
+  uint8_t data[BME280_TRIMMING_DATA_LENGTH];
+  BME280Batch_Calibration calibration;
+
+  _Static_assert(sizeof(BME280Batch_RawData) == sizeof(BME280_RawData), "The raw data layouts must match.");
+  if (BME280_GetTrimmingData(I2C1, data) != I2C_RESULT_OK)
+    fprintf(stderr, "Failed to read the calibration data.\n");
+  BME280Batch_ParseCalibration(data, &calibration);
+
+  printf("\nHost batch compensation (%d samples, results compared bit for bit with the firmware engines)\n",
+    BENCH_SAMPLES);
+  printf("%-24s %10s %10s %10s\n", "Engine", "Firmware", "Batch", "Mismatches");
+  for (uint8_t engine = 0; engine < sizeof(engines) / sizeof(engines[0]); engine++)
+  {
+    uint64_t start = Bench_GetCycles();
+    for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+    {
+      for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+        engines[engine](&Bench_Params, &Bench_RawData[index], BME280_CHANNEL_ALL, &expected[index]);
+      Bench_Sink = expected[pass % BENCH_SAMPLES].pressure;
+    }
+    double firmwareCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * BENCH_SAMPLES);
+
+    start = Bench_GetCycles();
+    for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+    {
+      BME280Batch_Compensate(&calibration, (BME280Batch_Engine) engine, (const BME280Batch_RawData *) Bench_RawData,
+        actual, BENCH_SAMPLES);
+      Bench_Sink = actual[pass % BENCH_SAMPLES].pressure;
+    }
+    double batchCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * BENCH_SAMPLES);
+
+    uint32_t mismatches = 0;
+    for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+      mismatches += memcmp(&expected[index], &actual[index], sizeof(actual[index])) != 0;
+
+    printf("%-24s %10.1f %10.1f %10u\n", names[engine], firmwareCycles, batchCycles, mismatches);
+  }
+}
+
+/**
+ * @brief Runs the host batch compensation benchmark comparing the per-sample (array-of-structures) and the vectorized
+ *   (structure-of-arrays) library functions.
+ */
+static void Bench_RunBatchArrays()
+{
+  static const char *const names[] = {"Float", "Int32", "Int64"};
+  static int32_t adcP[BENCH_SAMPLES], adcT[BENCH_SAMPLES], adcH[BENCH_SAMPLES];
+  static float pressure[BENCH_SAMPLES], temperature[BENCH_SAMPLES], humidity[BENCH_SAMPLES];
+  static BME280Batch_Measurement expected[BENCH_SAMPLES];
+  uint8_t data[BME280_TRIMMING_DATA_LENGTH];
+  BME280Batch_Calibration calibration;
+
+  if (BME280_GetTrimmingData(I2C1, data) != I2C_RESULT_OK)
+    fprintf(stderr, "Failed to read the calibration data.\n");
+  BME280Batch_ParseCalibration(data, &calibration);
+
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    adcP[index] = Bench_RawData[index].pressure;
+    adcT[index] = Bench_RawData[index].temperature;
+    adcH[index] = Bench_RawData[index].humidity;
+  }
+  BME280Batch_RawArrays rawArrays = {adcP, adcT, adcH};
+  BME280Batch_MeasurementArrays measurementArrays = {temperature, pressure, humidity};
+
+  printf("\nHost batch layouts (%d samples, structure-of-arrays results compared bit for bit)\n", BENCH_SAMPLES);
+  printf("%-24s %12s %12s %10s %10s\n", "Engine", "AoS, Msmp/s", "SoA, Msmp/s", "Speedup", "Mismatches");
+  for (uint8_t engine = 0; engine < sizeof(names) / sizeof(names[0]); engine++)
+  {
+    uint64_t start = Bench_GetNanos();
+    for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+    {
+      BME280Batch_Compensate(&calibration, (BME280Batch_Engine) engine, (const BME280Batch_RawData *) Bench_RawData,
+        expected, BENCH_SAMPLES);
+      Bench_Sink = expected[pass % BENCH_SAMPLES].pressure;
+    }
+    double structuresRate = (double) BENCH_PASSES * BENCH_SAMPLES * 1000.0 / (double) (Bench_GetNanos() - start);
+
+    start = Bench_GetNanos();
+    for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+    {
+      BME280Batch_CompensateArrays(&calibration, (BME280Batch_Engine) engine, &rawArrays, &measurementArrays,
+        BENCH_SAMPLES);
+      Bench_Sink = pressure[pass % BENCH_SAMPLES];
+    }
+    double arraysRate = (double) BENCH_PASSES * BENCH_SAMPLES * 1000.0 / (double) (Bench_GetNanos() - start);
+
+    uint32_t mismatches = 0;
+    for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+    {
+      BME280Batch_Measurement actual = {temperature[index], pressure[index], humidity[index]};
+      mismatches += memcmp(&expected[index], &actual, sizeof(actual)) != 0;
+    }
+
+    printf("%-24s %12.1f %12.1f %9.2fx %10u\n", names[engine], structuresRate, arraysRate,
+      arraysRate / structuresRate, mismatches);
+  }
+}
+
+/**
+ * @brief Runs the batched integer compensation kernel benchmark against the per-sample 64-bit integer engine.
+ * @param name The samples set name.
+ * @param rawData The uncompensated samples.
+ */
+static void Bench_RunBurst(const char *name, const BME280_RawData *rawData)
+{
+  static BME280_Measurement expected[BENCH_SAMPLES];
+  static BME280_Measurement actual[BENCH_SAMPLES];
+
+  uint64_t start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+  {
+    for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+      BME280_CompensateInt64(&Bench_Params, &rawData[index], BME280_CHANNEL_ALL, &expected[index]);
+    Bench_Sink = expected[pass % BENCH_SAMPLES].pressure;
+  }
+  double scalarCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * BENCH_SAMPLES);
+
+  start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+  {
+    BME280_CompensateInt64Batch(&Bench_Params, rawData, BME280_CHANNEL_ALL, actual, BENCH_SAMPLES);
+    Bench_Sink = actual[pass % BENCH_SAMPLES].pressure;
+  }
+  double batchCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * BENCH_SAMPLES);
+
+  uint32_t mismatches = 0;
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+    mismatches += memcmp(&expected[index], &actual[index], sizeof(actual[index])) != 0;
+
+  printf("%-24s %10.1f %10.1f %9.2fx %10u\n", name, scalarCycles, batchCycles, scalarCycles / batchCycles,
+    mismatches);
+}
+
+/**
+ * @brief Runs the batched integer compensation kernel benchmarks for the distinct samples, the oversampled bursts
+ *   sharing the temperature, and the bursts covering the full ADC value ranges.
+ */
+static void Bench_RunBursts()
+{
+  static BME280_RawData bursts[BENCH_SAMPLES];
+  static BME280_RawData ranges[BENCH_SAMPLES];
+
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    bursts[index] = Bench_RawData[index];
+    bursts[index].temperature = Bench_RawData[index & ~15U].temperature;
+    ranges[index].temperature = index % 16 ? ranges[index - 1].temperature : Bench_GetRandom(0, 0xFFFFF);
+    ranges[index].pressure = Bench_GetRandom(0, 0xFFFFF);
+    ranges[index].humidity = Bench_GetRandom(0, 0xFFFF);
+  }
+
+  printf("\nBatched integer compensation (%d samples, results compared bit for bit with the Int64 engine)\n",
+    BENCH_SAMPLES);
+  printf("%-24s %10s %10s %10s %10s\n", "Samples", "Int64", "Batch", "Speedup", "Mismatches");
+  Bench_RunBurst("Distinct", Bench_RawData);
+  Bench_RunBurst("Bursts of 16", bursts);
+  Bench_RunBurst("Full ranges, bursts", ranges);
+}
+
+/**
+ * @brief Computes the pressure using the 64-bit integer formula from the BME280 datasheet, kept apart from the
+ *   firmware engines to check the packed values against.
+ * @return The pressure in the Q24.8 format.
+ */
+static uint32_t Bench_CompensatePressureInt64(const BME280_TrimmingParams *params, const BME280_RawData *rawData)
+{
+  const int32_t *digT = params->digT;
+  const int32_t *digP = params->digP;
+  int32_t adcT = rawData->temperature;
+
+  int32_t t1 = (((adcT >> 3) - (digT[0] << 1)) * digT[1]) >> 11;
+  int32_t t2 = (((((adcT >> 4) - digT[0]) * ((adcT >> 4) - digT[0])) >> 12) * digT[2]) >> 14;
+  int64_t var1 = (int64_t) (t1 + t2) - 128000;
+  int64_t var2 = var1 * var1 * (int64_t) digP[5];
+  var2 = var2 + ((var1 * (int64_t) digP[4]) << 17);
+  var2 = var2 + ((int64_t) digP[3] << 35);
+  var1 = ((var1 * var1 * (int64_t) digP[2]) >> 8) + ((var1 * (int64_t) digP[1]) << 12);
+  var1 = ((((int64_t) 1 << 47) + var1) * (int64_t) digP[0]) >> 33;
+  if (var1 == 0)
+    return 0;
+
+  int64_t p = 1048576 - rawData->pressure;
+  p = (((p << 31) - var2) * 3125) / var1;
+  var1 = ((int64_t) digP[8] * (p >> 13) * (p >> 13)) >> 25;
+  var2 = ((int64_t) digP[7] * p) >> 19;
+  return (uint32_t) (((p + var1 + var2) >> 8) + ((int64_t) digP[6] << 4));
+}
+
+/**
+ * @brief Checks the binary frame packing of the 64-bit integer engine results: the packed pressure must equal the
+ *   datasheet formula result bit for bit, both for the per-sample and the batched compensation, unlike the value
+ *   rebuilt from the single-precision one.
+ */
+static void Bench_RunFramePacking()
+{
+  static BME280_RawData bursts[BENCH_SAMPLES];
+  static BME280_Measurement measurements[BENCH_SAMPLES];
+  uint8_t buffer[FRAME_MEASUREMENT_LENGTH];
+  uint32_t mismatches[3] = {0};
+
+  // The bursts sharing the temperature let the batched kernel use the reciprocal instead of the division.
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    bursts[index] = Bench_RawData[index];
+    bursts[index].temperature = Bench_RawData[index & ~15U].temperature;
+  }
+
+  BME280_Compensation compensation = BME280_compensation;
+  BME280_compensation = BME280_COMPENSATION_INT64;
+  BME280_CompensateBatch(&Bench_Params, bursts, BME280_CHANNEL_ALL, measurements, BENCH_SAMPLES);
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    BME280_Measurement measurement;
+    uint32_t expected = Bench_CompensatePressureInt64(&Bench_Params, &bursts[index]);
+    BME280_Compensate(&Bench_Params, &bursts[index], BME280_CHANNEL_ALL, &measurement);
+    Frame_PutMeasurement(buffer, &measurement);
+    mismatches[0] += Frame_GetUint32(&buffer[0]) != expected;
+    Frame_PutMeasurement(buffer, &measurements[index]);
+    mismatches[1] += Frame_GetUint32(&buffer[0]) != expected;
+    mismatches[2] += (uint32_t) (measurement.pressure * 256.0F + 0.5F) != expected;
+  }
+  BME280_compensation = compensation;
+
+  printf("\nBinary frame packing (%d samples, Int64 pressure compared bit for bit with the datasheet formula)\n",
+    BENCH_SAMPLES);
+  printf("%-24s %10s\n", "Packed value", "Mismatches");
+  printf("%-24s %10u\n", "Int64", mismatches[0]);
+  printf("%-24s %10u\n", "Int64 batch", mismatches[1]);
+  printf("%-24s %10u\n", "Rebuilt from float", mismatches[2]);
+}
+
+/**
+ * @brief Parses the command message with <i>sscanf</i> the way it was done before the tokenizer has been introduced.
+ */
+static void Bench_ParseLegacy(const char *message, Bench_LegacyDescriptor *descriptor)
+{
+  descriptor->name[0] = descriptor->param[0] = descriptor->value[0] = '\0';
+  sscanf(message, "%64s%64s%64s", descriptor->name, descriptor->param, descriptor->value);
+}
+
+/**
+ * @brief Checks if the token matches the null-terminated string exactly and lies within the message.
+ */
+static bool Bench_IsTokenValid(const Command_Token *token, const char *string, const char *message, size_t length)
+{
+  return token->string >= message && token->string + token->length <= message + length &&
+    token->length == strlen(string) && memcmp(token->string, string, token->length) == 0;
+}
+
+/**
+ * @brief Feeds random messages of up to <i>CONFIG_MAX_COMMAND_MESSAGE_LENGTH</i> arbitrary non-null bytes (the longest
+ *   message the command queue produces) to the tokenizer, and checks that the tokens stay within the message and match
+ *   the ones produced by <i>sscanf</i>.
+ * @return The number of mismatching messages.
+ */
+static uint32_t Bench_CheckTokenizer()
+{
+  char message[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+  const char alphabet[] = " \t\r\v\fAaZz09;=-\x7F\x80\xFF";
+  uint32_t mismatches = 0;
+
+  for (uint32_t count = 0; count < BENCH_RANDOM_MESSAGES; count++)
+  {
+    size_t length = (size_t) Bench_GetRandom(0, CONFIG_MAX_COMMAND_MESSAGE_LENGTH);
+    bool isBinary = count & 1;
+    for (size_t index = 0; index < length; index++)
+      message[index] = isBinary ? (char) Bench_GetRandom(1, 255) : alphabet[Bench_GetRandom(0, sizeof(alphabet) - 2)];
+    message[length] = '\0';
+
+    Command_Descriptor descriptor;
+    Bench_LegacyDescriptor legacy;
+    Command_Tokenize(message, &descriptor);
+    Bench_ParseLegacy(message, &legacy);
+
+    if (!Bench_IsTokenValid(&descriptor.name, legacy.name, message, length) ||
+      !Bench_IsTokenValid(&descriptor.param, legacy.param, message, length) ||
+      !Bench_IsTokenValid(&descriptor.value, legacy.value, message, length))
+      mismatches++;
+  }
+
+  return mismatches;
+}
+
+/**
+ * @brief Benchmarks the command message parsing: the legacy <i>sscanf</i> based one against the tokenizer.
+ */
+static void Bench_RunParsing()
+{
+  const uint32_t count = sizeof(Bench_Messages) / sizeof(Bench_Messages[0]);
+  Command_Descriptor descriptor;
+  Bench_LegacyDescriptor legacy;
+
+  uint64_t start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES * 100; pass++)
+  {
+    for (uint32_t index = 0; index < count; index++)
+    {
+      Bench_ParseLegacy(Bench_Messages[index], &legacy);
+      Bench_Sink = (float) legacy.param[0];
+    }
+  }
+  double legacyCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * 100 * count);
+
+  start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES * 100; pass++)
+  {
+    for (uint32_t index = 0; index < count; index++)
+    {
+      Command_Tokenize(Bench_Messages[index], &descriptor);
+      Bench_Sink = (float) descriptor.param.length;
+    }
+  }
+  double tokenizerCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * 100 * count);
+
+  printf("\nCommand parsing (%u messages, %u random messages checked against sscanf)\n", count,
+    BENCH_RANDOM_MESSAGES);
+  printf("%-24s %10s %14s %14s\n", "Parser", "Cycles", "Stack, bytes", "Mismatches");
+  printf("%-24s %10.1f %14zu %14s\n", "sscanf", legacyCycles, sizeof(legacy), "-");
+  printf("%-24s %10.1f %14zu %14u\n", "Tokenizer", tokenizerCycles, sizeof(descriptor), Bench_CheckTokenizer());
+}
+
+/**
+ * @brief Finds the command by a linear scan with <i>strcasecmp</i> the way it was done before the hash table has been
+ *   introduced. Kept for comparison.
+ */
+static uint32_t Bench_FindLinearStrcasecmp(const char *name)
+{
+  for (uint32_t index = 0; index < BENCH_COMMAND_COUNT; index++)
+  {
+    if (strcasecmp(name, Bench_CommandNames[index]) == 0)
+      return index;
+  }
+  return BENCH_COMMAND_COUNT;
+}
+
+/**
+ * @brief Finds the command by a linear scan with <i>Command_TokenEquals</i>.
+ */
+static uint32_t Bench_FindLinearToken(const Command_Token *name)
+{
+  for (uint32_t index = 0; index < BENCH_COMMAND_COUNT; index++)
+  {
+    if (Command_TokenEquals(name, Bench_CommandNames[index]))
+      return index;
+  }
+  return BENCH_COMMAND_COUNT;
+}
+
+/**
+ * @brief Finds the command with the hash table lookup the same way the <i>Command_Find</i> function does.
+ */
+static uint32_t Bench_FindHashed(const Command_Token *name)
+{
+  if (name->length == 0)
+    return BENCH_COMMAND_COUNT;
+
+  uint8_t slot = Bench_CommandHashTable[Command_GetTokenHash(name, BENCH_HASH_TABLE_SIZE)];
+  if (slot == 0 || !Command_TokenEquals(name, Bench_CommandNames[slot - 1]))
+    return BENCH_COMMAND_COUNT;
+
+  return slot - 1;
+}
+
+/**
+ * @brief Benchmarks the command lookup in the 100-command table: the linear scans against the hash table lookup. Every
+ *   command name is looked up in the upper case, and as many unknown names are looked up as well.
+ */
+static void Bench_RunLookup()
+{
+  static char names[2 * BENCH_COMMAND_COUNT][CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+  Command_Token tokens[2 * BENCH_COMMAND_COUNT];
+  const uint32_t count = 2 * BENCH_COMMAND_COUNT;
+  uint32_t mismatches = 0;
+
+  for (uint32_t index = 0; index < BENCH_COMMAND_COUNT; index++)
+  {
+    const char *name = Bench_CommandNames[index];
+    size_t length = strlen(name);
+    for (size_t position = 0; position < length; position++)
+      names[index][position] = (char) (name[position] & ~0x20);
+    sprintf(names[BENCH_COMMAND_COUNT + index], "%sX", name);
+  }
+
+  for (uint32_t index = 0; index < count; index++)
+  {
+    tokens[index] = (Command_Token) {names[index], (uint16_t) strlen(names[index])};
+    uint32_t expected = index < BENCH_COMMAND_COUNT ? index : BENCH_COMMAND_COUNT;
+    if (Bench_FindLinearStrcasecmp(names[index]) != expected || Bench_FindLinearToken(&tokens[index]) != expected ||
+      Bench_FindHashed(&tokens[index]) != expected)
+      mismatches++;
+  }
+
+  uint64_t start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+  {
+    for (uint32_t index = 0; index < count; index++)
+      Bench_Sink = (float) Bench_FindLinearStrcasecmp(names[index]);
+  }
+  double strcasecmpCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * count);
+
+  start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES; pass++)
+  {
+    for (uint32_t index = 0; index < count; index++)
+      Bench_Sink = (float) Bench_FindLinearToken(&tokens[index]);
+  }
+  double tokenCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * count);
+
+  start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES * 100; pass++)
+  {
+    for (uint32_t index = 0; index < count; index++)
+      Bench_Sink = (float) Bench_FindHashed(&tokens[index]);
+  }
+  double hashedCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * 100 * count);
+
+  printf("\nCommand lookup (%d commands, %u known and unknown names, %u mismatches)\n", BENCH_COMMAND_COUNT, count,
+    mismatches);
+  printf("%-24s %10s\n", "Lookup", "Cycles");
+  printf("%-24s %10.1f\n", "Linear, strcasecmp", strcasecmpCycles);
+  printf("%-24s %10.1f\n", "Linear, token", tokenCycles);
+  printf("%-24s %10.1f\n", "Hash table", hashedCycles);
+}
+
+/**
+ * @brief Formats random values within and around the measurement ranges, as well as arbitrary bit patterns, with the
+ *   number formatter at every supported precision, and checks the results against the <i>snprintf</i> ones.
+ * @return The number of mismatching values.
+ */
+static uint32_t Bench_CheckNumberFormat()
+{
+  char expected[64];
+  char actual[NUMBER_FORMAT_MAX_LENGTH];
+  uint32_t mismatches = 0;
+
+  for (uint32_t count = 0; count < BENCH_RANDOM_VALUES; count++)
+  {
+    float value;
+    if (count & 1)
+    {
+      uint32_t bits = (uint32_t) Bench_GetRandom(0, 0xFFFF) << 16 | (uint32_t) Bench_GetRandom(0, 0xFFFF);
+      memcpy(&value, &bits, sizeof(value));
+      if (fabsf(value) >= 1e19F)
+        continue;
+    }
+    else
+      value = (float) Bench_GetRandom(-100000000, 100000000) / (float) Bench_GetRandom(1, 100000);
+
+    uint8_t precision = (uint8_t) Bench_GetRandom(0, NUMBER_FORMAT_MAX_PRECISION);
+    snprintf(expected, sizeof(expected), "%.*f", precision, value);
+    uint8_t length = NumberFormat_Fixed(actual, value, precision);
+    if (strcmp(expected, actual) != 0 || length != strlen(actual))
+      mismatches++;
+  }
+
+  return mismatches;
+}
+
+/**
+ * @brief Benchmarks formatting of the <i>Measure All</i> command response: the <i>"%f"</i> <i>sprintf</i> based one
+ *   against the number formatter.
+ */
+static void Bench_RunNumberFormat()
+{
+  char response[CONFIG_MAX_RESPONSE_MESSAGE_LENGTH];
+  char pressure[NUMBER_FORMAT_MAX_LENGTH];
+  char temperature[NUMBER_FORMAT_MAX_LENGTH];
+  char humidity[NUMBER_FORMAT_MAX_LENGTH];
+  BME280_Measurement measurements[BENCH_SAMPLES];
+  for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+  {
+    BME280_CompensateFloat(&Bench_Params, &Bench_RawData[index], BME280_CHANNEL_ALL, &measurements[index]);
+    measurements[index].pressure *= 0.007500617F;
+  }
+
+  uint64_t start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES / 10; pass++)
+  {
+    for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+    {
+      BME280_Measurement *measurement = &measurements[index];
+      sprintf(response, "OK; P = %f mmHg; T = %f degC; H = %f %%\n", measurement->pressure,
+        measurement->temperature, measurement->humidity);
+      Bench_Sink = (float) response[8];
+    }
+  }
+  double printfCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES / 10 * BENCH_SAMPLES);
+
+  start = Bench_GetCycles();
+  for (uint32_t pass = 0; pass < BENCH_PASSES / 10; pass++)
+  {
+    for (uint32_t index = 0; index < BENCH_SAMPLES; index++)
+    {
+      BME280_Measurement *measurement = &measurements[index];
+      NumberFormat_Fixed(pressure, measurement->pressure, CONFIG_MEASUREMENT_PRECISION);
+      NumberFormat_Fixed(temperature, measurement->temperature, CONFIG_MEASUREMENT_PRECISION);
+      NumberFormat_Fixed(humidity, measurement->humidity, CONFIG_MEASUREMENT_PRECISION);
+      sprintf(response, "OK; P = %s mmHg; T = %s degC; H = %s %%\n", pressure, temperature, humidity);
+      Bench_Sink = (float) response[8];
+    }
+  }
+  double fixedCycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES / 10 * BENCH_SAMPLES);
+
+  printf("\nMeasure All response formatting (%d samples, %d random values checked against snprintf)\n",
+    BENCH_SAMPLES, BENCH_RANDOM_VALUES);
+  printf("%-24s %10s %14s\n", "Formatter", "Cycles", "Mismatches");
+  printf("%-24s %10.1f %14s\n", "sprintf %f", printfCycles, "-");
+  printf("%-24s %10.1f %14u\n", "NumberFormat_Fixed", fixedCycles, Bench_CheckNumberFormat());
+}
+
+/**
+ * @brief Runs the simulated main loop for a single USB frame.
+ */
+static void Bench_RunFrame()
+{
+  Project_Loop();
+  Sim_CdcService();
+  Sim_AdvanceMicros(1000);
+}
+
+/**
+ * @brief Benchmarks the single-channel measurements against the all-channel ones: the simulated bus time of the
+ *   sensor data registers burst read, and the <i>Measure</i> command processing cost with the lazy compensation of the
+ *   latest background sample. The simulated firmware must be initialized and idle.
+ */
+static void Bench_RunChannels()
+{
+  static const char *const params[] = {"All", "P", "T", "H"};
+  static const uint8_t channels[] = {BME280_CHANNEL_ALL, BME280_CHANNEL_PRESSURE, BME280_CHANNEL_TEMPERATURE,
+    BME280_CHANNEL_HUMIDITY};
+  char message[CONFIG_MAX_COMMAND_MESSAGE_LENGTH];
+  char response[CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + 1];
+  BME280_RawData rawData;
+  Sampler_Sample sample;
+
+  printf("\nSingle-channel measurements (bus read of the data registers, Measure command processing)\n");
+  printf("%-24s %10s %10s %12s\n", "Channel", "Bus bytes", "Bus, us", "Cycles/cmd");
+  for (uint8_t index = 0; index < sizeof(params) / sizeof(params[0]); index++)
+  {
+    uint32_t bytes = Sim_I2cGetTransferredBytes();
+    uint64_t micros = Sim_GetMicros();
+    BME280_GetRawData(I2C1, channels[index], &rawData);
+    bytes = Sim_I2cGetTransferredBytes() - bytes;
+    micros = Sim_GetMicros() - micros;
+
+    while (!Sampler_GetLatest(&sample))
+      Bench_RunFrame();
+    sprintf(message, "Measure %s", params[index]);
+    uint64_t start = Bench_GetCycles();
+    for (uint32_t pass = 0; pass < BENCH_PASSES * 10; pass++)
+      Bench_Sink = (float) Command_ProcessMessage(message, response);
+    double cycles = (double) (Bench_GetCycles() - start) / (BENCH_PASSES * 10);
+
+    printf("%-24s %10lu %10lu %12.0f\n", message, (unsigned long) bytes, (unsigned long) micros, cycles);
+  }
+}
+
+/**
+ * @brief Checks the complete response: the text response must begin with the OK status word or the sample message
+ *   word, and the binary response
+ *   frame must be decoded and verified the way the host application would do.
+ */
+static bool Bench_IsResponseValid()
+{
+  if (!Bench_IsBinary)
+    return (Bench_ResponseLength >= 2 && memcmp(Bench_Response, "OK", 2) == 0) ||
+      (Bench_ResponseLength >= 4 && memcmp(Bench_Response, "DATA", 4) == 0) ||
+      (Bench_ResponseLength >= 4 && memcmp(Bench_Response, "HIST", 4) == 0);
+
+  uint8_t data[sizeof(Bench_Response)];
+  uint16_t length;
+  return Frame_Decode(Bench_Response, Bench_ResponseLength, data, &length) &&
+    length > FRAME_HEADER_LENGTH + FRAME_CRC_LENGTH && data[FRAME_HEADER_LENGTH] == COMMAND_STATUS_OK &&
+    Frame_GetCrc(data, length - FRAME_CRC_LENGTH) == (data[length - 2] | data[length - 1] << 8);
+}
+
+/**
+ * @brief Counts the streamed samples repeating the values of the previous one, i.e. the sensor data streamed twice.
+ */
+static void Bench_CheckStreamRepeat()
+{
+  uint8_t data[sizeof(Bench_Response)];
+  const uint8_t *values = NULL;
+  uint16_t length = 0;
+
+  if (!Bench_IsBinary && Bench_ResponseLength >= 4 && memcmp(Bench_Response, "DATA", 4) == 0)
+  {
+    const uint8_t *end = &Bench_Response[Bench_ResponseLength];
+    for (values = Bench_Response; values < end - 4 && memcmp(values, "ms; ", 4) != 0; values++);
+    length = (uint16_t) (end - values);
+  }
+  else if (Bench_IsBinary && Frame_Decode(Bench_Response, Bench_ResponseLength, data, &length) &&
+    length > FRAME_HEADER_LENGTH + 5 + FRAME_CRC_LENGTH && data[0] == COMMAND_ID_STREAM)
+  {
+    values = &data[FRAME_HEADER_LENGTH + 5];
+    length -= FRAME_HEADER_LENGTH + 5 + FRAME_CRC_LENGTH;
+  }
+
+  if (values == NULL)
+    return;
+
+  Bench_StreamRepeats += length == Bench_StreamedValuesLength && memcmp(values, Bench_StreamedValues, length) == 0;
+  memcpy(Bench_StreamedValues, values, length);
+  Bench_StreamedValuesLength = length;
+}
+
+/**
+ * @brief Counts and checks the LF-terminated text responses or the delimited binary response frames transmitted over
+ *   the simulated CDC interface.
+ */
+static void Bench_CountResponses(const char *data, uint16_t length)
+{
+  char delimiter = Bench_IsBinary ? FRAME_DELIMITER : '\n';
+
+  Bench_ResponseBytes += length;
+  for (uint16_t index = 0; index < length; index++)
+  {
+    if (data[index] != delimiter)
+    {
+      if (Bench_ResponseLength < sizeof(Bench_Response))
+        Bench_Response[Bench_ResponseLength++] = (uint8_t) data[index];
+      continue;
+    }
+
+    Bench_ResponseErrors += !Bench_IsResponseValid();
+    Bench_CheckStreamRepeat();
+    Bench_ResponseLength = 0;
+    Bench_Responses++;
+  }
+}
+
+/**
+ * @brief Sends the command in the current protocol mode: as a text command message or as a binary frame.
+ * @param id The command identifier.
+ * @param param The command parameter string.
+ */
+static void Bench_SendCommand(Command_Id id, const char *param)
+{
+  char message[CONFIG_MAX_COMMAND_MESSAGE_LENGTH];
+  if (!Bench_IsBinary)
+    return Project_CdcMessageReceived(message, (uint16_t) sprintf(message, "%s %s\n", Command_GetName(id), param));
+
+  uint8_t request[CONFIG_MAX_COMMAND_MESSAGE_LENGTH] = {id, 0};
+  uint8_t frame[FRAME_ENCODED_LENGTH(sizeof(request))];
+  uint16_t length = FRAME_HEADER_LENGTH + (uint16_t) strlen(strcpy((char *) &request[FRAME_HEADER_LENGTH], param));
+  uint16_t crc = Frame_GetCrc(request, length);
+  request[length++] = (uint8_t) crc;
+  request[length++] = (uint8_t) (crc >> 8);
+  Project_CdcMessageReceived((const char *) frame, Frame_Encode(request, length, frame));
+}
+
+/**
+ * @brief Switches the firmware protocol mode with the <i>Mode</i> command and waits for the response.
+ */
+static void Bench_SetBinaryMode(bool isBinary)
+{
+  if (isBinary == Bench_IsBinary)
+    return;
+
+  Bench_SendCommand(COMMAND_ID_MODE, isBinary ? "Binary" : "Text");
+  Bench_Responses = 0;
+  while (Bench_Responses == 0)
+    Bench_RunFrame();
+  Bench_IsBinary = isBinary;
+}
+
+/**
+ * @brief Benchmarks the sample streaming over the simulated CDC interface for 1000 USB frames: the samples streamed
+ *   per second of the simulated time including the I2C transfers, and the ones repeating the previous sample values.
+ * @param name The benchmark name.
+ * @param rate The requested streaming rate in samples per second.
+ */
+static void Bench_RunStream(const char *name, uint32_t rate)
+{
+  char param[16];
+  sprintf(param, "%lu", (unsigned long) rate);
+  Bench_SendCommand(COMMAND_ID_STREAM, param);
+  Bench_RunFrame();
+
+  Bench_Responses = 0;
+  Bench_ResponseBytes = 0;
+  Bench_ResponseErrors = 0;
+  Bench_StreamRepeats = 0;
+  Bench_StreamedValuesLength = 0;
+  uint64_t micros = Sim_GetMicros();
+  uint64_t start = Bench_GetCycles();
+  for (uint16_t frame = 0; frame < 1000; frame++)
+    Bench_RunFrame();
+  micros = Sim_GetMicros() - micros;
+  double cycles = (double) (Bench_GetCycles() - start) / (Bench_Responses > 0 ? Bench_Responses : 1);
+  uint32_t samples = Bench_Responses;
+  uint32_t bytes = Bench_ResponseBytes;
+  uint32_t errors = Bench_ResponseErrors;
+
+  Stream_Stats stats;
+  Stream_GetStats(&stats);
+  Bench_SendCommand(COMMAND_ID_STREAM, "Off");
+  for (uint16_t frame = 0; frame < 10; frame++)
+    Bench_RunFrame();
+
+  printf("%-24s %10lu %10u %10.1f %10.1f %12.0f %8u %8lu %8u\n", name, (unsigned long) rate, samples,
+    samples * 1000000.0 / (double) micros, (double) bytes / (samples > 0 ? samples : 1), cycles, errors,
+    (unsigned long) stats.dropped, Bench_StreamRepeats);
+}
+
+/**
+ * @brief Checks the normal mode background sampling of the steady values polled every millisecond: the conversions
+ *   completed by the sensor, the history entries and the noise estimation samples taken from them, and the history
+ *   entries repeating the previous one sooner than the shortest conversion cycle, i.e. the latched data read again.
+ * @param name The benchmark name.
+ * @param oversampling The pressure, temperature, and humidity oversampling factor initially set.
+ */
+static void Bench_RunSteadySampling(const char *name, uint8_t oversampling)
+{
+  BME280_Config config = Project_Bme280Config;
+  while (!Sampler_IsIdle())
+    Bench_RunFrame();
+  Project_Bme280Config.mode = BME280_MODE_NORMAL;
+  Project_Bme280Config.pressureOversampling = oversampling;
+  Project_Bme280Config.temperatureOversampling = oversampling;
+  Project_Bme280Config.humidityOversampling = oversampling;
+  Oversampling_SetEnabled(true);
+  Sampler_SetPeriod(1);
+  Sampler_InitSensor();
+  for (uint16_t frame = 0; frame < 1000; frame++)
+    Bench_RunFrame();
+
+  uint32_t first;
+  uint32_t next;
+  History_GetRange(&first, &next);
+  uint32_t start = next;
+  uint32_t conversions = Sim_Bme280GetConversionCount();
+  uint32_t tracked = Oversampling_GetTrackedCount();
+  for (uint16_t frame = 0; frame < 2000; frame++)
+    Bench_RunFrame();
+  conversions = Sim_Bme280GetConversionCount() - conversions;
+  tracked = Oversampling_GetTrackedCount() - tracked;
+
+  uint32_t duplicates = 0;
+  uint32_t shortestCycle = 1000 / Stream_GetMaxRate();
+  History_Entry previous;
+  History_Entry entry;
+  History_GetRange(&first, &next);
+  bool isPrevious = History_Get(start - 1, &previous);
+  for (uint32_t index = start; index < next && History_Get(index, &entry); index++)
+  {
+    duplicates += isPrevious && entry.timestamp - previous.timestamp < shortestCycle &&
+      memcmp(&entry.rawData, &previous.rawData, sizeof(entry.rawData)) == 0;
+    previous = entry;
+    isPrevious = true;
+  }
+
+  printf("%-24s %12lu %10lu %10lu %10lu\n", name, (unsigned long) conversions, (unsigned long) (next - start),
+    (unsigned long) tracked, (unsigned long) duplicates);
+  while (!Sampler_IsIdle())
+    Bench_RunFrame();
+  Project_Bme280Config = config;
+  Oversampling_SetEnabled(CONFIG_ADAPTIVE_OVERSAMPLING);
+  Sampler_SetPeriod(CONFIG_SAMPLING_PERIOD);
+  Sampler_InitSensor();
+}
+
+/**
+ * @brief Benchmarks the bulk readout of the whole sample history over the simulated CDC interface.
+ * @param name The benchmark name.
+ */
+static void Bench_RunHistory(const char *name)
+{
+  uint32_t first;
+  uint32_t next;
+  History_GetRange(&first, &next);
+  uint32_t count = next - first;
+
+  if (!Bench_IsBinary)
+  {
+    char param[32];
+    sprintf(param, "%lu %lu", (unsigned long) first, (unsigned long) count);
+    Bench_SendCommand(COMMAND_ID_HISTORY, param);
+  }
+  else
+  {
+    uint8_t request[FRAME_HEADER_LENGTH + 8 + FRAME_CRC_LENGTH] = {COMMAND_ID_HISTORY, 0};
+    uint8_t frame[FRAME_ENCODED_LENGTH(sizeof(request))];
+    Frame_PutUint32(&request[FRAME_HEADER_LENGTH], first);
+    Frame_PutUint32(&request[FRAME_HEADER_LENGTH + 4], count);
+    uint16_t crc = Frame_GetCrc(request, FRAME_HEADER_LENGTH + 8);
+    request[FRAME_HEADER_LENGTH + 8] = (uint8_t) crc;
+    request[FRAME_HEADER_LENGTH + 9] = (uint8_t) (crc >> 8);
+    Project_CdcMessageReceived((const char *) frame, Frame_Encode(request, sizeof(request), frame));
+  }
+
+  // Counting the command response along with the samples.
+  Bench_Responses = 0;
+  Bench_ResponseBytes = 0;
+  Bench_ResponseErrors = 0;
+  uint64_t micros = Sim_GetMicros();
+  uint64_t start = Bench_GetCycles();
+  while (Bench_Responses < count + 1)
+    Bench_RunFrame();
+  double cycles = (double) (Bench_GetCycles() - start) / count;
+  double seconds = (double) (Sim_GetMicros() - micros) / 1000000.0;
+
+  printf("%-24s %10lu %10.0f %10.1f %12.0f %8u\n", name, (unsigned long) count, count / seconds,
+    (double) Bench_ResponseBytes / count, cycles, Bench_ResponseErrors);
+}
+
+/**
+ * @brief Runs the on-demand measurement benchmark: sends the <i>Measure</i> commands with the idle gaps between them
+ *   and measures the response latency, the age of the returned sample, and the share of time the sensor spends
+ *   converting (self-heating).
+ * @param name The benchmark name.
+ * @param mode The sensor acquisition mode to use.
+ * @param param The <i>Measure</i> command parameters.
+ */
+static void Bench_RunOnDemand(const char *name, BME280_Mode mode, const char *param)
+{
+  if (Project_Bme280Config.mode != mode)
+  {
+    while (!Sampler_IsIdle())
+      Bench_RunFrame();
+    Project_Bme280Config.mode = mode;
+    Sampler_InitSensor();
+  }
+  for (uint16_t frame = 0; frame < 1000; frame++)
+    Bench_RunFrame();
+
+  uint64_t latency = 0;
+  uint64_t age = 0;
+  uint64_t start = Sim_GetMicros();
+  uint64_t active = Sim_Bme280GetActiveMicros();
+  for (uint16_t request = 0; request < BENCH_ON_DEMAND_REQUESTS; request++)
+  {
+    for (uint16_t frame = 0; frame < BENCH_ON_DEMAND_GAP; frame++)
+      Bench_RunFrame();
+
+    uint64_t sent = Sim_GetMicros();
+    Bench_Responses = 0;
+    Bench_SendCommand(COMMAND_ID_MEASURE, param);
+    while (Bench_Responses == 0)
+      Bench_RunFrame();
+    latency += Sim_GetMicros() - sent;
+
+    Sampler_Sample sample;
+    Sampler_GetLatest(&sample);
+    age += HAL_GetTick() - sample.timestamp;
+  }
+  double duty = (double) (Sim_Bme280GetActiveMicros() - active) * 100.0 / (double) (Sim_GetMicros() - start);
+
+  printf("%-24s %10.1f %10.1f %10.1f\n", name, (double) latency / BENCH_ON_DEMAND_REQUESTS / 1000.0,
+    (double) age / BENCH_ON_DEMAND_REQUESTS, duty);
+}
+
+/**
+ * @brief Benchmarks the back-to-back forced mode sampling over the simulated noise trace with a slowly drifting
+ *   pressure: the sample rate, the RMS errors of the compensated values against the noiseless ones, and the settings
+ *   in use at the end of every phase.
+ * @param name The benchmark name.
+ * @param isAdaptive If <i>true</i>, the adaptive oversampling is enabled, otherwise the x16 oversampling is used.
+ */
+static void Bench_RunOversampling(const char *name, bool isAdaptive)
+{
+  Sim_Bme280Adc adc = {.pressure = 415148, .temperature = 519888, .humidity = 30000};
+  BME280_Config config = Project_Bme280Config;
+  Project_Bme280Config.mode = BME280_MODE_FORCED;
+  Project_Bme280Config.filter = BME280_FILTER_OFF;
+  Project_Bme280Config.pressureOversampling = BME280_PRESSURE_OVERSAMPLING_16;
+  Project_Bme280Config.temperatureOversampling = BME280_TEMPERATURE_OVERSAMPLING_16;
+  Project_Bme280Config.humidityOversampling = BME280_HUMIDITY_OVERSAMPLING_16;
+  Oversampling_SetEnabled(isAdaptive);
+  Sampler_SetPeriod(1);
+
+  uint32_t lastTimestamp = 0;
+  for (uint8_t phase = 0; phase < sizeof(Bench_NoiseTrace) / sizeof(Bench_NoiseTrace[0]); phase++)
+  {
+    uint32_t samples = 0;
+    double errors[3] = {0};
+    Sim_Bme280SetNoise(&Bench_NoiseTrace[phase].noise);
+    for (uint32_t frame = 0; frame < BENCH_NOISE_PHASE_LENGTH; frame++)
+    {
+      if (frame % BENCH_NOISE_DRIFT_PERIOD == 0)
+      {
+        adc.pressure++;
+        Sim_Bme280SetAdc(&adc);
+      }
+      Bench_RunFrame();
+
+      Sampler_Sample sample;
+      if (!Sampler_GetLatest(&sample) || sample.timestamp == lastTimestamp || sample.status != SAMPLER_STATUS_OK)
+        continue;
+      lastTimestamp = sample.timestamp;
+      if (frame < BENCH_NOISE_PHASE_LENGTH / 2)
+        continue;
+
+      BME280_RawData truth = {.pressure = (int32_t) adc.pressure, .temperature = (int32_t) adc.temperature,
+        .humidity = (int32_t) adc.humidity};
+      BME280_Measurement measured;
+      BME280_Measurement expected;
+      BME280_Compensate(&Project_TrimmingParams, &sample.rawData, BME280_CHANNEL_ALL, &measured);
+      BME280_Compensate(&Project_TrimmingParams, &truth, BME280_CHANNEL_ALL, &expected);
+      errors[0] += pow(measured.pressure - expected.pressure, 2);
+      errors[1] += pow(measured.temperature - expected.temperature, 2);
+      errors[2] += pow(measured.humidity - expected.humidity, 2);
+      samples++;
+    }
+
+    char settings[48];
+    sprintf(settings, "x%u/x%u/x%u, %u", 1U << (Project_Bme280Config.pressureOversampling - 1),
+      1U << (Project_Bme280Config.temperatureOversampling - 1), 1U << (Project_Bme280Config.humidityOversampling - 1),
+      Project_Bme280Config.filter ? 1U << Project_Bme280Config.filter : 0);
+    samples = samples > 0 ? samples : 1;
+    printf("%-12s %-11s %10.1f %10.2f %10.4f %10.4f  %s\n", Bench_NoiseTrace[phase].name, name,
+      samples * 2000.0 / BENCH_NOISE_PHASE_LENGTH, sqrt(errors[0] / samples), sqrt(errors[1] / samples),
+      sqrt(errors[2] / samples), settings);
+  }
+
+  Sim_Bme280SetNoise(&(Sim_Bme280Noise) {0});
+  Sim_Bme280SetAdc(&(Sim_Bme280Adc) {.pressure = 415148, .temperature = 519888, .humidity = 30000});
+  Oversampling_SetEnabled(false);
+  Sampler_SetPeriod(CONFIG_SAMPLING_PERIOD);
+
+  // The factors selected by the adaptive oversampling must not replace the ones set by the user when saved,
+  // checked with the controller disabled, so that the saved settings keep it disabled on the following boots.
+  uint8_t saved[7];
+  if (isAdaptive)
+  {
+    bool isUserSaved = Project_SaveSettings() && Store_Get(STORE_KEY_SENSOR_CONFIG, saved, sizeof(saved)) &&
+      saved[1] == Project_Bme280UserConfig.filter && saved[2] == Project_Bme280UserConfig.pressureOversampling &&
+      saved[3] == Project_Bme280UserConfig.temperatureOversampling &&
+      saved[4] == Project_Bme280UserConfig.humidityOversampling;
+    printf("%-24s %s\n", "User settings saved", isUserSaved ? "Yes" : "No");
+  }
+  Project_Bme280Config = config;
+}
+
+/**
+ * @brief Benchmarks the sensor initialization after it has been powered on: the initialization time, the longest time
+ *   the main loop is blocked for by it, the I2C traffic, and the time to the first valid sample requested right after
+ *   the initialization.
+ * @param name The benchmark name.
+ * @param mode The sensor acquisition mode to use.
+ * @param oversampling The oversampling register value used for all the channels.
+ * @param calibration A pointer to the trimming parameters of the simulated device, or <i>NULL</i> for the default ones.
+ *   A different device is simulated by the different parameters.
+ */
+static void Bench_RunBoot(const char *name, BME280_Mode mode, uint8_t oversampling,
+  const Sim_Bme280Calibration *calibration)
+{
+  BME280_Config config = Project_Bme280Config;
+  Project_Bme280Config.mode = mode;
+  Project_Bme280Config.pressureOversampling = oversampling;
+  Project_Bme280Config.temperatureOversampling = oversampling;
+  Project_Bme280Config.humidityOversampling = oversampling;
+  while (!Sampler_IsIdle())
+    Bench_RunFrame();
+
+  Sim_Bme280PowerOn(calibration);
+  uint32_t bytes = Sim_I2cGetTransferredBytes();
+  uint64_t start = Sim_GetMicros();
+  Sampler_InitSensor();
+  uint64_t blocked = Sim_GetMicros() - start;
+  while (Sampler_IsInitializing())
+  {
+    uint64_t loopStart = Sim_GetMicros();
+    Project_Loop();
+    blocked = Sim_GetMicros() - loopStart > blocked ? Sim_GetMicros() - loopStart : blocked;
+    Sim_AdvanceMicros(BENCH_LOOP_TIME_US);
+  }
+  bool isInitialized = Project_IsBme280Initialized;
+  uint64_t init = Sim_GetMicros() - start;
+  bytes = Sim_I2cGetTransferredBytes() - bytes;
+
+  Sampler_Sample sample;
+  uint16_t frames = 0;
+  while ((!Sampler_GetFresh(0, &sample) || sample.status != SAMPLER_STATUS_OK) && ++frames < 1000)
+    Bench_RunFrame();
+  bool isValid = isInitialized && frames < 1000 && sample.rawData.temperature != 0x80000;
+
+  printf("%-24s %10.1f %10.2f %10lu %12.1f %8s\n", name, (double) init / 1000.0, (double) blocked / 1000.0,
+    (unsigned long) bytes, (double) (Sim_GetMicros() - start) / 1000.0, isValid ? "Yes" : "No");
+  Project_Bme280Config = config;
+}
+
+/**
+ * @brief Benchmarks the settings store: the flash wear and the simulated flash busy time per setting change, and the
+ *   boot scan and read costs with the record log filled up to the sector end.
+ */
+static void Bench_RunStore()
+{
+  uint32_t erases = Sim_FlashGetEraseCount();
+  uint32_t words = Sim_FlashGetProgramCount();
+  uint64_t micros = Sim_GetMicros();
+  uint32_t period = 0;
+  bool isOk = true;
+
+  for (uint32_t index = 0; index < BENCH_STORE_WRITES; index++)
+  {
+    uint8_t value[4];
+    Frame_PutUint32(value, ++period);
+    isOk &= Store_Put(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+  }
+
+  erases = Sim_FlashGetEraseCount() - erases;
+  words = Sim_FlashGetProgramCount() - words;
+  micros = Sim_GetMicros() - micros;
+
+  // Filling the log up to the sector end for the worst-case boot scan.
+  while (Store_GetFreeSpace() >= 8)
+  {
+    uint8_t value[4];
+    Frame_PutUint32(value, ++period);
+    isOk &= Store_Put(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+  }
+
+  uint64_t start = Bench_GetCycles();
+  Store_Init();
+  double scanCycles = (double) (Bench_GetCycles() - start);
+
+  uint8_t value[4] = {0};
+  start = Bench_GetCycles();
+  for (uint32_t index = 0; index < BENCH_PASSES; index++)
+    isOk &= Store_Get(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+  double getCycles = (double) (Bench_GetCycles() - start) / BENCH_PASSES;
+  isOk &= Frame_GetUint32(value) == period;
+
+  printf("%10u %10u %12.1f %12.1f %12.1f %12.0f %10.0f %8s\n", BENCH_STORE_WRITES, erases,
+    erases > 0 ? (double) BENCH_STORE_WRITES / erases : 0.0, (double) words / BENCH_STORE_WRITES,
+    (double) micros / BENCH_STORE_WRITES, scanCycles, getCycles, isOk ? "Yes" : "No");
+}
+
+/**
+ * @brief Checks the sampling period restored on boot when the stored one is out of the range accepted by the
+ *   <i>Config</i> command: the default one must be kept instead.
+ */
+static void Bench_RunStoreInvalidPeriod()
+{
+  static const uint32_t periods[] = {0, SAMPLER_MAX_PERIOD + 1, UINT32_MAX};
+  uint32_t count = sizeof(periods) / sizeof(periods[0]);
+  uint32_t erases = Sim_FlashGetEraseCount();
+  uint32_t restored = 0;
+
+  for (uint32_t index = 0; index < count; index++)
+  {
+    uint8_t value[4];
+    Frame_PutUint32(value, periods[index]);
+    Store_Put(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+    while (!Sampler_IsIdle())
+      Bench_RunFrame();
+
+    // Booting again with the defaults.
+    Sampler_SetDefaultPeriod(CONFIG_SAMPLING_PERIOD);
+    Sampler_SetPeriod(CONFIG_SAMPLING_PERIOD);
+    Project_PostInit();
+    while (Sampler_IsInitializing())
+      Bench_RunFrame();
+    restored += Sampler_GetDefaultPeriod() == CONFIG_SAMPLING_PERIOD;
+  }
+
+  printf("%-24s %10u %10u %10lu\n", "Invalid sampling period", count, restored,
+    (unsigned long) (Sim_FlashGetEraseCount() - erases));
+}
+
+/**
+ * @brief Benchmarks the settings store recovery from a power loss during the compaction: the compaction is interrupted
+ *   after every number of the words programmed, and the store is scanned again as on boot. The value stored before
+ *   the interrupted change or the changed one must be restored.
+ */
+static void Bench_RunStorePowerLoss()
+{
+  uint32_t erases = Sim_FlashGetEraseCount();
+  uint32_t restored = 0;
+  uint8_t value[4] = {0};
+  Store_Get(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+  uint32_t period = Frame_GetUint32(value);
+
+  for (uint32_t limit = 0; limit < BENCH_STORE_POWER_LOSSES; limit++)
+  {
+
+    // Filling the log up to the sector end, so that the next change compacts it.
+    while (Store_GetFreeSpace() >= 8)
+    {
+      Frame_PutUint32(value, ++period);
+      Store_Put(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+    }
+
+    uint32_t previous = period;
+    Frame_PutUint32(value, ++period);
+    Sim_FlashSetProgramLimit(limit);
+    Store_Put(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value));
+    Sim_FlashSetProgramLimit(UINT32_MAX);
+
+    Store_Init();
+    if (Store_Get(STORE_KEY_SAMPLING_PERIOD, value, sizeof(value)) &&
+      (Frame_GetUint32(value) == previous || Frame_GetUint32(value) == period))
+      restored++;
+    period = Frame_GetUint32(value);
+  }
+
+  printf("%-24s %10u %10u %10lu\n", "Power loss on compaction", BENCH_STORE_POWER_LOSSES, restored,
+    (unsigned long) (Sim_FlashGetEraseCount() - erases));
+}
+
+/**
+ * @brief The snapshot benchmark case interrupting the main context from the signal handler.
+ */
+typedef enum Bench_SnapshotCase
+{
+  /**
+   * @brief The writer publishing the samples interrupts the readers.
+   */
+  BENCH_SNAPSHOT_WRITER_INTERRUPTS,
+
+  /**
+   * @brief The readers interrupt the writer publishing the samples.
+   */
+  BENCH_SNAPSHOT_READER_INTERRUPTS,
+
+  /**
+   * @brief The writer interrupts the readers copying the sample without the sequence check. Shows that the torn
+   *   copies are caught by the consistency check.
+   */
+  BENCH_SNAPSHOT_UNPROTECTED
+} Bench_SnapshotCase;
+
+/**
+ * @brief The current snapshot benchmark case.
+ */
+static volatile Bench_SnapshotCase Bench_CurrentSnapshotCase;
+
+/**
+ * @brief The number of the samples written by the snapshot benchmark.
+ */
+static volatile uint32_t Bench_SnapshotWrites;
+
+/**
+ * @brief The number of the samples read by the snapshot benchmark.
+ */
+static volatile uint32_t Bench_SnapshotReads;
+
+/**
+ * @brief The number of the inconsistent samples read by the snapshot benchmark.
+ */
+static volatile uint32_t Bench_SnapshotMismatches;
+
+/**
+ * @brief The number of the signals received by the snapshot benchmark.
+ */
+static volatile uint32_t Bench_SnapshotSignals;
+
+/**
+ * @brief The sample copied without the sequence check by the unprotected snapshot benchmark case.
+ */
+static volatile Sampler_Sample Bench_UnprotectedSample;
+
+/**
+ * @brief Makes a self-consistent sample: all its fields are derived from the single counter value.
+ * @param counter The counter value.
+ * @param sample The output sample.
+ */
+static void Bench_MakeSnapshotSample(uint32_t counter, Sampler_Sample *sample)
+{
+  sample->rawData.pressure = (int32_t) (counter & 0xFFFFF);
+  sample->rawData.temperature = (int32_t) (~counter & 0xFFFFF);
+  sample->rawData.humidity = (int32_t) ((counter * 7) & 0xFFFF);
+  sample->timestamp = counter;
+  sample->status = SAMPLER_STATUS_OK;
+  sample->result = (I2C_Result) (counter & 1);
+}
+
+/**
+ * @brief Checks that all the sample fields are derived from the same counter value.
+ * @param sample The sample to check.
+ */
+static void Bench_CheckSnapshotSample(const Sampler_Sample *sample)
+{
+  Sampler_Sample expected;
+  Bench_MakeSnapshotSample(sample->timestamp, &expected);
+  Bench_SnapshotReads++;
+  if (memcmp(&sample->rawData, &expected.rawData, sizeof(expected.rawData)) != 0 || sample->status != expected.status ||
+    sample->result != expected.result)
+    Bench_SnapshotMismatches++;
+}
+
+/**
+ * @brief Writes the next sample.
+ */
+static void Bench_WriteSnapshotSample()
+{
+  Sampler_Sample sample;
+  Bench_MakeSnapshotSample(++Bench_SnapshotWrites, &sample);
+  if (Bench_CurrentSnapshotCase == BENCH_SNAPSHOT_UNPROTECTED)
+  {
+    Bench_UnprotectedSample.rawData = sample.rawData;
+    Bench_UnprotectedSample.timestamp = sample.timestamp;
+    Bench_UnprotectedSample.status = sample.status;
+    Bench_UnprotectedSample.result = sample.result;
+  }
+  else
+    Sampler_Publish(&sample);
+}
+
+/**
+ * @brief Reads the latest sample and checks it.
+ */
+static void Bench_ReadSnapshotSample()
+{
+  Sampler_Sample sample;
+  if (Bench_CurrentSnapshotCase == BENCH_SNAPSHOT_UNPROTECTED)
+  {
+    sample.rawData = Bench_UnprotectedSample.rawData;
+    sample.timestamp = Bench_UnprotectedSample.timestamp;
+    sample.status = Bench_UnprotectedSample.status;
+    sample.result = Bench_UnprotectedSample.result;
+  }
+  else if (!Sampler_GetLatest(&sample))
+    return;
+
+  Bench_CheckSnapshotSample(&sample);
+}
+
+/**
+ * @brief The signal handler preempting the main context like an interrupt does on the target.
+ */
+static void Bench_HandleSnapshotSignal(__unused int signal)
+{
+  Bench_SnapshotSignals++;
+  if (Bench_CurrentSnapshotCase == BENCH_SNAPSHOT_READER_INTERRUPTS)
+    Bench_ReadSnapshotSample();
+  else
+    Bench_WriteSnapshotSample();
+}
+
+/**
+ * @brief Benchmarks the latest sample snapshot consistency: the self-consistent samples are written and read in the
+ *   main context while being preempted by the periodic timer signal running the other side, so that the signal lands
+ *   in the middle of the sample copying, and every sample read is checked for the torn values.
+ * @param name The benchmark name.
+ * @param snapshotCase The benchmark case.
+ */
+static void Bench_RunSnapshot(const char *name, Bench_SnapshotCase snapshotCase)
+{
+  Bench_CurrentSnapshotCase = snapshotCase;
+  Bench_SnapshotWrites = 0;
+  Bench_SnapshotReads = 0;
+  Bench_SnapshotMismatches = 0;
+  Bench_SnapshotSignals = 0;
+
+  // Publishing the first sample so that the readers interrupting the writer have a sample to read from the start.
+  Bench_WriteSnapshotSample();
+
+  struct sigaction action = {.sa_handler = Bench_HandleSnapshotSignal, .sa_flags = SA_RESTART};
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGALRM, &action, NULL);
+  struct itimerval timer = {
+    .it_interval = {.tv_sec = 0, .tv_usec = BENCH_SNAPSHOT_SIGNAL_INTERVAL},
+    .it_value = {.tv_sec = 0, .tv_usec = BENCH_SNAPSHOT_SIGNAL_INTERVAL}
+  };
+  setitimer(ITIMER_REAL, &timer, NULL);
+
+  // Counting the main context operations overlapped by a signal, limiting the run time if the signals are slow.
+  uint32_t overlapped = 0;
+  time_t deadline = time(NULL) + 10;
+  while (Bench_SnapshotSignals < BENCH_SNAPSHOT_SIGNALS && time(NULL) < deadline)
+  {
+    uint32_t signals = Bench_SnapshotSignals;
+    if (snapshotCase == BENCH_SNAPSHOT_READER_INTERRUPTS)
+      Bench_WriteSnapshotSample();
+    else
+      Bench_ReadSnapshotSample();
+    overlapped += Bench_SnapshotSignals != signals;
+  }
+
+  timer = (struct itimerval) {0};
+  setitimer(ITIMER_REAL, &timer, NULL);
+  signal(SIGALRM, SIG_DFL);
+
+  printf("%-24s %10u %10u %10u %10u\n", name, Bench_SnapshotReads, Bench_SnapshotWrites, overlapped,
+    Bench_SnapshotMismatches);
+}
+
+/**
+ * @brief Benchmarks the command throughput over the simulated CDC interface, one OUT packet per USB frame.
+ * @param name The benchmark name.
+ * @param command The command message or frame including its terminating delimiter.
+ * @param commandLength The command length in bytes.
+ * @param commandsPerPacket The number of commands sent in a single OUT packet.
+ * @param waitResponses If <i>true</i>, the next packet is sent only after all the responses have been received
+ *   (stop-and-wait), otherwise the packets are sent in every frame (pipelining).
+ */
+static void Bench_RunPipeline(const char *name, const char *command, uint16_t commandLength,
+  uint16_t commandsPerPacket, bool waitResponses)
+{
+  char packet[CDC_DATA_FS_MAX_PACKET_SIZE];
+  for (uint16_t index = 0; index < commandsPerPacket; index++)
+    memcpy(&packet[index * commandLength], command, commandLength);
+
+  // Settling the previous runs.
+  for (uint16_t frame = 0; frame < 10; frame++)
+    Bench_RunFrame();
+
+  Bench_Responses = 0;
+  Bench_ResponseBytes = 0;
+  Bench_ResponseErrors = 0;
+  uint32_t sent = 0;
+  uint32_t packets = Sim_CdcGetPacketCount();
+  uint64_t micros = Sim_GetMicros();
+  uint64_t start = Bench_GetCycles();
+
+  while (Bench_Responses < BENCH_COMMANDS)
+  {
+    if (sent < BENCH_COMMANDS && (!waitResponses || Bench_Responses == sent))
+    {
+      Project_CdcMessageReceived(packet, commandsPerPacket * commandLength);
+      sent += commandsPerPacket;
+    }
+    Bench_RunFrame();
+  }
+
+  double cycles = (double) (Bench_GetCycles() - start) / BENCH_COMMANDS;
+  double seconds = (double) (Sim_GetMicros() - micros) / 1000000.0;
+  packets = Sim_CdcGetPacketCount() - packets;
+
+  printf("%-24s %10.0f %10.2f %10.1f %12.0f %8u\n", name, BENCH_COMMANDS / seconds,
+    (double) packets / BENCH_COMMANDS, (double) Bench_ResponseBytes / BENCH_COMMANDS, cycles, Bench_ResponseErrors);
+}
+
+/**
+ * @brief Checks that the responses are transmitted again after a USB bus reset dropping the response in flight.
+ */
+static void Bench_RunBusReset()
+{
+  uint32_t recovered = 0;
+  for (uint16_t index = 0; index < BENCH_BUS_RESETS; index++)
+  {
+    // The response is queued and its transmission is started by a single main loop pass.
+    Project_CdcMessageReceived("Id\n", 3);
+    Project_Loop();
+    Sim_CdcBusReset();
+
+    Bench_Responses = 0;
+    Bench_ResponseErrors = 0;
+    Bench_ResponseLength = 0;
+    Project_CdcMessageReceived("Id\n", 3);
+    for (uint16_t frame = 0; frame < 10; frame++)
+      Bench_RunFrame();
+    recovered += Bench_Responses == 1 && Bench_ResponseErrors == 0 && TransmitQueue_IsEmpty();
+  }
+
+  printf("\nUSB bus reset with a response in flight (%d resets, %u recovered)\n", BENCH_BUS_RESETS, recovered);
+}
+
+/**
+ * @brief The host benchmark entry point.
+ */
+int main()
+{
+  Bench_Prepare();
+
+  printf("Compensation (%d samples, max errors against the double-precision reference)\n", BENCH_SAMPLES);
+  printf("%-24s %10s %14s %14s %14s\n", "Engine", "Cycles", "T, degC", "P, Pa", "H, %");
+  Bench_RunCompensation("Float (unprepared)", Bench_CompensateUnprepared);
+  Bench_RunCompensation("Float", BME280_CompensateFloat);
+  Bench_RunCompensation("Int32", BME280_CompensateInt32);
+  Bench_RunCompensation("Int64", BME280_CompensateInt64);
+
+  Bench_RunParsing();
+  Bench_RunLookup();
+  Bench_RunNumberFormat();
+  Bench_RunBatch();
+  Bench_RunBatchArrays();
+  Bench_RunBursts();
+  Bench_RunFramePacking();
+
+  Project_PreInit();
+  MX_GPIO_Init();
+  MX_I2C1_Init();
+  Project_PostInit();
+  Sim_CdcSetOutput(Bench_CountResponses);
+
+  // The noiseless simulated sensor would let the adaptive oversampling switch to the x1 one, so it is used only by
+  // its own benchmark to keep the others comparable.
+  Oversampling_SetEnabled(false);
+  Bench_RunChannels();
+
+  uint16_t commandLength = sizeof(BENCH_COMMAND) - 1;
+  uint16_t commandsPerPacket = CDC_DATA_FS_MAX_PACKET_SIZE / commandLength;
+  printf("\nCommand throughput (%d x \"%.*s\", one OUT packet per 1 ms USB frame)\n", BENCH_COMMANDS,
+    (int) sizeof(BENCH_COMMAND) - 2, BENCH_COMMAND);
+  printf("%-24s %10s %10s %10s %12s %8s\n", "Mode", "Cmd/s", "IN pkt/cmd", "IN B/cmd", "Cycles/cmd", "Errors");
+  Bench_RunPipeline("Stop-and-wait", BENCH_COMMAND, commandLength, 1, true);
+  Bench_RunPipeline("Pipelined, 1 per packet", BENCH_COMMAND, commandLength, 1, false);
+  Bench_RunPipeline("Pipelined, full packets", BENCH_COMMAND, commandLength, commandsPerPacket, false);
+
+  // The same Measure command as a binary frame.
+  uint8_t request[FRAME_HEADER_LENGTH + FRAME_CRC_LENGTH] = {COMMAND_ID_MEASURE, 0};
+  uint8_t frame[FRAME_ENCODED_LENGTH(sizeof(request))];
+  uint16_t crc = Frame_GetCrc(request, FRAME_HEADER_LENGTH);
+  request[FRAME_HEADER_LENGTH] = (uint8_t) crc;
+  request[FRAME_HEADER_LENGTH + 1] = (uint8_t) (crc >> 8);
+  uint16_t frameLength = Frame_Encode(request, sizeof(request), frame);
+
+  // Limiting the commands per packet by the command queue length, as the excessive ones would be dropped.
+  Bench_SetBinaryMode(true);
+  commandsPerPacket = CDC_DATA_FS_MAX_PACKET_SIZE / frameLength;
+  commandsPerPacket = commandsPerPacket < CONFIG_COMMAND_QUEUE_LENGTH ? commandsPerPacket : CONFIG_COMMAND_QUEUE_LENGTH;
+  Bench_RunPipeline("Binary, stop-and-wait", (const char *) frame, frameLength, 1, true);
+  Bench_RunPipeline("Binary, full packets", (const char *) frame, frameLength, commandsPerPacket, false);
+  Bench_SetBinaryMode(false);
+  Bench_RunBusReset();
+
+  // The real sensor data are never steady, so the new samples are told by the changed values, except the steady row.
+  printf("\nSample streaming (1000 USB frames, quiet noise trace)\n");
+  printf("%-24s %10s %10s %10s %10s %12s %8s %8s %8s\n", "Mode", "Rate, Hz", "Samples", "Smp/s", "IN B/smp",
+    "Cycles/smp", "Errors", "Dropped", "Repeats");
+  Bench_RunStream("Text, steady", 100);
+  Sim_Bme280SetNoise(&Bench_NoiseTrace[0].noise);
+  Bench_RunStream("Text", 20);
+  Bench_RunStream("Text", 100);
+  Bench_RunStream("Text, max", Stream_GetMaxRate());
+  Bench_SetBinaryMode(true);
+  Bench_RunStream("Binary", 20);
+  Bench_RunStream("Binary", 100);
+  Bench_RunStream("Binary, max", Stream_GetMaxRate());
+  Bench_SetBinaryMode(false);
+  Sim_Bme280SetNoise(&(Sim_Bme280Noise) {0});
+
+  printf("\nNormal mode background sampling of steady values (polled every 1 ms for 2000 ms, adaptive oversampling)\n");
+  printf("%-24s %12s %10s %10s %10s\n", "Mode", "Conversions", "History", "Noise smp", "Duplicates");
+  Bench_RunSteadySampling("Normal x16", BME280_PRESSURE_OVERSAMPLING_16);
+  Bench_RunSteadySampling("Normal x1", BME280_PRESSURE_OVERSAMPLING_1);
+
+  printf("\nHistory readout (%lu bytes reserved, %lu samples)\n", (unsigned long) SIM_HISTORY_SIZE,
+    (unsigned long) History_GetCapacity());
+  printf("%-24s %10s %10s %10s %12s %8s\n", "Mode", "Samples", "Smp/s", "IN B/smp", "Cycles/smp", "Errors");
+  Bench_RunHistory("Text");
+  Bench_SetBinaryMode(true);
+  Bench_RunHistory("Binary");
+  Bench_SetBinaryMode(false);
+
+  printf("\nOn-demand measurements (%d commands every %d ms, background sampling every 1 s)\n",
+    BENCH_ON_DEMAND_REQUESTS, BENCH_ON_DEMAND_GAP);
+  printf("%-24s %10s %10s %10s\n", "Mode", "Delay, ms", "Age, ms", "Active, %");
+  Sampler_SetPeriod(1000);
+  Bench_RunOnDemand("Normal, latest", BME280_MODE_NORMAL, "All");
+  Bench_RunOnDemand("Forced, latest", BME280_MODE_FORCED, "All");
+  Bench_RunOnDemand("Forced, max age 500", BME280_MODE_FORCED, "All 500");
+  Bench_RunOnDemand("Forced, max age 100", BME280_MODE_FORCED, "All 100");
+  Bench_RunOnDemand("Forced, max age 0", BME280_MODE_FORCED, "All 0");
+  Sampler_SetPeriod(CONFIG_SAMPLING_PERIOD);
+
+  printf("\nAdaptive oversampling (back-to-back forced measurements, RMS errors over the last %d s of each phase)\n",
+    BENCH_NOISE_PHASE_LENGTH / 2000);
+  printf("%-12s %-11s %10s %10s %10s %10s  %s\n", "Trace", "Mode", "Smp/s", "P, Pa", "T, degC", "H, %",
+    "P/T/H oversampling, filter");
+  Bench_RunOversampling("Fixed x16", false);
+  Bench_RunOversampling("Adaptive", true);
+
+  // The different device calibration makes the first initialization of each mode a cold one.
+  Sim_Bme280Calibration calibration = Sim_Bme280DefaultCalibration;
+  calibration.t1++;
+  printf("\nSensor initialization after power-on (first sample requested right after it)\n");
+  printf("%-24s %10s %10s %10s %12s %8s\n", "Mode", "Init, ms", "Block, ms", "I2C bytes", "1st smp, ms", "Valid");
+  Bench_RunBoot("Normal x16, new sensor", BME280_MODE_NORMAL, BME280_PRESSURE_OVERSAMPLING_16, &calibration);
+  Bench_RunBoot("Normal x16, same sensor", BME280_MODE_NORMAL, BME280_PRESSURE_OVERSAMPLING_16, &calibration);
+  Bench_RunBoot("Normal x1, same sensor", BME280_MODE_NORMAL, BME280_PRESSURE_OVERSAMPLING_1, &calibration);
+  Bench_RunBoot("Forced x16, new sensor", BME280_MODE_FORCED, BME280_PRESSURE_OVERSAMPLING_16, NULL);
+  Bench_RunBoot("Forced x16, same sensor", BME280_MODE_FORCED, BME280_PRESSURE_OVERSAMPLING_16, NULL);
+  Bench_RunBoot("Forced x1, same sensor", BME280_MODE_FORCED, BME280_PRESSURE_OVERSAMPLING_1, NULL);
+  printf("\nSettings store (%lu bytes reserved, 4-byte value changes)\n", (unsigned long) SIM_STORE_SIZE);
+  printf("%10s %10s %12s %12s %12s %12s %10s %8s\n", "Writes", "Erases", "Writes/erase", "Words/write",
+    "Flash us/wr", "Scan cycles", "Get cycles", "Restored");
+  Bench_RunStore();
+  printf("%-24s %10s %10s %10s\n", "Case", "Changes", "Restored", "Erases");
+  Bench_RunStorePowerLoss();
+  Bench_RunStoreInvalidPeriod();
+
+  // Run last, as the samples published by it replace the sampler ones.
+  printf("\nLatest sample snapshot (a %d us timer signal preempting the main context like an interrupt, %d signals)\n",
+    BENCH_SNAPSHOT_SIGNAL_INTERVAL, BENCH_SNAPSHOT_SIGNALS);
+  printf("%-24s %10s %10s %10s %10s\n", "Case", "Reads", "Writes", "Overlapped", "Torn");
+  Bench_RunSnapshot("Writer interrupts", BENCH_SNAPSHOT_WRITER_INTERRUPTS);
+  Bench_RunSnapshot("Reader interrupts", BENCH_SNAPSHOT_READER_INTERRUPTS);
+  Bench_RunSnapshot("Unprotected copy", BENCH_SNAPSHOT_UNPROTECTED);
+
+  return 0;
+}
@@ -0,0 +1,322 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+
+#include "bme280_batch.h"
+
+/**
+ * @brief Builds the structure-of-arrays compensation for several instruction sets selected at run time, if supported
+ *   by the compiler and the platform.
+ */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && defined(__linux__)
+#define BME280_BATCH_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define BME280_BATCH_TARGET_CLONES
+#endif
+
+/**
+ * @brief Decodes the calibration data block returned by the <i>Calib</i> command and prepares the floating-point
+ *   compensation coefficients the same way the firmware does.
+ * @param data A pointer to the <i>BME280_BATCH_CALIBRATION_LENGTH</i> bytes of the calibration data.
+ * @param calibration A pointer to the structure that will be filled with the decoded calibration data.
+ */
+void BME280Batch_ParseCalibration(const uint8_t *data, BME280Batch_Calibration *calibration)
+{
+  int32_t *digT = calibration->digT;
+  int32_t *digP = calibration->digP;
+  int32_t *digH = calibration->digH;
+
+  digT[0] = (uint16_t) (data[0] | data[1] << 8);
+  for (uint8_t index = 1; index < 3; index++)
+    digT[index] = (int16_t) (data[2 * index] | data[2 * index + 1] << 8);
+
+  digP[0] = (uint16_t) (data[6] | data[7] << 8);
+  for (uint8_t index = 1; index < 9; index++)
+    digP[index] = (int16_t) (data[6 + 2 * index] | data[7 + 2 * index] << 8);
+
+  digH[0] = (uint8_t) data[25];
+  digH[1] = (int16_t) (data[26] | data[27] << 8);
+  digH[2] = (uint8_t) data[28];
+  digH[3] = (int16_t) (data[29] << 4 | (data[30] & 0x0F));
+  digH[4] = (int16_t) (data[30] >> 4 | data[31] << 4);
+  digH[5] = (int8_t) data[32];
+
+  calibration->t[0] = (float) (16 * digT[0]);
+  calibration->t[1] = (float) digT[1] / 16384.0F;
+  calibration->t[2] = (float) digT[2] / 17179869184.0F;
+
+  calibration->p[0] = (float) (digP[3] * 16 - 1048576);
+  calibration->p[1] = (float) digP[4] / 8192.0F;
+  calibration->p[2] = (float) digP[5] / 536870912.0F;
+  calibration->p[3] = (float) digP[0];
+  calibration->p[4] = (float) digP[0] * (float) digP[1] / 17179869184.0F;
+  calibration->p[5] = (float) digP[0] * (float) digP[2] / 9007199254740992.0F;
+  calibration->p[6] = (float) digP[6] / 16.0F;
+  calibration->p[7] = 1.0F + (float) digP[7] / 524288.0F;
+  calibration->p[8] = (float) digP[8] / 34359738368.0F;
+
+  calibration->h[0] = (float) (digH[3] * 64);
+  calibration->h[1] = -(float) digH[4] / 16384.0F;
+  calibration->h[2] = (float) digH[1] / 65536.0F;
+  calibration->h[3] = (float) digH[1] * (float) digH[5] / 4398046511104.0F;
+  calibration->h[4] = (float) digH[1] * (float) digH[5] * (float) digH[2] / 295147905179352825856.0F;
+  calibration->h[5] = -(float) digH[0] / 524288.0F;
+}
+
+/**
+ * @brief Compensates a sample using the single-precision floating-point formulas with the prepared coefficients.
+ */
+static inline void BME280Batch_CompensateFloat(const BME280Batch_Calibration *c, const BME280Batch_RawData *rawData,
+  BME280Batch_Measurement *measurement)
+{
+  const float *t = c->t;
+  const float *p = c->p;
+  const float *h = c->h;
+
+  float dT = (float) rawData->temperature - t[0];
+  float tFine = dT * (t[1] + dT * t[2]);
+  measurement->temperature = tFine * (1.0F / 5120.0F);
+
+  float v = tFine * 0.5F - 64000.0F;
+  float divisor = p[3] + v * (p[4] + v * p[5]);
+  if (divisor != 0.0F)
+  {
+    float x = ((float) rawData->pressure + (p[0] + v * (p[1] + v * p[2]))) * (-6250.0F / divisor);
+    measurement->pressure = p[6] + x * (p[7] + x * p[8]);
+  }
+  else
+    measurement->pressure = 0;
+
+  float dH = tFine - 76800.0F;
+  float humidity = ((float) rawData->humidity - h[0] + dH * h[1]) * (h[2] + dH * (h[3] + dH * h[4]));
+  humidity = humidity * (1.0F + humidity * h[5]);
+  measurement->humidity = humidity > 100.0F ? 100.0F : humidity < 0.0F ? 0.0F : humidity;
+}
+
+/**
+ * @brief Calculates the fine resolution temperature value shared by the integer formulas.
+ */
+static inline int32_t BME280Batch_GetFineTemperature(const BME280Batch_Calibration *c, int32_t adcT)
+{
+  int32_t var1 = (((adcT >> 3) - (c->digT[0] << 1)) * c->digT[1]) >> 11;
+  int32_t var2 = (((((adcT >> 4) - c->digT[0]) * ((adcT >> 4) - c->digT[0])) >> 12) * c->digT[2]) >> 14;
+  return var1 + var2;
+}
+
+/**
+ * @brief Calculates the humidity in the Q22.10 format using the 32-bit integer formula.
+ */
+static inline uint32_t BME280Batch_GetHumidityInt32(const BME280Batch_Calibration *c, int32_t adcH, int32_t tFine)
+{
+  int32_t h = tFine - 76800;
+  h = (((adcH << 14) - (c->digH[3] << 20) - c->digH[4] * h + 16384) >> 15) *
+    (((((((h * c->digH[5]) >> 10) * (((h * c->digH[2]) >> 11) + 32768)) >> 10) + 2097152) * c->digH[1] + 8192) >> 14);
+  h = h - (((((h >> 15) * (h >> 15)) >> 7) * c->digH[0]) >> 4);
+  h = h < 0 ? 0 : h;
+  h = h > 419430400 ? 419430400 : h;
+  return (uint32_t) (h >> 12);
+}
+
+/**
+ * @brief Calculates the pressure in Pa using the 32-bit integer formula.
+ */
+static inline float BME280Batch_GetPressureInt32(const BME280Batch_Calibration *c, int32_t adcP, int32_t tFine)
+{
+  const int32_t *digP = c->digP;
+
+  int32_t var1 = (tFine >> 1) - 64000;
+  int32_t var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * digP[5];
+  var2 = var2 + ((var1 * digP[4]) << 1);
+  var2 = (var2 >> 2) + (digP[3] << 16);
+  var1 = (((digP[2] * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((digP[1] * var1) >> 1)) >> 18;
+  var1 = ((32768 + var1) * digP[0]) >> 15;
+  if (var1 == 0)
+    return 0;
+
+  uint32_t p = ((uint32_t) (1048576 - adcP) - (var2 >> 12)) * 3125;
+  p = p < 0x80000000 ? (p << 1) / (uint32_t) var1 : (p / (uint32_t) var1) * 2;
+  var1 = (digP[8] * (int32_t) (((p >> 3) * (p >> 3)) >> 13)) >> 12;
+  var2 = ((int32_t) (p >> 2) * digP[7]) >> 13;
+  return (float) (uint32_t) ((int32_t) p + ((var1 + var2 + digP[6]) >> 4));
+}
+
+/**
+ * @brief Calculates the pressure in Pa using the 64-bit integer formula.
+ */
+static inline float BME280Batch_GetPressureInt64(const BME280Batch_Calibration *c, int32_t adcP, int32_t tFine)
+{
+  const int32_t *digP = c->digP;
+
+  int64_t var1 = (int64_t) tFine - 128000;
+  int64_t var2 = var1 * var1 * digP[5];
+  var2 = var2 + ((var1 * digP[4]) << 17);
+  var2 = var2 + ((int64_t) digP[3] << 35);
+  var1 = ((var1 * var1 * digP[2]) >> 8) + ((var1 * digP[1]) << 12);
+  var1 = ((((int64_t) 1 << 47) + var1) * digP[0]) >> 33;
+  if (var1 == 0)
+    return 0;
+
+  int64_t p = 1048576 - adcP;
+  p = (((p << 31) - var2) * 3125) / var1;
+  var1 = (digP[8] * (p >> 13) * (p >> 13)) >> 25;
+  var2 = (digP[7] * p) >> 19;
+  p = ((p + var1 + var2) >> 8) + ((int64_t) digP[6] << 4);
+  return (float) (uint32_t) p / 256.0F;
+}
+
+/**
+ * @brief Compensates a sample using the 32-bit integer formulas.
+ */
+static inline void BME280Batch_CompensateInt32(const BME280Batch_Calibration *c, const BME280Batch_RawData *rawData,
+  BME280Batch_Measurement *measurement)
+{
+  int32_t tFine = BME280Batch_GetFineTemperature(c, rawData->temperature);
+  measurement->temperature = (float) ((tFine * 5 + 128) >> 8) / 100.0F;
+  measurement->pressure = BME280Batch_GetPressureInt32(c, rawData->pressure, tFine);
+  measurement->humidity = (float) BME280Batch_GetHumidityInt32(c, rawData->humidity, tFine) / 1024.0F;
+}
+
+/**
+ * @brief Compensates a sample using the 32-bit integer formulas and the 64-bit integer pressure formula.
+ */
+static inline void BME280Batch_CompensateInt64(const BME280Batch_Calibration *c, const BME280Batch_RawData *rawData,
+  BME280Batch_Measurement *measurement)
+{
+  int32_t tFine = BME280Batch_GetFineTemperature(c, rawData->temperature);
+  measurement->temperature = (float) ((tFine * 5 + 128) >> 8) / 100.0F;
+  measurement->pressure = BME280Batch_GetPressureInt64(c, rawData->pressure, tFine);
+  measurement->humidity = (float) BME280Batch_GetHumidityInt32(c, rawData->humidity, tFine) / 1024.0F;
+}
+
+/**
+ * @brief Compensates the samples in bulk. The engine is selected once for the whole batch.
+ * @param calibration A pointer to the calibration data decoded by the <i>BME280Batch_ParseCalibration</i> function.
+ * @param engine The compensation engine the firmware is configured with (see <i>CONFIG_COMPENSATION</i>).
+ * @param rawData The uncompensated samples.
+ * @param measurements The output array of the compensated samples.
+ * @param count The number of samples.
+ */
+void BME280Batch_Compensate(const BME280Batch_Calibration *calibration, BME280Batch_Engine engine,
+  const BME280Batch_RawData *rawData, BME280Batch_Measurement *measurements, size_t count)
+{
+  switch (engine)
+  {
+    case BME280_BATCH_ENGINE_INT32:
+      for (size_t index = 0; index < count; index++)
+        BME280Batch_CompensateInt32(calibration, &rawData[index], &measurements[index]);
+      break;
+    case BME280_BATCH_ENGINE_INT64:
+      for (size_t index = 0; index < count; index++)
+        BME280Batch_CompensateInt64(calibration, &rawData[index], &measurements[index]);
+      break;
+    default:
+      for (size_t index = 0; index < count; index++)
+        BME280Batch_CompensateFloat(calibration, &rawData[index], &measurements[index]);
+      break;
+  }
+}
+
+/**
+ * @brief Compensates a block of samples using the single-precision floating-point formulas. The loop has no branches,
+ *   so that it is vectorized, and performs the same operations in the same order as the per-sample formulas.
+ */
+static inline void BME280Batch_CompensateFloatBlock(const BME280Batch_Calibration *c, const int32_t *restrict adcP,
+  const int32_t *restrict adcT, const int32_t *restrict adcH, float *restrict pressure, float *restrict temperature,
+  float *restrict humidity, size_t count)
+{
+  // Copying the coefficients, so that the compiler does not have to assume the output arrays alias them.
+  float t[3], p[9], h[6];
+  memcpy(t, c->t, sizeof(t));
+  memcpy(p, c->p, sizeof(p));
+  memcpy(h, c->h, sizeof(h));
+
+  for (size_t index = 0; index < count; index++)
+  {
+    float dT = (float) adcT[index] - t[0];
+    float tFine = dT * (t[1] + dT * t[2]);
+    temperature[index] = tFine * (1.0F / 5120.0F);
+
+    float v = tFine * 0.5F - 64000.0F;
+    float divisor = p[3] + v * (p[4] + v * p[5]);
+    float x = ((float) adcP[index] + (p[0] + v * (p[1] + v * p[2]))) * (-6250.0F / divisor);
+    pressure[index] = divisor != 0.0F ? p[6] + x * (p[7] + x * p[8]) : 0.0F;
+
+    float dH = tFine - 76800.0F;
+    float value = ((float) adcH[index] - h[0] + dH * h[1]) * (h[2] + dH * (h[3] + dH * h[4]));
+    value = value * (1.0F + value * h[5]);
+    value = value > 100.0F ? 100.0F : value;
+    humidity[index] = value < 0.0F ? 0.0F : value;
+  }
+}
+
+/**
+ * @brief Computes the fine resolution temperatures and the temperatures of a block of samples using the integer
+ *   formula, and then the humidities. Both loops use 32-bit integer arithmetic only, so that they are vectorized.
+ */
+static inline void BME280Batch_CompensateInt32Block(const BME280Batch_Calibration *c, const int32_t *restrict adcT,
+  const int32_t *restrict adcH, int32_t *restrict tFine, float *restrict temperature, float *restrict humidity,
+  size_t count)
+{
+  for (size_t index = 0; index < count; index++)
+  {
+    tFine[index] = BME280Batch_GetFineTemperature(c, adcT[index]);
+    temperature[index] = (float) ((tFine[index] * 5 + 128) >> 8) / 100.0F;
+  }
+
+  for (size_t index = 0; index < count; index++)
+    humidity[index] = (float) BME280Batch_GetHumidityInt32(c, adcH[index], tFine[index]) / 1024.0F;
+}
+
+/**
+ * @brief Compensates the samples in bulk using the structure-of-arrays layout, which allows vectorizing the formulas.
+ *   The samples are processed in blocks of <i>BME280_BATCH_BLOCK_LENGTH</i>. The floating-point engine is vectorized
+ *   completely. The integer engines are vectorized except for the pressure formulas, which use the integer division
+ *   having no vector instructions. The results match the <i>BME280Batch_Compensate</i> function ones bit for bit.
+ * @param calibration A pointer to the calibration data decoded by the <i>BME280Batch_ParseCalibration</i> function.
+ * @param engine The compensation engine the firmware is configured with (see <i>CONFIG_COMPENSATION</i>).
+ * @param rawData A pointer to the structure referring to the arrays of the uncompensated samples.
+ * @param measurements A pointer to the structure referring to the output arrays of the compensated samples.
+ * @param count The number of samples.
+ */
+BME280_BATCH_TARGET_CLONES
+void BME280Batch_CompensateArrays(const BME280Batch_Calibration *calibration, BME280Batch_Engine engine,
+  const BME280Batch_RawArrays *rawData, const BME280Batch_MeasurementArrays *measurements, size_t count)
+{
+  int32_t tFine[BME280_BATCH_BLOCK_LENGTH];
+
+  for (size_t start = 0; start < count; start += BME280_BATCH_BLOCK_LENGTH)
+  {
+    size_t length = count - start < BME280_BATCH_BLOCK_LENGTH ? count - start : BME280_BATCH_BLOCK_LENGTH;
+    const int32_t *adcP = &rawData->pressure[start];
+    const int32_t *adcT = &rawData->temperature[start];
+    const int32_t *adcH = &rawData->humidity[start];
+    float *pressure = &measurements->pressure[start];
+
+    if (engine != BME280_BATCH_ENGINE_INT32 && engine != BME280_BATCH_ENGINE_INT64)
+    {
+      BME280Batch_CompensateFloatBlock(calibration, adcP, adcT, adcH, pressure, &measurements->temperature[start],
+        &measurements->humidity[start], length);
+      continue;
+    }
+
+    BME280Batch_CompensateInt32Block(calibration, adcT, adcH, tFine, &measurements->temperature[start],
+      &measurements->humidity[start], length);
+
+    if (engine == BME280_BATCH_ENGINE_INT64)
+    {
+      for (size_t index = 0; index < length; index++)
+        pressure[index] = BME280Batch_GetPressureInt64(calibration, adcP[index], tFine[index]);
+    }
+    else
+    {
+      for (size_t index = 0; index < length; index++)
+        pressure[index] = BME280Batch_GetPressureInt32(calibration, adcP[index], tFine[index]);
+    }
+  }
+}
@@ -0,0 +1,63 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "project.h"
+
+/**
+ * @brief Defines the simulated USB frame period in microseconds.
+ */
+#define SIM_USB_FRAME_TIME_US 1000
+
+/**
+ * @brief Runs the simulated main loop for a single USB frame.
+ */
+static void Sim_RunFrame()
+{
+  Project_Loop();
+  Sim_CdcService();
+  Sim_AdvanceMicros(SIM_USB_FRAME_TIME_US);
+}
+
+/**
+ * @brief The host simulator entry point. Mirrors the <i>Core/Src/main.c</i> initialization sequence and feeds the
+ *   standard input to the firmware as USB CDC OUT packets. The responses are written to the standard output.
+ * @remarks Usage:
+ *   @code BMEReaderHost [--no-sensor]
+ */
+int main(int argc, char **argv)
+{
+  bool isSensorPresent = !(argc > 1 && strcmp(argv[1], "--no-sensor") == 0);
+
+  Sim_Bme280PowerOn(NULL);
+  Sim_I2cSetDevicePresent(isSensorPresent);
+
+  Project_PreInit();
+  MX_GPIO_Init();
+  MX_I2C1_Init();
+  Project_PostInit();
+  Sim_RunFrame();
+
+  char packet[CDC_DATA_FS_MAX_PACKET_SIZE];
+  ssize_t length;
+  while ((length = read(STDIN_FILENO, packet, sizeof(packet))) > 0)
+  {
+    Project_CdcMessageReceived(packet, (uint16_t) length);
+    Sim_RunFrame();
+  }
+
+  // Letting the firmware drain the pending work, including the commands deferred until the measurements complete.
+  for (uint16_t frame = 0; frame < 10 || (frame < 10000 && CommandQueue_Peek() != NULL); frame++)
+    Sim_RunFrame();
+
+  return 0;
+}
@@ -0,0 +1,401 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include "sim.h"
+
+/**
+ * @brief Defines the time in microseconds the device spends copying the NVM data after a reset.
+ */
+#define SIM_BME280_NVM_COPY_TIME_US 2000
+
+/**
+ * @brief Defines the maximal number of the missed normal mode conversions simulated at once. The older ones do not
+ *   affect the filtered values noticeably.
+ */
+#define SIM_BME280_MAX_MISSED_CYCLES 64
+
+/**
+ * @brief The trimming parameters of a typical device (the temperature and pressure values are taken from the Bosch
+ *   reference compensation example).
+ */
+const Sim_Bme280Calibration Sim_Bme280DefaultCalibration = {
+  .t1 = 27504, .t2 = 26435, .t3 = -1000,
+  .p1 = 36477, .p2 = -10685, .p3 = 3024, .p4 = 2855, .p5 = 140, .p6 = -7, .p7 = 15500, .p8 = -14600, .p9 = 6000,
+  .h1 = 75, .h2 = 362, .h3 = 0, .h4 = 313, .h5 = 50, .h6 = 30
+};
+
+/**
+ * @brief The standby times in microseconds indexed by the <i>config.t_sb</i> register field value.
+ */
+static const uint32_t Sim_Bme280StandbyTimes[8] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+
+/**
+ * @brief The simulated device state.
+ */
+static struct
+{
+  uint8_t registers[256];
+  uint8_t pointer;
+  bool isExpectingRegister;
+  Sim_Bme280Adc adc;
+  uint8_t mode;
+  uint64_t modeStart;
+  uint64_t conversionTime;
+  uint64_t cyclePeriod;
+  uint64_t latchedCycles;
+  uint64_t nvmCopyEnd;
+  uint64_t activeMicros;
+  uint32_t conversions;
+  Sim_Bme280Noise noise;
+  uint32_t random;
+  bool isFilterInitialized;
+  double filtered[2];
+} Sim_Bme280 = {
+  .adc = {.pressure = 415148, .temperature = 519888, .humidity = 30000},
+  .random = 0x12345678
+};
+
+/**
+ * @brief Converts the oversampling register field value to the oversampling factor.
+ * @param osrs The 3-bit oversampling register field value.
+ * @return The oversampling factor, or 0 if the channel measurement is skipped.
+ */
+static uint32_t Sim_Bme280GetOversampling(uint8_t osrs)
+{
+  return osrs == 0 ? 0 : osrs >= 5 ? 16 : 1 << (osrs - 1);
+}
+
+/**
+ * @brief Writes a 16-bit little-endian value to the register file.
+ */
+static void Sim_Bme280SetWord(uint8_t address, uint16_t value)
+{
+  Sim_Bme280.registers[address] = value & 0xFF;
+  Sim_Bme280.registers[address + 1] = value >> 8;
+}
+
+/**
+ * @brief Gets a normally distributed random value with zero mean and unit variance approximated by the sum of 12
+ *   uniformly distributed values. The sequence is repeated on every run.
+ */
+static double Sim_Bme280GetGaussian()
+{
+  double sum = -6.0;
+  for (uint8_t index = 0; index < 12; index++)
+  {
+    Sim_Bme280.random ^= Sim_Bme280.random << 13;
+    Sim_Bme280.random ^= Sim_Bme280.random >> 17;
+    Sim_Bme280.random ^= Sim_Bme280.random << 5;
+    sum += Sim_Bme280.random / 4294967296.0;
+  }
+  return sum;
+}
+
+/**
+ * @brief Gets the ADC value of a single conversion with the noise added.
+ * @param value The noiseless ADC value.
+ * @param oversampling The oversampling factor.
+ * @param white The RMS noise of a single ADC sample reduced by the oversampling.
+ * @param floor The RMS noise not reduced by the oversampling.
+ */
+static double Sim_Bme280GetNoisy(uint32_t value, uint32_t oversampling, float white, float floor)
+{
+  if (white == 0.0F && floor == 0.0F)
+    return value;
+  return value + sqrt((double) white * white / oversampling + (double) floor * floor) * Sim_Bme280GetGaussian();
+}
+
+/**
+ * @brief Rounds the ADC value and limits it to the ADC range.
+ */
+static uint32_t Sim_Bme280Clamp(double value, uint32_t max)
+{
+  return value <= 0.0 ? 0 : value >= max ? max : (uint32_t) (value + 0.5);
+}
+
+/**
+ * @brief Performs a conversion: adds the noise to the current ADC values, applies the IIR filter to the pressure and
+ *   temperature ones, and latches them into the data registers honoring the skipped channels.
+ */
+static void Sim_Bme280Latch()
+{
+  uint8_t *registers = Sim_Bme280.registers;
+  Sim_Bme280.conversions++;
+  uint32_t temperatureOversampling = Sim_Bme280GetOversampling(registers[0xF4] >> 5);
+  uint32_t pressureOversampling = Sim_Bme280GetOversampling(registers[0xF4] >> 2 & 0x07);
+  uint32_t humidityOversampling = Sim_Bme280GetOversampling(registers[0xF2] & 0x07);
+  uint32_t filter = registers[0xF5] >> 2 & 0x07;
+  double coefficient = 1 << (filter < 4 ? filter : 4);
+
+  const Sim_Bme280Noise *noise = &Sim_Bme280.noise;
+  double values[2] = {
+    Sim_Bme280GetNoisy(Sim_Bme280.adc.pressure, pressureOversampling, noise->pressure, noise->pressureFloor),
+    Sim_Bme280GetNoisy(Sim_Bme280.adc.temperature, temperatureOversampling, noise->temperature,
+      noise->temperatureFloor)
+  };
+  for (uint8_t index = 0; index < 2; index++)
+  {
+    // The filter is initialized with the first conversion value.
+    Sim_Bme280.filtered[index] = Sim_Bme280.isFilterInitialized ?
+      (Sim_Bme280.filtered[index] * (coefficient - 1.0) + values[index]) / coefficient : values[index];
+  }
+  Sim_Bme280.isFilterInitialized = true;
+
+  uint32_t pressure = pressureOversampling ? Sim_Bme280Clamp(Sim_Bme280.filtered[0], 0xFFFFF) : 0x80000;
+  uint32_t temperature = temperatureOversampling ? Sim_Bme280Clamp(Sim_Bme280.filtered[1], 0xFFFFF) : 0x80000;
+  uint32_t humidity = humidityOversampling ? Sim_Bme280Clamp(Sim_Bme280GetNoisy(Sim_Bme280.adc.humidity,
+    humidityOversampling, noise->humidity, noise->humidityFloor), 0xFFFF) : 0x8000;
+
+  registers[0xF7] = pressure >> 12;
+  registers[0xF8] = pressure >> 4;
+  registers[0xF9] = (pressure & 0x0F) << 4;
+  registers[0xFA] = temperature >> 12;
+  registers[0xFB] = temperature >> 4;
+  registers[0xFC] = (temperature & 0x0F) << 4;
+  registers[0xFD] = humidity >> 8;
+  registers[0xFE] = humidity;
+}
+
+/**
+ * @brief Brings the device state up to the current simulated time.
+ */
+static void Sim_Bme280Update()
+{
+  uint64_t now = Sim_GetMicros();
+  bool isMeasuring = false;
+
+  if (Sim_Bme280.mode == 0x3)
+  {
+    uint64_t elapsed = now - Sim_Bme280.modeStart;
+    uint64_t completed = elapsed >= Sim_Bme280.conversionTime ?
+      (elapsed - Sim_Bme280.conversionTime) / Sim_Bme280.cyclePeriod + 1 : 0;
+    if (completed > Sim_Bme280.latchedCycles)
+    {
+      uint64_t missed = completed - Sim_Bme280.latchedCycles;
+      for (missed = missed < SIM_BME280_MAX_MISSED_CYCLES ? missed : SIM_BME280_MAX_MISSED_CYCLES; missed > 0; missed--)
+        Sim_Bme280Latch();
+      Sim_Bme280.activeMicros += (completed - Sim_Bme280.latchedCycles) * Sim_Bme280.conversionTime;
+      Sim_Bme280.latchedCycles = completed;
+    }
+    isMeasuring = elapsed % Sim_Bme280.cyclePeriod < Sim_Bme280.conversionTime;
+  }
+  else if (Sim_Bme280.mode == 0x1 || Sim_Bme280.mode == 0x2)
+  {
+    if (now - Sim_Bme280.modeStart >= Sim_Bme280.conversionTime)
+    {
+      // A forced conversion has been completed, returning to the sleep mode.
+      Sim_Bme280Latch();
+      Sim_Bme280.activeMicros += Sim_Bme280.conversionTime;
+      Sim_Bme280.mode = 0x0;
+      Sim_Bme280.registers[0xF4] &= ~0x03;
+    }
+    else
+      isMeasuring = true;
+  }
+
+  Sim_Bme280.registers[0xF3] = (isMeasuring ? 0x08 : 0x00) | (now < Sim_Bme280.nvmCopyEnd ? 0x01 : 0x00);
+}
+
+/**
+ * @brief Performs the device power-on reset sequence.
+ */
+static void Sim_Bme280Reset()
+{
+  Sim_Bme280.registers[0xF2] = 0x00;
+  Sim_Bme280.registers[0xF4] = 0x00;
+  Sim_Bme280.registers[0xF5] = 0x00;
+  Sim_Bme280.mode = 0x0;
+  Sim_Bme280.isFilterInitialized = false;
+  Sim_Bme280.nvmCopyEnd = Sim_GetMicros() + SIM_BME280_NVM_COPY_TIME_US;
+  memcpy(&Sim_Bme280.registers[0xF7], (uint8_t[]) {0x80, 0x00, 0x00, 0x80, 0x00, 0x00, 0x80, 0x00}, 8);
+}
+
+/**
+ * @brief Applies a new <i>ctrl_meas</i> register value starting a conversion if required.
+ */
+static void Sim_Bme280ApplyCtrlMeas()
+{
+  uint8_t *registers = Sim_Bme280.registers;
+  uint32_t temperatureOversampling = Sim_Bme280GetOversampling(registers[0xF4] >> 5);
+  uint32_t pressureOversampling = Sim_Bme280GetOversampling(registers[0xF4] >> 2 & 0x07);
+  uint32_t humidityOversampling = Sim_Bme280GetOversampling(registers[0xF2] & 0x07);
+
+  // The typical measurement time formula from the datasheet, section 9.1.
+  Sim_Bme280.conversionTime = 1000 + 2000 * temperatureOversampling +
+    (pressureOversampling ? 2000 * pressureOversampling + 500 : 0) +
+    (humidityOversampling ? 2000 * humidityOversampling + 500 : 0);
+  Sim_Bme280.cyclePeriod = Sim_Bme280.conversionTime + Sim_Bme280StandbyTimes[registers[0xF5] >> 5];
+  Sim_Bme280.mode = registers[0xF4] & 0x03;
+  Sim_Bme280.modeStart = Sim_GetMicros();
+  Sim_Bme280.latchedCycles = 0;
+}
+
+/**
+ * @brief Powers the simulated device on.
+ * @param calibration A pointer to the trimming parameters to be stored in the device NVM. If <i>NULL</i>, the
+ *   <i>Sim_Bme280DefaultCalibration</i> parameters are used.
+ */
+void Sim_Bme280PowerOn(const Sim_Bme280Calibration *calibration)
+{
+  if (calibration == NULL)
+    calibration = &Sim_Bme280DefaultCalibration;
+
+  memset(Sim_Bme280.registers, 0, sizeof(Sim_Bme280.registers));
+  Sim_Bme280.registers[0xD0] = 0x60;
+
+  Sim_Bme280SetWord(0x88, calibration->t1);
+  Sim_Bme280SetWord(0x8A, calibration->t2);
+  Sim_Bme280SetWord(0x8C, calibration->t3);
+  Sim_Bme280SetWord(0x8E, calibration->p1);
+  Sim_Bme280SetWord(0x90, calibration->p2);
+  Sim_Bme280SetWord(0x92, calibration->p3);
+  Sim_Bme280SetWord(0x94, calibration->p4);
+  Sim_Bme280SetWord(0x96, calibration->p5);
+  Sim_Bme280SetWord(0x98, calibration->p6);
+  Sim_Bme280SetWord(0x9A, calibration->p7);
+  Sim_Bme280SetWord(0x9C, calibration->p8);
+  Sim_Bme280SetWord(0x9E, calibration->p9);
+  Sim_Bme280.registers[0xA1] = calibration->h1;
+  Sim_Bme280SetWord(0xE1, calibration->h2);
+  Sim_Bme280.registers[0xE3] = calibration->h3;
+  Sim_Bme280.registers[0xE4] = (calibration->h4 >> 4) & 0xFF;
+  Sim_Bme280.registers[0xE5] = (calibration->h4 & 0x0F) | (calibration->h5 & 0x0F) << 4;
+  Sim_Bme280.registers[0xE6] = (calibration->h5 >> 4) & 0xFF;
+  Sim_Bme280.registers[0xE7] = calibration->h6;
+
+  Sim_Bme280.isExpectingRegister = true;
+  Sim_Bme280Reset();
+}
+
+/**
+ * @brief Sets the raw ADC values the device will latch on the following conversions.
+ * @param adc A pointer to the raw ADC values structure.
+ */
+void Sim_Bme280SetAdc(const Sim_Bme280Adc *adc)
+{
+  Sim_Bme280.adc = *adc;
+}
+
+/**
+ * @brief Sets the noise added to the raw ADC values on the following conversions. No noise is added by default.
+ * @param noise A pointer to the noise structure.
+ */
+void Sim_Bme280SetNoise(const Sim_Bme280Noise *noise)
+{
+  Sim_Bme280.noise = *noise;
+}
+
+/**
+ * @brief Gets the register value bypassing the I2C bus.
+ * @param address The register address.
+ * @return The current register value.
+ */
+uint8_t Sim_Bme280GetRegister(uint8_t address)
+{
+  Sim_Bme280Update();
+  return Sim_Bme280.registers[address];
+}
+
+/**
+ * @brief Gets the total time spent on the completed conversions, which is proportional to the device self-heating.
+ * @return The total conversion time in microseconds.
+ */
+uint64_t Sim_Bme280GetActiveMicros()
+{
+  Sim_Bme280Update();
+  return Sim_Bme280.activeMicros;
+}
+
+/**
+ * @brief Gets the number of the conversions latched into the data registers, each one giving a new sample.
+ * @return The number of the conversions since the simulation start.
+ */
+uint32_t Sim_Bme280GetConversionCount()
+{
+  Sim_Bme280Update();
+  return Sim_Bme280.conversions;
+}
+
+/**
+ * @brief Handles the I2C address phase.
+ * @param address The 7-bit I2C address sent on the bus.
+ * @param read The flag indicating if a read transfer is requested.
+ * @return <i>true</i> if the address has been acknowledged by the device.
+ */
+bool Sim_Bme280Start(uint8_t address, bool read)
+{
+  if (address != SIM_BME280_ADDRESS)
+    return false;
+
+  // The data registers are shadowed for the whole burst read.
+  Sim_Bme280Update();
+  Sim_Bme280.isExpectingRegister = !read;
+  return true;
+}
+
+/**
+ * @brief Handles a written byte. The device expects register address and data byte pairs.
+ * @param byte The written byte.
+ */
+void Sim_Bme280Write(uint8_t byte)
+{
+  if (Sim_Bme280.isExpectingRegister)
+  {
+    Sim_Bme280.pointer = byte;
+    Sim_Bme280.isExpectingRegister = false;
+    return;
+  }
+
+  uint8_t address = Sim_Bme280.pointer;
+  Sim_Bme280.isExpectingRegister = true;
+  Sim_Bme280Update();
+
+  switch (address)
+  {
+    case 0xE0:  // reset
+    {
+      if (byte == 0xB6)
+        Sim_Bme280Reset();
+      return;
+    }
+    case 0xF2:  // ctrl_hum
+    case 0xF5:  // config
+    {
+      Sim_Bme280.registers[address] = byte;
+      return;
+    }
+    case 0xF4:  // ctrl_meas
+    {
+      Sim_Bme280.registers[address] = byte;
+      Sim_Bme280ApplyCtrlMeas();
+      return;
+    }
+    default:
+      return;
+  }
+}
+
+/**
+ * @brief Handles a read byte. The register address is auto-incremented.
+ * @return The register value.
+ */
+uint8_t Sim_Bme280Read()
+{
+  return Sim_Bme280.registers[Sim_Bme280.pointer++];
+}
+
+/**
+ * @brief Handles the STOP condition.
+ */
+void Sim_Bme280Stop()
+{
+  Sim_Bme280.isExpectingRegister = true;
+}
@@ -0,0 +1,103 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sim.h"
+#include "project.h"
+
+/**
+ * @brief Writes the transmitted data to the standard output.
+ */
+static void Sim_CdcWriteStdout(const char *data, uint16_t length)
+{
+  fwrite(data, 1, length, stdout);
+  fflush(stdout);
+}
+
+/**
+ * @brief The simulated CDC IN endpoint state.
+ */
+static struct
+{
+  uint8_t buffer[1024];
+  uint16_t length;
+  bool isBusy;
+  uint32_t packets;
+  void (*output)(const char *data, uint16_t length);
+} Sim_Cdc = {
+  .output = Sim_CdcWriteStdout
+};
+
+/**
+ * @brief Starts a simulated CDC transmission. Mirrors the <i>USB_DEVICE/App/usbd_cdc_if.c</i> implementation: the
+ *   transmission is rejected while the previous one is still in progress. The data are copied, so the caller's buffer
+ *   lifetime does not matter for the simulation.
+ * @param Buf A pointer to the data to be transmitted.
+ * @param Len The number of bytes to be transmitted.
+ * @return <i>USBD_OK</i> if the transmission has been started, or <i>USBD_BUSY</i> otherwise.
+ */
+uint8_t CDC_Transmit_FS(uint8_t *Buf, uint16_t Len)
+{
+  if (Sim_Cdc.isBusy)
+    return USBD_BUSY;
+
+  if (Len > sizeof(Sim_Cdc.buffer))
+    return USBD_FAIL;
+
+  memcpy(Sim_Cdc.buffer, Buf, Len);
+  Sim_Cdc.length = Len;
+  Sim_Cdc.isBusy = true;
+  return USBD_OK;
+}
+
+/**
+ * @brief Completes the pending simulated CDC transmission, if any, the way the host polls the IN endpoint.
+ */
+void Sim_CdcService()
+{
+  if (!Sim_Cdc.isBusy)
+    return;
+
+  // The transfer is split into full packets terminated by a short or a zero-length packet.
+  Sim_Cdc.packets += Sim_Cdc.length / CDC_DATA_FS_MAX_PACKET_SIZE + 1;
+
+  Sim_Cdc.output((const char *) Sim_Cdc.buffer, Sim_Cdc.length);
+  Sim_Cdc.isBusy = false;
+  Project_CdcTransmissionCompleted((const char *) Sim_Cdc.buffer, Sim_Cdc.length);
+}
+
+/**
+ * @brief Gets the number of the IN packets transmitted by the simulated CDC interface.
+ * @return The transmitted packets count including zero-length packets.
+ */
+uint32_t Sim_CdcGetPacketCount()
+{
+  return Sim_Cdc.packets;
+}
+
+/**
+ * @brief Sets the sink for the transmitted data.
+ * @param output The function receiving the transmitted data. By default the data are written to the standard output.
+ */
+void Sim_CdcSetOutput(void (*output)(const char *data, uint16_t length))
+{
+  Sim_Cdc.output = output != NULL ? output : Sim_CdcWriteStdout;
+}
+
+/**
+ * @brief Simulates a USB bus reset or a host reconnection with the transmission in progress. Mirrors the USB stack: the
+ *   transmission is dropped without signaling its completion, and the CDC interface is deinitialized and initialized
+ *   again by the <i>USB_DEVICE/App/usbd_cdc_if.c</i> callbacks.
+ */
+void Sim_CdcBusReset()
+{
+  Sim_Cdc.isBusy = false;
+  TransmitQueue_Reset();
+}
@@ -0,0 +1,767 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sim.h"
+#include "i2c.h"
+
+/**
+ * @brief Defines the maximal number of successive interrupt handler calls before the simulation is considered stuck.
+ */
+#define SIM_MAX_INTERRUPT_CALLS 100000
+
+/**
+ * @brief The simulated I2C bus phases.
+ */
+typedef enum Sim_I2cPhase
+{
+  SIM_I2C_PHASE_IDLE,
+  SIM_I2C_PHASE_STARTED,
+  SIM_I2C_PHASE_WRITING,
+  SIM_I2C_PHASE_READING,
+  SIM_I2C_PHASE_FAILED
+} Sim_I2cPhase;
+
+I2C_TypeDef Sim_I2c1;
+DMA_TypeDef Sim_Dma1;
+GPIO_TypeDef Sim_GpioB = {.IDR = SCL_Pin | SDA_Pin};
+GPIO_TypeDef Sim_GpioC;
+RTC_TypeDef Sim_Rtc;
+
+/**
+ * @brief The sample history section reserved by the linker script on the target. The section end symbol is defined by
+ *   the linker command line.
+ */
+uint8_t _shistory[SIM_HISTORY_SIZE];
+
+/**
+ * @brief The settings store flash sectors reserved by the linker script on the target, erased initially. The section
+ *   end symbol is defined by the linker command line.
+ */
+uint8_t _sstore[SIM_STORE_SIZE] = {[0 ... SIM_STORE_SIZE - 1] = 0xFF};
+
+/**
+ * @brief The simulated time in microseconds elapsed since the simulation start.
+ */
+static double Sim_Micros = 0;
+
+/**
+ * @brief The current simulated I2C bus phase.
+ */
+static Sim_I2cPhase Sim_I2cBusPhase = SIM_I2C_PHASE_IDLE;
+
+/**
+ * @brief The flag indicating if the simulated device acknowledges its address.
+ */
+static bool Sim_I2cIsDevicePresent = true;
+
+/**
+ * @brief The number of bytes (including address bytes) transferred over the simulated bus.
+ */
+static uint32_t Sim_I2cTransferredBytes = 0;
+
+/**
+ * @brief The simulated PRIMASK register value. The interrupts are masked while it is non-zero.
+ */
+static uint32_t Sim_Primask = 0;
+
+/**
+ * @brief The flag indicating if an interrupt handler is being executed.
+ */
+static bool Sim_IsInInterrupt = false;
+
+/**
+ * @brief The flag indicating if the flash control register is unlocked.
+ */
+static bool Sim_FlashIsUnlocked = false;
+
+/**
+ * @brief The number of the flash words programmed.
+ */
+static uint32_t Sim_FlashProgramCount = 0;
+
+/**
+ * @brief The number of the flash sectors erased.
+ */
+static uint32_t Sim_FlashEraseCount = 0;
+
+/**
+ * @brief The number of the flash words left to be programmed before the simulated power loss.
+ */
+static uint32_t Sim_FlashProgramLimit = UINT32_MAX;
+
+/**
+ * @brief Gets the simulated time.
+ * @return The number of microseconds elapsed since the simulation start.
+ */
+uint64_t Sim_GetMicros()
+{
+  return (uint64_t) Sim_Micros;
+}
+
+/**
+ * @brief Advances the simulated time.
+ * @param micros The number of microseconds to advance the time by.
+ */
+void Sim_AdvanceMicros(double micros)
+{
+  Sim_Micros += micros;
+}
+
+/**
+ * @brief Sets if the simulated device acknowledges its address on the I2C bus.
+ * @param isPresent If <i>false</i>, the device address will not be acknowledged.
+ */
+void Sim_I2cSetDevicePresent(bool isPresent)
+{
+  Sim_I2cIsDevicePresent = isPresent;
+}
+
+/**
+ * @brief Gets the number of bytes transferred over the simulated I2C bus.
+ * @return The transferred bytes count including address bytes.
+ */
+uint32_t Sim_I2cGetTransferredBytes()
+{
+  return Sim_I2cTransferredBytes;
+}
+
+/**
+ * @brief Checks if the simulated I2C peripheral has a pending event interrupt.
+ */
+static bool Sim_I2cIsEventPending(const I2C_TypeDef *I2Cx)
+{
+  if (!READ_BIT(I2Cx->CR2, I2C_CR2_ITEVTEN))
+    return false;
+
+  return READ_BIT(I2Cx->SR1, I2C_SR1_SB | I2C_SR1_ADDR | I2C_SR1_BTF) ||
+    (READ_BIT(I2Cx->CR2, I2C_CR2_ITBUFEN) && READ_BIT(I2Cx->SR1, I2C_SR1_TXE | I2C_SR1_RXNE));
+}
+
+/**
+ * @brief Checks if the simulated I2C peripheral has a pending error interrupt.
+ */
+static bool Sim_I2cIsErrorPending(const I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->CR2, I2C_CR2_ITERREN) && READ_BIT(I2Cx->SR1, I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO);
+}
+
+/**
+ * @brief Checks if the simulated DMA1 stream 0 has a pending interrupt.
+ */
+static bool Sim_DmaIsStream0Pending()
+{
+  const DMA_Stream_TypeDef *stream = &DMA1->Stream[LL_DMA_STREAM_0];
+  return (READ_BIT(stream->CR, DMA_SxCR_TCIE) && READ_BIT(DMA1->LISR, DMA_LISR_TCIF0)) ||
+    (READ_BIT(stream->CR, DMA_SxCR_TEIE) && READ_BIT(DMA1->LISR, DMA_LISR_TEIF0));
+}
+
+/**
+ * @brief Runs the pending simulated I2C interrupt handlers the way the NVIC would preempt the main code. Does nothing
+ *   while the interrupts are masked or an interrupt handler is already running, as the handler loop will pick up the
+ *   new events after the current handler returns.
+ */
+static void Sim_I2cDispatchInterrupts()
+{
+  if (Sim_Primask != 0 || Sim_IsInInterrupt)
+    return;
+
+  Sim_IsInInterrupt = true;
+  for (uint32_t calls = 0; ; calls++)
+  {
+    if (calls == SIM_MAX_INTERRUPT_CALLS)
+    {
+      fprintf(stderr, "[sim] The I2C interrupt is stuck (SR1 = 0x%04X, CR2 = 0x%04X).\n", I2C1->SR1, I2C1->CR2);
+      abort();
+    }
+
+    if (Sim_DmaIsStream0Pending())
+      DMA1_Stream0_IRQHandler();
+    else if (Sim_I2cIsEventPending(I2C1))
+      I2C1_EV_IRQHandler();
+    else if (Sim_I2cIsErrorPending(I2C1))
+      I2C1_ER_IRQHandler();
+    else
+      break;
+  }
+  Sim_IsInInterrupt = false;
+}
+
+/**
+ * @brief Mirrors the <i>Core/Src/stm32f4xx_it.c</i> I2C1 event interrupt handler.
+ */
+void I2C1_EV_IRQHandler(void)
+{
+  I2C_EventInterruptHandler(I2C1);
+}
+
+/**
+ * @brief Mirrors the <i>Core/Src/stm32f4xx_it.c</i> I2C1 error interrupt handler.
+ */
+void I2C1_ER_IRQHandler(void)
+{
+  I2C_ErrorInterruptHandler(I2C1);
+}
+
+/**
+ * @brief Mirrors the <i>Core/Src/stm32f4xx_it.c</i> DMA1 stream 0 interrupt handler.
+ */
+void DMA1_Stream0_IRQHandler(void)
+{
+  bool isTransferError = LL_DMA_IsActiveFlag_TE0(DMA1);
+  LL_DMA_ClearFlag_TC0(DMA1);
+  LL_DMA_ClearFlag_TE0(DMA1);
+  I2C_DmaInterruptHandler(I2C1, !isTransferError);
+}
+
+/**
+ * @brief Accounts a single byte transfer (8 data bits and an acknowledge bit) on the simulated I2C bus.
+ */
+static void Sim_I2cTransferByte()
+{
+  Sim_I2cTransferredBytes++;
+  Sim_AdvanceMicros(9 * SIM_I2C_BIT_TIME_US);
+}
+
+void LL_I2C_Enable(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->CR1, I2C_CR1_PE);
+}
+
+void LL_I2C_Disable(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->CR1, I2C_CR1_PE);
+}
+
+void LL_I2C_EnableReset(I2C_TypeDef *I2Cx)
+{
+  WRITE_REG(I2Cx->CR1, I2C_CR1_SWRST);
+  WRITE_REG(I2Cx->SR1, 0);
+  WRITE_REG(I2Cx->SR2, 0);
+  Sim_I2cBusPhase = SIM_I2C_PHASE_IDLE;
+}
+
+void LL_I2C_DisableReset(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->CR1, I2C_CR1_SWRST);
+}
+
+void LL_I2C_GenerateStartCondition(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->SR2, I2C_SR2_BUSY);
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_TXE | I2C_SR1_BTF);
+  SET_BIT(I2Cx->SR1, I2C_SR1_SB);
+  Sim_I2cBusPhase = SIM_I2C_PHASE_STARTED;
+  Sim_AdvanceMicros(SIM_I2C_BIT_TIME_US);
+  Sim_I2cDispatchInterrupts();
+}
+
+void LL_I2C_GenerateStopCondition(I2C_TypeDef *I2Cx)
+{
+  if (Sim_I2cBusPhase == SIM_I2C_PHASE_WRITING || Sim_I2cBusPhase == SIM_I2C_PHASE_READING)
+    Sim_Bme280Stop();
+
+  CLEAR_BIT(I2Cx->SR2, I2C_SR2_BUSY);
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_TXE | I2C_SR1_BTF);
+  Sim_I2cBusPhase = SIM_I2C_PHASE_IDLE;
+  Sim_AdvanceMicros(SIM_I2C_BIT_TIME_US);
+}
+
+void LL_I2C_AcknowledgeNextData(I2C_TypeDef *I2Cx, uint32_t TypeAcknowledge)
+{
+  I2Cx->CR1 = (I2Cx->CR1 & ~I2C_CR1_ACK) | TypeAcknowledge;
+}
+
+void LL_I2C_TransmitData8(I2C_TypeDef *I2Cx, uint8_t Data)
+{
+  Sim_I2cTransferByte();
+
+  switch (Sim_I2cBusPhase)
+  {
+    case SIM_I2C_PHASE_STARTED:
+    {
+      CLEAR_BIT(I2Cx->SR1, I2C_SR1_SB);
+      bool isRead = Data & 0x01;
+      if (!Sim_I2cIsDevicePresent || !Sim_Bme280Start(Data >> 1, isRead))
+      {
+        SET_BIT(I2Cx->SR1, I2C_SR1_AF);
+        Sim_I2cBusPhase = SIM_I2C_PHASE_FAILED;
+        break;
+      }
+
+      SET_BIT(I2Cx->SR1, I2C_SR1_ADDR);
+      Sim_I2cBusPhase = isRead ? SIM_I2C_PHASE_READING : SIM_I2C_PHASE_WRITING;
+      break;
+    }
+    case SIM_I2C_PHASE_WRITING:
+    {
+      Sim_Bme280Write(Data);
+      SET_BIT(I2Cx->SR1, I2C_SR1_TXE | I2C_SR1_BTF);
+      break;
+    }
+    default:
+    {
+      SET_BIT(I2Cx->SR1, I2C_SR1_AF);
+      break;
+    }
+  }
+
+  Sim_I2cDispatchInterrupts();
+}
+
+uint8_t LL_I2C_ReceiveData8(I2C_TypeDef *I2Cx)
+{
+  uint8_t data = (uint8_t) I2Cx->DR;
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_RXNE);
+
+  // Clocking in the next byte only if the current one has been acknowledged.
+  if (Sim_I2cBusPhase == SIM_I2C_PHASE_READING && READ_BIT(I2Cx->CR1, I2C_CR1_ACK))
+  {
+    Sim_I2cTransferByte();
+    I2Cx->DR = Sim_Bme280Read();
+    SET_BIT(I2Cx->SR1, I2C_SR1_RXNE);
+  }
+
+  Sim_I2cDispatchInterrupts();
+  return data;
+}
+
+uint32_t LL_I2C_IsActiveFlag_SB(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_SB) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_ADDR(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_ADDR) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_BTF(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_BTF) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_RXNE(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_RXNE) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_AF(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_AF) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_BUSY(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR2, I2C_SR2_BUSY) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_TXE(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_TXE) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_BERR(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_BERR) != 0;
+}
+
+uint32_t LL_I2C_IsActiveFlag_ARLO(I2C_TypeDef *I2Cx)
+{
+  return READ_BIT(I2Cx->SR1, I2C_SR1_ARLO) != 0;
+}
+
+/**
+ * @brief Clocks in the received bytes through the simulated DMA1 stream 0 until its data counter is exhausted. The
+ *   byte transferred with the LAST bit set and the counter reaching zero is not acknowledged, so the device stops
+ *   sending data.
+ */
+static void Sim_DmaReceiveI2cData(I2C_TypeDef *I2Cx)
+{
+  DMA_Stream_TypeDef *stream = &DMA1->Stream[LL_DMA_STREAM_0];
+  if (!READ_BIT(stream->CR, DMA_SxCR_EN))
+  {
+    SET_BIT(DMA1->LISR, DMA_LISR_TEIF0);
+    return;
+  }
+
+  uint8_t *memory = (uint8_t *) stream->M0AR;
+  while (stream->NDTR > 0)
+  {
+    Sim_I2cTransferByte();
+    *memory++ = Sim_Bme280Read();
+    stream->NDTR--;
+  }
+
+  stream->M0AR = (uintptr_t) memory;
+  CLEAR_BIT(stream->CR, DMA_SxCR_EN);
+  SET_BIT(DMA1->LISR, DMA_LISR_TCIF0);
+}
+
+void LL_I2C_ClearFlag_ADDR(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_ADDR);
+
+  // The first byte is clocked in right after the address phase when reading, and the data register is empty when
+  // writing.
+  if (Sim_I2cBusPhase == SIM_I2C_PHASE_READING && READ_BIT(I2Cx->CR2, I2C_CR2_DMAEN))
+    Sim_DmaReceiveI2cData(I2Cx);
+  else if (Sim_I2cBusPhase == SIM_I2C_PHASE_READING)
+  {
+    Sim_I2cTransferByte();
+    I2Cx->DR = Sim_Bme280Read();
+    SET_BIT(I2Cx->SR1, I2C_SR1_RXNE);
+  }
+  else if (Sim_I2cBusPhase == SIM_I2C_PHASE_WRITING)
+    SET_BIT(I2Cx->SR1, I2C_SR1_TXE);
+
+  Sim_I2cDispatchInterrupts();
+}
+
+void LL_I2C_ClearFlag_AF(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_AF);
+}
+
+void LL_I2C_ClearFlag_BERR(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_BERR);
+}
+
+void LL_I2C_ClearFlag_ARLO(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->SR1, I2C_SR1_ARLO);
+}
+
+void LL_I2C_EnableIT_EVT(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->CR2, I2C_CR2_ITEVTEN);
+  Sim_I2cDispatchInterrupts();
+}
+
+void LL_I2C_EnableIT_BUF(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->CR2, I2C_CR2_ITBUFEN);
+  Sim_I2cDispatchInterrupts();
+}
+
+void LL_I2C_DisableIT_BUF(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->CR2, I2C_CR2_ITBUFEN);
+}
+
+void LL_I2C_EnableIT_ERR(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->CR2, I2C_CR2_ITERREN);
+  Sim_I2cDispatchInterrupts();
+}
+
+void LL_I2C_EnableDMAReq_RX(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->CR2, I2C_CR2_DMAEN);
+}
+
+void LL_I2C_DisableDMAReq_RX(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->CR2, I2C_CR2_DMAEN);
+}
+
+void LL_I2C_EnableLastDMA(I2C_TypeDef *I2Cx)
+{
+  SET_BIT(I2Cx->CR2, I2C_CR2_LAST);
+}
+
+void LL_I2C_DisableLastDMA(I2C_TypeDef *I2Cx)
+{
+  CLEAR_BIT(I2Cx->CR2, I2C_CR2_LAST);
+}
+
+uintptr_t LL_I2C_DMA_GetRegAddr(I2C_TypeDef *I2Cx)
+{
+  return (uintptr_t) &I2Cx->DR;
+}
+
+void LL_DMA_ConfigTransfer(DMA_TypeDef *DMAx, uint32_t Stream, uint32_t Configuration)
+{
+  DMAx->Stream[Stream].CR = (DMAx->Stream[Stream].CR & (DMA_SxCR_TCIE | DMA_SxCR_TEIE)) | Configuration;
+}
+
+void LL_DMA_SetChannelSelection(DMA_TypeDef *DMAx, uint32_t Stream, uint32_t Channel)
+{
+  DMAx->Stream[Stream].CR = (DMAx->Stream[Stream].CR & ~(0x7UL << 25)) | Channel;
+}
+
+void LL_DMA_SetPeriphAddress(DMA_TypeDef *DMAx, uint32_t Stream, uintptr_t PeriphAddress)
+{
+  DMAx->Stream[Stream].PAR = PeriphAddress;
+}
+
+void LL_DMA_SetMemoryAddress(DMA_TypeDef *DMAx, uint32_t Stream, uintptr_t MemoryAddress)
+{
+  DMAx->Stream[Stream].M0AR = MemoryAddress;
+}
+
+void LL_DMA_SetDataLength(DMA_TypeDef *DMAx, uint32_t Stream, uint32_t NbData)
+{
+  DMAx->Stream[Stream].NDTR = NbData & 0xFFFF;
+}
+
+void LL_DMA_EnableStream(DMA_TypeDef *DMAx, uint32_t Stream)
+{
+  SET_BIT(DMAx->Stream[Stream].CR, DMA_SxCR_EN);
+}
+
+void LL_DMA_DisableStream(DMA_TypeDef *DMAx, uint32_t Stream)
+{
+  CLEAR_BIT(DMAx->Stream[Stream].CR, DMA_SxCR_EN);
+}
+
+void LL_DMA_EnableIT_TC(DMA_TypeDef *DMAx, uint32_t Stream)
+{
+  SET_BIT(DMAx->Stream[Stream].CR, DMA_SxCR_TCIE);
+}
+
+void LL_DMA_EnableIT_TE(DMA_TypeDef *DMAx, uint32_t Stream)
+{
+  SET_BIT(DMAx->Stream[Stream].CR, DMA_SxCR_TEIE);
+}
+
+uint32_t LL_DMA_IsActiveFlag_TC0(DMA_TypeDef *DMAx)
+{
+  return READ_BIT(DMAx->LISR, DMA_LISR_TCIF0) != 0;
+}
+
+uint32_t LL_DMA_IsActiveFlag_TE0(DMA_TypeDef *DMAx)
+{
+  return READ_BIT(DMAx->LISR, DMA_LISR_TEIF0) != 0;
+}
+
+void LL_DMA_ClearFlag_TC0(DMA_TypeDef *DMAx)
+{
+  CLEAR_BIT(DMAx->LISR, DMA_LISR_TCIF0);
+}
+
+void LL_DMA_ClearFlag_TE0(DMA_TypeDef *DMAx)
+{
+  CLEAR_BIT(DMAx->LISR, DMA_LISR_TEIF0);
+}
+
+void LL_GPIO_SetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+  SET_BIT(GPIOx->ODR, PinMask);
+}
+
+void LL_GPIO_ResetOutputPin(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+  CLEAR_BIT(GPIOx->ODR, PinMask);
+}
+
+uint32_t LL_GPIO_IsInputPinSet(GPIO_TypeDef *GPIOx, uint32_t PinMask)
+{
+  return READ_BIT(GPIOx->IDR, PinMask) == PinMask;
+}
+
+void LL_GPIO_SetPinMode(GPIO_TypeDef *GPIOx, uint32_t Pin, uint32_t Mode)
+{
+  GPIOx->MODER = Mode ? GPIOx->MODER | Pin : GPIOx->MODER & ~Pin;
+}
+
+void LL_RTC_BAK_SetRegister(RTC_TypeDef *RTCx, uint32_t BackupRegister, uint32_t Data)
+{
+  RTCx->BKP[BackupRegister] = Data;
+}
+
+uint32_t LL_RTC_BAK_GetRegister(RTC_TypeDef *RTCx, uint32_t BackupRegister)
+{
+  return RTCx->BKP[BackupRegister];
+}
+
+void LL_APB1_GRP1_EnableClock(__unused uint32_t Periphs)
+{
+}
+
+void LL_AHB1_GRP1_EnableClock(__unused uint32_t Periphs)
+{
+}
+
+void LL_PWR_EnableBkUpAccess(void)
+{
+}
+
+void LL_RCC_EnableRTC(void)
+{
+}
+
+uint32_t LL_GetUID_Word0(void)
+{
+  return 0x484F5354;  // "HOST"
+}
+
+uint32_t LL_GetUID_Word1(void)
+{
+  return 0x53494D55;  // "SIMU"
+}
+
+uint32_t LL_GetUID_Word2(void)
+{
+  return 0x4C415445;  // "LATE"
+}
+
+void LL_mDelay(uint32_t Delay)
+{
+  // Mimicking the LL implementation that adds a tick to guarantee the minimal wait.
+  Sim_AdvanceMicros((Delay + 1) * 1000.0);
+}
+
+uint32_t HAL_GetTick(void)
+{
+  return (uint32_t) (Sim_GetMicros() / 1000);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+  Sim_FlashIsUnlocked = true;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+  Sim_FlashIsUnlocked = false;
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uintptr_t Address, uint64_t Data)
+{
+  uint8_t *word = (uint8_t *) Address;
+  if (!Sim_FlashIsUnlocked || TypeProgram != FLASH_TYPEPROGRAM_WORD || Address % 4 != 0 || word < _sstore ||
+    word + 4 > &_sstore[SIM_STORE_SIZE])
+    return HAL_ERROR;
+
+  // The words are not programmed anymore after the simulated power loss.
+  if (Sim_FlashProgramLimit == 0)
+    return HAL_ERROR;
+  if (Sim_FlashProgramLimit != UINT32_MAX)
+    Sim_FlashProgramLimit--;
+
+  // Programming can only clear the erased bits.
+  for (uint8_t index = 0; index < 4; index++)
+    word[index] &= (uint8_t) (Data >> (index * 8));
+
+  Sim_FlashProgramCount++;
+  Sim_AdvanceMicros(SIM_FLASH_PROGRAM_TIME_US);
+  return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+  *SectorError = pEraseInit->Sector;
+  if (!Sim_FlashIsUnlocked || pEraseInit->TypeErase != FLASH_TYPEERASE_SECTORS ||
+    pEraseInit->Sector < FLASH_SECTOR_6 || pEraseInit->Sector > FLASH_SECTOR_7 || pEraseInit->NbSectors != 1)
+    return HAL_ERROR;
+
+  // The store section occupies the last two sectors of the same size.
+  memset(&_sstore[(pEraseInit->Sector - FLASH_SECTOR_6) * (SIM_STORE_SIZE / 2)], 0xFF, SIM_STORE_SIZE / 2);
+  *SectorError = 0xFFFFFFFFU;
+  Sim_FlashEraseCount++;
+  Sim_AdvanceMicros(SIM_FLASH_ERASE_TIME_US);
+  return HAL_OK;
+}
+
+/**
+ * @brief Gets the number of the flash words programmed since the simulation start.
+ */
+uint32_t Sim_FlashGetProgramCount()
+{
+  return Sim_FlashProgramCount;
+}
+
+/**
+ * @brief Simulates a power loss after the number of the flash words programmed, the following programming fails.
+ * @param count The number of the flash words programmed before the power loss, or <i>UINT32_MAX</i> for no limit.
+ */
+void Sim_FlashSetProgramLimit(uint32_t count)
+{
+  Sim_FlashProgramLimit = count;
+}
+
+/**
+ * @brief Gets the number of the flash sectors erased since the simulation start.
+ */
+uint32_t Sim_FlashGetEraseCount()
+{
+  return Sim_FlashEraseCount;
+}
+
+void __set_MSP(__unused uint32_t topOfMainStack)
+{
+}
+
+uint32_t __get_PRIMASK(void)
+{
+  return Sim_Primask;
+}
+
+void __set_PRIMASK(uint32_t priMask)
+{
+  Sim_Primask = priMask & 0x01;
+  Sim_I2cDispatchInterrupts();
+}
+
+void __disable_irq(void)
+{
+  Sim_Primask = 1;
+}
+
+void __enable_irq(void)
+{
+  __set_PRIMASK(0);
+}
+
+void __WFI(void)
+{
+  // The simulated peripherals complete their work synchronously, so only the next SysTick interrupt can wake the core.
+  Sim_AdvanceMicros(1000 - Sim_GetMicros() % 1000);
+}
+
+void NVIC_SetPriority(__unused IRQn_Type IRQn, __unused uint32_t priority)
+{
+}
+
+void NVIC_EnableIRQ(__unused IRQn_Type IRQn)
+{
+}
+
+void NVIC_SystemReset(void)
+{
+  fprintf(stderr, "[sim] System reset requested.\n");
+  exit(EXIT_SUCCESS);
+}
+
+void Error_Handler(void)
+{
+  fprintf(stderr, "[sim] Error handler called.\n");
+  abort();
+}
+
+void MX_GPIO_Init(void)
+{
+  LL_GPIO_ResetOutputPin(LED_GPIO_Port, LED_Pin);
+  LL_GPIO_SetPinMode(LED_GPIO_Port, LED_Pin, LL_GPIO_MODE_OUTPUT);
+}
+
+void MX_I2C1_Init(void)
+{
+  LL_GPIO_SetPinMode(GPIOB, SCL_Pin | SDA_Pin, LL_GPIO_MODE_ALTERNATE);
+  I2C1->CR1 = I2C_CR1_PE | I2C_CR1_ACK;
+  I2C1->CR2 = 0;
+  I2C1->SR1 = 0;
+  I2C1->SR2 = 0;
+}
@@ -13,6 +13,11 @@
  */
 volatile uint8_t BME280_address = 0x76;
 
+/**
+ * @brief Sets the compensation engine used by the <i>BME280_GetMeasurement</i> and <i>BME280_Compensate</i> functions.
+ */
+BME280_Compensation BME280_compensation = BME280_COMPENSATION_FLOAT;
+
 /**
  * @brief Gets the device identification code.
  * @param i2c A pointer to the I2C peripheral structure.
@@ -22,13 +27,7 @@ volatile uint8_t BME280_address = 0x76;
 I2C_Result BME280_GetID(I2C_TypeDef *i2c, uint8_t *id)
 {
   uint8_t address = 0xD0;   // id
-  I2C_Result result;
-
-  result = I2C_Write(i2c, BME280_address, &address, sizeof(address), false);
-  if (result != I2C_RESULT_OK)
-    return result;
-
-  return I2C_Read(i2c, BME280_address, id, sizeof(*id), true);
+  return I2C_Transfer(i2c, BME280_address, &address, sizeof(address), id, sizeof(*id));
 }
 
 /**
@@ -39,7 +38,7 @@ I2C_Result BME280_GetID(I2C_TypeDef *i2c, uint8_t *id)
 I2C_Result BME280_Reset(I2C_TypeDef *i2c)
 {
   uint8_t resetData[2] = {0xE0, 0xB6};  // reset = 0xB6
-  return I2C_Write(i2c, BME280_address, &resetData[0], 2, true);
+  return I2C_Transfer(i2c, BME280_address, &resetData[0], sizeof(resetData), NULL, 0);
 }
 
 /**
@@ -50,16 +49,29 @@ I2C_Result BME280_Reset(I2C_TypeDef *i2c)
  */
 I2C_Result BME280_SetConfig(I2C_TypeDef *i2c, BME280_Config *config)
 {
-  uint8_t configData[6] = {
-    0xF5,   // config
-    (config->standbyTime & 0x07) << 5 | (config->filter & 0x07) << 2 | (config->useSPI3WireMode ? 0x01 : 0x00),
-    0xF2,   // ctrl_hum
-    config->humidityOversampling & 0x07,
-    0xF4,   // ctrl_meas
-    (config->temperatureOversampling & 0x07) << 5 | (config->pressureOversampling & 0x07) << 2 | (config->mode & 0x03)
-  };
+  uint8_t configData[BME280_CONFIG_DATA_LENGTH];
+  BME280_PrepareConfigData(config, &configData[0]);
+
+  return I2C_Transfer(i2c, BME280_address, &configData[0], sizeof(configData), NULL, 0);
+}
 
-  return I2C_Write(i2c, BME280_address, &configData[0], sizeof(configData), true);
+/**
+ * @brief Prepares the register writes setting the device configuration. Setting the forced mode starts a single
+ *   measurement, and the device returns to the sleep mode when it is completed.
+ * @param config A pointer to the BME280 configuration structure.
+ * @param data A pointer to the buffer of <i>BME280_CONFIG_DATA_LENGTH</i> bytes that will be filled with the register
+ *   address and value pairs to be written in a single I2C transfer.
+ */
+void BME280_PrepareConfigData(const BME280_Config *config, uint8_t *data)
+{
+  // The ctrl_hum register changes become effective only after the ctrl_meas register is written.
+  data[0] = 0xF5;   // config
+  data[1] = (config->standbyTime & 0x07) << 5 | (config->filter & 0x07) << 2 | (config->useSPI3WireMode ? 0x01 : 0x00);
+  data[2] = 0xF2;   // ctrl_hum
+  data[3] = config->humidityOversampling & 0x07;
+  data[4] = 0xF4;   // ctrl_meas
+  data[5] = (config->temperatureOversampling & 0x07) << 5 | (config->pressureOversampling & 0x07) << 2 |
+    (config->mode & 0x03);
 }
 
 /**
@@ -70,18 +82,27 @@ I2C_Result BME280_SetConfig(I2C_TypeDef *i2c, BME280_Config *config)
  */
 I2C_Result BME280_GetConfig(I2C_TypeDef *i2c, BME280_Config *config)
 {
-  uint8_t startAddress = 0xF2;  // ctrl_hum
-  uint8_t data[4];              // ctrl_hum .. config
+  uint8_t startAddress = BME280_CONTROL_ADDRESS;
+  uint8_t data[BME280_CONTROL_LENGTH];
   I2C_Result result;
 
-  result = I2C_Write(i2c, BME280_address, &startAddress, sizeof(startAddress), false);
+  result = I2C_Transfer(i2c, BME280_address, &startAddress, sizeof(startAddress), &data[0], sizeof(data));
   if (result != I2C_RESULT_OK)
     return result;
 
-  result = I2C_Read(i2c, BME280_address, &data[0], sizeof(data), true);
-  if (result != I2C_RESULT_OK)
-    return result;
+  BME280_ParseConfig(&data[0], config);
 
+  return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Decodes the device configuration from the control registers contents.
+ * @param data A pointer to the <i>BME280_CONTROL_LENGTH</i> bytes read starting from the <i>BME280_CONTROL_ADDRESS</i>
+ *   register.
+ * @param config A pointer to the BME280 configuration structure that will be filled with the decoded data.
+ */
+void BME280_ParseConfig(const uint8_t *data, BME280_Config *config)
+{
   config->humidityOversampling = data[0] & 0x07;
   config->temperatureOversampling = (data[2] & 0xE0) >> 5;
   config->pressureOversampling = (data[2] & 0x1C) >> 2;
@@ -89,8 +110,6 @@ I2C_Result BME280_GetConfig(I2C_TypeDef *i2c, BME280_Config *config)
   config->standbyTime = (data[3] & 0xE0) >> 5;
   config->filter = (data[3] & 0x1C) >> 2;
   config->useSPI3WireMode = data[3] & 0x01;
-
-  return I2C_RESULT_OK;
 }
 
 /**
@@ -105,18 +124,71 @@ I2C_Result BME280_GetStatus(I2C_TypeDef *i2c, BME280_Status *status)
   uint8_t statusByte;
   I2C_Result result;
 
-  result = I2C_Write(i2c, BME280_address, &statusAddress, sizeof(statusAddress), false);
+  result = I2C_Transfer(i2c, BME280_address, &statusAddress, sizeof(statusAddress), &statusByte, sizeof(statusByte));
   if (result != I2C_RESULT_OK)
     return result;
 
-  result = I2C_Read(i2c, BME280_address, &statusByte, sizeof(statusByte), true);
-  if (result != I2C_RESULT_OK)
-    return result;
+  BME280_ParseStatus(statusByte, status);
 
+  return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Decodes the device status from the status register value.
+ * @param statusByte The status register value.
+ * @param status A pointer to the BME280 status structure that will be filled with the decoded data.
+ */
+void BME280_ParseStatus(uint8_t statusByte, BME280_Status *status)
+{
   status->isMeasuring = statusByte & 0x08;
   status->isMemoryUpdating = statusByte & 0x01;
+}
 
-  return I2C_RESULT_OK;
+/**
+ * @brief The normal mode standby times in microseconds indexed by the <i>BME280_StandbyTime</i> enumeration values.
+ */
+static const uint32_t BME280_StandbyTimes[8] = {500, 62500, 125000, 250000, 500000, 1000000, 10000, 20000};
+
+/**
+ * @brief Converts the oversampling register field value to the number of the samples averaged.
+ * @param oversampling The oversampling register field value.
+ * @return The number of the samples averaged, or 0 if the measurement is skipped.
+ */
+static uint32_t BME280_GetOversamplingCount(uint8_t oversampling)
+{
+  return oversampling == 0 ? 0 : oversampling >= 5 ? 16 : 1U << (oversampling - 1);
+}
+
+/**
+ * @brief Calculates the time required for a single measurement with the oversampling factors of the configuration
+ *   using the formulas from the datasheet (section 9.1).
+ * @param config A pointer to the BME280 configuration structure.
+ * @param isMaximal If <i>true</i>, the maximal measurement time is calculated, otherwise the typical one.
+ * @return The measurement time in microseconds.
+ */
+uint32_t BME280_GetMeasurementTime(const BME280_Config *config, bool isMaximal)
+{
+  uint32_t temperatureCount = BME280_GetOversamplingCount(config->temperatureOversampling);
+  uint32_t pressureCount = BME280_GetOversamplingCount(config->pressureOversampling);
+  uint32_t humidityCount = BME280_GetOversamplingCount(config->humidityOversampling);
+  uint32_t sampleTime = isMaximal ? 2300 : 2000;
+  uint32_t setupTime = isMaximal ? 575 : 500;
+
+  return (isMaximal ? 1250 : 1000) + sampleTime * temperatureCount +
+    (pressureCount ? sampleTime * pressureCount + setupTime : 0) +
+    (humidityCount ? sampleTime * humidityCount + setupTime : 0);
+}
+
+/**
+ * @brief Calculates the normal mode conversion cycle time: the measurement time followed by the standby time. The
+ *   sensor outputs a new sample once per cycle.
+ * @param config A pointer to the BME280 configuration structure.
+ * @param isMaximal If <i>true</i>, the maximal cycle time is calculated, otherwise the typical one.
+ * @return The cycle time in microseconds.
+ */
+uint32_t BME280_GetCycleTime(const BME280_Config *config, bool isMaximal)
+{
+  return BME280_GetMeasurementTime(config, isMaximal) + BME280_StandbyTimes[config->standbyTime & 0x07];
 }
 
 /**
@@ -126,117 +198,603 @@ I2C_Result BME280_GetStatus(I2C_TypeDef *i2c, BME280_Status *status)
  * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
  */
 I2C_Result BME280_GetTrimmingParams(I2C_TypeDef *i2c, BME280_TrimmingParams *params)
+{
+  uint8_t trimmingData[BME280_TRIMMING_DATA_LENGTH];
+  I2C_Result result;
+
+  result = BME280_GetTrimmingData(i2c, &trimmingData[0]);
+  if (result != I2C_RESULT_OK)
+    return result;
+
+  BME280_ParseTrimmingParams(&trimmingData[0], params);
+
+  return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Gets the raw calibration data block (calib00 .. calib41) from the device.
+ * @param i2c A pointer to the I2C peripheral structure.
+ * @param trimmingData The output buffer of <i>BME280_TRIMMING_DATA_LENGTH</i> bytes.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ */
+I2C_Result BME280_GetTrimmingData(I2C_TypeDef *i2c, uint8_t *trimmingData)
 {
   uint8_t trimmingAddress1 = 0x88;  // calib00
   uint8_t trimmingLength1 = 26;     // calib00 .. calib25
   uint8_t trimmingAddress2 = 0xE1;  // calib26
   uint8_t trimmingLength2 = 16;     // calib26 .. calib41
-  uint8_t trimmingData[trimmingLength1 + trimmingLength1];
   I2C_Result result;
 
-  result = I2C_Write(i2c, BME280_address, &trimmingAddress1, sizeof(trimmingAddress1), false);
+  result = I2C_Transfer(i2c, BME280_address, &trimmingAddress1, sizeof(trimmingAddress1), &trimmingData[0],
+    trimmingLength1);
   if (result != I2C_RESULT_OK)
     return result;
 
-  result = I2C_Read(i2c, BME280_address, &trimmingData[0], trimmingLength1, false);
-  if (result != I2C_RESULT_OK)
-    return result;
+  return I2C_Transfer(i2c, BME280_address, &trimmingAddress2, sizeof(trimmingAddress2),
+    &trimmingData[trimmingLength1], trimmingLength2);
+}
 
-  result = I2C_Write(i2c, BME280_address, &trimmingAddress2, sizeof(trimmingAddress2), false);
-  if (result != I2C_RESULT_OK)
-    return result;
+/**
+ * @brief Gets the calibration data block signature from the device: the first <i>BME280_TRIMMING_SIGNATURE_LENGTH</i>
+ *   bytes of the block.
+ * @param i2c A pointer to the I2C peripheral structure.
+ * @param signature The output buffer of <i>BME280_TRIMMING_SIGNATURE_LENGTH</i> bytes.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ */
+I2C_Result BME280_GetTrimmingSignature(I2C_TypeDef *i2c, uint8_t *signature)
+{
+  uint8_t trimmingAddress = 0x88;   // calib00
+  return I2C_Transfer(i2c, BME280_address, &trimmingAddress, sizeof(trimmingAddress), signature,
+    BME280_TRIMMING_SIGNATURE_LENGTH);
+}
 
-  result = I2C_Read(i2c, BME280_address, &trimmingData[trimmingLength1], trimmingLength2, true);
+/**
+ * @brief Decodes the trimming parameters from the raw calibration data block and prepares the floating-point
+ *   compensation coefficients.
+ * @param trimmingData A pointer to the <i>BME280_TRIMMING_DATA_LENGTH</i> bytes read by the
+ *   <i>BME280_GetTrimmingData</i> function.
+ * @param params A pointer to the BME280 trimming parameters structure that will be filled with the decoded data.
+ */
+void BME280_ParseTrimmingParams(const uint8_t *trimmingData, BME280_TrimmingParams *params)
+{
+  params->digT[0] = (uint16_t) (trimmingData[0] | trimmingData[1] << 8);
+  params->digT[1] = (int16_t) (trimmingData[2] | trimmingData[3] << 8);
+  params->digT[2] = (int16_t) (trimmingData[4] | trimmingData[5] << 8);
+
+  params->digP[0] = (uint16_t) (trimmingData[6] | trimmingData[7] << 8);
+  params->digP[1] = (int16_t) (trimmingData[8] | trimmingData[9] << 8);
+  params->digP[2] = (int16_t) (trimmingData[10] | trimmingData[11] << 8);
+  params->digP[3] = (int16_t) (trimmingData[12] | trimmingData[13] << 8);
+  params->digP[4] = (int16_t) (trimmingData[14] | trimmingData[15] << 8);
+  params->digP[5] = (int16_t) (trimmingData[16] | trimmingData[17] << 8);
+  params->digP[6] = (int16_t) (trimmingData[18] | trimmingData[19] << 8);
+  params->digP[7] = (int16_t) (trimmingData[20] | trimmingData[21] << 8);
+  params->digP[8] = (int16_t) (trimmingData[22] | trimmingData[23] << 8);
+
+  params->digH[0] = (uint8_t) trimmingData[25];
+  params->digH[1] = (int16_t) (trimmingData[26] | trimmingData[27] << 8);
+  params->digH[2] = (uint8_t) trimmingData[28];
+  params->digH[3] = (int16_t) (trimmingData[29] << 4 | (trimmingData[30] & 0x0F));
+  params->digH[4] = (int16_t) (trimmingData[30] >> 4 | trimmingData[31] << 4);
+  params->digH[5] = (int8_t) trimmingData[32];
+
+  BME280_PrepareTrimmingParams(params);
+}
+
+/**
+ * @brief Prepares the floating-point compensation coefficients from the integer trimming parameters. All the
+ *   sample-independent terms of the compensation formulas are folded, and the divisions by constants are turned into
+ *   multiplications, so that the compensation reduces to short multiply-add chains.
+ * @param params A pointer to the BME280 trimming parameters structure with the <i>digT</i>, <i>digP</i>, and
+ *   <i>digH</i> arrays filled. Its <i>t</i>, <i>p</i>, and <i>h</i> arrays will be filled with the coefficients.
+ */
+void BME280_PrepareTrimmingParams(BME280_TrimmingParams *params)
+{
+  const int32_t *digT = params->digT;
+  const int32_t *digP = params->digP;
+  const int32_t *digH = params->digH;
+
+  // t_fine = dT * (T2 / 2^14 + dT * T3 / 2^34), where dT = adc_T - 16 * T1 (computed exactly).
+  params->t[0] = (float) (16 * digT[0]);
+  params->t[1] = (float) digT[1] / 16384.0F;
+  params->t[2] = (float) digT[2] / 17179869184.0F;
+
+  // Offset polynomial of v = t_fine / 2 - 64000: P4 * 16 - 2^20 + v * P5 / 2^13 + v^2 * P6 / 2^29.
+  params->p[0] = (float) (digP[3] * 16 - 1048576);
+  params->p[1] = (float) digP[4] / 8192.0F;
+  params->p[2] = (float) digP[5] / 536870912.0F;
+
+  // Divisor polynomial of v: P1 + v * P1 * P2 / 2^34 + v^2 * P1 * P3 / 2^53.
+  params->p[3] = (float) digP[0];
+  params->p[4] = (float) digP[0] * (float) digP[1] / 17179869184.0F;
+  params->p[5] = (float) digP[0] * (float) digP[2] / 9007199254740992.0F;
+
+  // Output polynomial of the intermediate pressure x: P7 / 16 + x * (1 + P8 / 2^19) + x^2 * P9 / 2^35.
+  params->p[6] = (float) digP[6] / 16.0F;
+  params->p[7] = 1.0F + (float) digP[7] / 524288.0F;
+  params->p[8] = (float) digP[8] / 34359738368.0F;
+
+  // Offset H4 * 64 + h * H5 / 2^14, gain polynomial H2 / 2^16 * (1 + h * H6 / 2^26 + h^2 * H6 * H3 / 2^52), and
+  // saturation factor -H1 / 2^19, where h = t_fine - 76800.
+  params->h[0] = (float) (digH[3] * 64);
+  params->h[1] = -(float) digH[4] / 16384.0F;
+  params->h[2] = (float) digH[1] / 65536.0F;
+  params->h[3] = (float) digH[1] * (float) digH[5] / 4398046511104.0F;
+  params->h[4] = (float) digH[1] * (float) digH[5] * (float) digH[2] / 295147905179352825856.0F;
+  params->h[5] = -(float) digH[0] / 524288.0F;
+}
+
+/**
+ * @brief Gets the last measured uncompensated ADC data from the device. Only the data registers of the requested
+ *   channels are read in a single burst: the pressure registers precede the temperature ones, and the humidity
+ *   registers follow them.
+ * @param i2c A pointer to the I2C peripheral structure.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to read. The temperature data are
+ *   always read, as the other channels compensation depends on them.
+ * @param rawData A pointer to the BME280 raw data structure that will be filled with the data from the device. The
+ *   values of the channels not requested are set to zero.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ */
+I2C_Result BME280_GetRawData(I2C_TypeDef *i2c, uint8_t channels, BME280_RawData *rawData)
+{
+  uint8_t first = channels & BME280_CHANNEL_PRESSURE ? 0 : BME280_RAW_TEMPERATURE_OFFSET;
+  uint8_t last = channels & BME280_CHANNEL_HUMIDITY ? BME280_RAW_DATA_LENGTH : BME280_RAW_HUMIDITY_OFFSET;
+  uint8_t rawDataAddress = BME280_RAW_DATA_ADDRESS + first;
+  uint8_t data[BME280_RAW_DATA_LENGTH] = {0};
+  I2C_Result result;
+
+  result = I2C_Transfer(i2c, BME280_address, &rawDataAddress, sizeof(rawDataAddress), &data[first], last - first);
   if (result != I2C_RESULT_OK)
     return result;
 
-  params->t[0] = (uint16_t) (trimmingData[0] | trimmingData[1] << 8);
-  params->t[1] = (int16_t) (trimmingData[2] | trimmingData[3] << 8);
-  params->t[2] = (int16_t) (trimmingData[4] | trimmingData[5] << 8);
-
-  params->p[0] = (uint16_t) (trimmingData[6] | trimmingData[7] << 8);
-  params->p[1] = (int16_t) (trimmingData[8] | trimmingData[9] << 8);
-  params->p[2] = (int16_t) (trimmingData[10] | trimmingData[11] << 8);
-  params->p[3] = (int16_t) (trimmingData[12] | trimmingData[13] << 8);
-  params->p[4] = (int16_t) (trimmingData[14] | trimmingData[15] << 8);
-  params->p[5] = (int16_t) (trimmingData[16] | trimmingData[17] << 8);
-  params->p[6] = (int16_t) (trimmingData[18] | trimmingData[19] << 8);
-  params->p[7] = (int16_t) (trimmingData[20] | trimmingData[21] << 8);
-  params->p[8] = (int16_t) (trimmingData[22] | trimmingData[23] << 8);
-
-  params->h[0] = (uint8_t) trimmingData[25];
-  params->h[1] = (int16_t) (trimmingData[26] | trimmingData[27] << 8);
-  params->h[2] = (uint8_t) trimmingData[28];
-  params->h[3] = (int16_t) (trimmingData[29] << 4 | trimmingData[30] & 0x0F);
-  params->h[4] = (int16_t) (trimmingData[30] >> 4 | trimmingData[31] << 4);
-  params->h[5] = (int8_t) trimmingData[32];
+  BME280_ParseRawData(&data[0], rawData);
 
   return I2C_RESULT_OK;
 }
 
+/**
+ * @brief Decodes the uncompensated ADC data from the data registers contents.
+ * @param data A pointer to the <i>BME280_RAW_DATA_LENGTH</i> bytes read starting from the
+ *   <i>BME280_RAW_DATA_ADDRESS</i> register.
+ * @param rawData A pointer to the BME280 raw data structure that will be filled with the decoded data.
+ */
+void BME280_ParseRawData(const uint8_t *data, BME280_RawData *rawData)
+{
+  rawData->pressure = (data[0] << 12) | (data[1] << 4) | (data[2] >> 4);
+  rawData->temperature = (data[3] << 12) | (data[4] << 4) | (data[5] >> 4);
+  rawData->humidity = (data[6] << 8) | data[7];
+}
+
 /**
  * @brief Gets the last measured climatic data from the device.
  * @param i2c A pointer to the I2C peripheral structure.
  * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to read and calculate.
  * @param measurement A pointer to the BME280 measurement structure that will be filled with the calculated climatic
- *   data measured by the device.
+ *   data measured by the device. The values of the channels not requested are left unchanged.
  * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
  */
-I2C_Result BME280_GetMeasurement(I2C_TypeDef *i2c, BME280_TrimmingParams *params, BME280_Measurement *measurement)
+I2C_Result BME280_GetMeasurement(I2C_TypeDef *i2c, BME280_TrimmingParams *params, uint8_t channels,
+  BME280_Measurement *measurement)
 {
-  uint8_t rawDataAddress = 0xF7;  // press_msb
-  uint8_t rawData[8];             // press_msb .. hum_lsb
+  BME280_RawData rawData;
   I2C_Result result;
 
-  result = I2C_Write(i2c, BME280_address, &rawDataAddress, sizeof(rawDataAddress), false);
+  result = BME280_GetRawData(i2c, channels, &rawData);
   if (result != I2C_RESULT_OK)
     return result;
 
-  result = I2C_Read(i2c, BME280_address, &rawData[0], sizeof(rawData), true);
-  if (result != I2C_RESULT_OK)
-    return result;
+  BME280_Compensate(params, &rawData, channels, measurement);
+
+  return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Calculates the climatic data from the uncompensated ADC data using the engine selected by the
+ *   <i>BME280_compensation</i> variable.
+ * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param rawData A pointer to the BME280 raw data structure containing the uncompensated ADC data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to calculate.
+ * @param measurement A pointer to the BME280 measurement structure that will be filled with the calculated climatic
+ *   data. The values of the channels not requested are left unchanged.
+ */
+void BME280_Compensate(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement)
+{
+  switch (BME280_compensation)
+  {
+    case BME280_COMPENSATION_INT32:
+      return BME280_CompensateInt32(params, rawData, channels, measurement);
+    case BME280_COMPENSATION_INT64:
+      return BME280_CompensateInt64(params, rawData, channels, measurement);
+    default:
+      return BME280_CompensateFloat(params, rawData, channels, measurement);
+  }
+}
 
-  // Collecting the sensor data.
-  uint32_t pData = (rawData[0] << 12) | (rawData[1] << 4) | (rawData[2] >> 4);
-  uint32_t tData = (rawData[3] << 12) | (rawData[4] << 4) | (rawData[5] >> 4);
-  uint32_t hData = (rawData[6] << 8) | rawData[7];
+/**
+ * @brief Calculates the climatic data using the single-precision floating-point formulas with the prepared
+ *   coefficients (see <i>BME280_PrepareTrimmingParams</i>).
+ * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param rawData A pointer to the BME280 raw data structure containing the uncompensated ADC data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to calculate.
+ * @param measurement A pointer to the BME280 measurement structure that will be filled with the calculated climatic
+ *   data. The values of the channels not requested are left unchanged.
+ */
+void BME280_CompensateFloat(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement)
+{
+  const float *t = params->t;
+  const float *p = params->p;
+  const float *h = params->h;
 
   // Computing the temperature.
-  float t1 = ((float) tData / 16384.0F - params->t[0] / 1024.0F) * params->t[1];
-  float t2 =
-    (((float) tData / 131072.0F - params->t[0] / 8192.0F) * ((float) tData / 131072.0F - params->t[0] / 8192.0F)) *
-      params->t[2];
-  float tFine = t1 + t2;
-  measurement->temperature = (t1 + t2) / 5120.0F;
+  float dT = (float) rawData->temperature - t[0];
+  float tFine = dT * (t[1] + dT * t[2]);
+  if (channels & BME280_CHANNEL_TEMPERATURE)
+  {
+    float temperature = tFine * (1.0F / 5120.0F);
+    float temperatureFixed = temperature * 100.0F;
+    measurement->temperature = temperature;
+    measurement->temperatureFixed = (int32_t) (temperatureFixed + (temperatureFixed < 0.0F ? -0.5F : 0.5F));
+  }
 
   // Computing the pressure.
-  float p1 = tFine / 2.0F - 64000.0F;
-  float p2 = p1 * p1 * params->p[5] / 32768.0F;
-  p2 = p2 + p1 * params->p[4] * 2.0F;
-  p2 = p2 / 4.0F + params->p[3] * 65536.0F;
-  p1 = (params->p[2] * p1 * p1 / 524288.0F + params->p[1] * p1) / 524288.0F;
-  p1 = (1.0F + p1 / 32768.0F) * params->p[0];
-  if (p1 != 0.0)
+  if (channels & BME280_CHANNEL_PRESSURE)
   {
-    float p3 = 1048576.0F - (float) pData;
-    p3 = (p3 - p2 / 4096.0F) * 6250.0F / p1;
-    p1 = params->p[8] * p3 * p3 / 2147483648.0F;
-    p2 = p3 * params->p[7] / 32768.0F;
-    measurement->pressure = p3 + (p1 + p2 + params->p[6]) / 16.0F;
+    float v = tFine * 0.5F - 64000.0F;
+    float divisor = p[3] + v * (p[4] + v * p[5]);
+    if (divisor != 0.0F)
+    {
+      float x = ((float) rawData->pressure + (p[0] + v * (p[1] + v * p[2]))) * (-6250.0F / divisor);
+      measurement->pressure = p[6] + x * (p[7] + x * p[8]);
+      measurement->pressureFixed = (uint32_t) (measurement->pressure * 256.0F + 0.5F);
+    }
+    else
+    {
+      measurement->pressure = 0;
+      measurement->pressureFixed = 0;
+    }
   }
-  else
-    measurement->pressure = 0;
 
   // Computing the humidity.
-  float h = tFine - 76800.0F;
-  h = ((float) hData - (params->h[3] * 64.0F + params->h[4] / 16384.0F * h)) *
-    (params->h[1] / 65536.0F * (1.0F + params->h[5] / 67108864.0F * h * (1.0F + params->h[2] / 67108864.0F * h)));
-  h = h * (1.0F - params->h[0] * h / 524288.0F);
-  if (h > 100.0F)
-    h = 100.0F;
-  else if (h < 0.0F)
-    h = 0.0F;
-  measurement->humidity = h;
+  if (channels & BME280_CHANNEL_HUMIDITY)
+  {
+    float dH = tFine - 76800.0F;
+    float humidity = ((float) rawData->humidity - h[0] + dH * h[1]) * (h[2] + dH * (h[3] + dH * h[4]));
+    humidity = humidity * (1.0F + humidity * h[5]);
+    if (humidity > 100.0F)
+      humidity = 100.0F;
+    else if (humidity < 0.0F)
+      humidity = 0.0F;
+    measurement->humidity = humidity;
+    measurement->humidityFixed = (uint32_t) (humidity * 1024.0F + 0.5F);
+  }
+}
 
-  return I2C_RESULT_OK;
+/**
+ * @brief Calculates the fine resolution temperature value shared by all the integer compensation formulas.
+ * @param params A pointer to the BME280 trimming parameters structure.
+ * @param adcT The uncompensated temperature ADC value.
+ * @return The fine resolution temperature value (5120 LSB/degC).
+ */
+static int32_t BME280_GetFineTemperature(const BME280_TrimmingParams *params, int32_t adcT)
+{
+  int32_t var1 = (((adcT >> 3) - (params->digT[0] << 1)) * params->digT[1]) >> 11;
+  int32_t var2 = (((((adcT >> 4) - params->digT[0]) * ((adcT >> 4) - params->digT[0])) >> 12) * params->digT[2]) >> 14;
+  return var1 + var2;
+}
+
+/**
+ * @brief Calculates the humidity using the 32-bit integer formula.
+ * @param params A pointer to the BME280 trimming parameters structure.
+ * @param adcH The uncompensated humidity ADC value.
+ * @param tFine The fine resolution temperature value.
+ * @return The relative humidity in the Q22.10 format (1024 LSB/%).
+ */
+static uint32_t BME280_GetHumidityInt32(const BME280_TrimmingParams *params, int32_t adcH, int32_t tFine)
+{
+  int32_t h = tFine - 76800;
+  h = (((adcH << 14) - (params->digH[3] << 20) - params->digH[4] * h + 16384) >> 15) *
+    (((((((h * params->digH[5]) >> 10) * (((h * params->digH[2]) >> 11) + 32768)) >> 10) + 2097152) *
+      params->digH[1] + 8192) >> 14);
+  h = h - (((((h >> 15) * (h >> 15)) >> 7) * params->digH[0]) >> 4);
+  h = h < 0 ? 0 : h;
+  h = h > 419430400 ? 419430400 : h;
+  return (uint32_t) (h >> 12);
+}
+
+/**
+ * @brief Calculates the climatic data using the 32-bit integer formulas.
+ * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param rawData A pointer to the BME280 raw data structure containing the uncompensated ADC data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to calculate.
+ * @param measurement A pointer to the BME280 measurement structure that will be filled with the calculated climatic
+ *   data. The values of the channels not requested are left unchanged.
+ */
+void BME280_CompensateInt32(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement)
+{
+  const int32_t *digP = params->digP;
+
+  // Computing the temperature (0.01 degC resolution).
+  int32_t tFine = BME280_GetFineTemperature(params, rawData->temperature);
+  if (channels & BME280_CHANNEL_TEMPERATURE)
+  {
+    measurement->temperatureFixed = (tFine * 5 + 128) >> 8;
+    measurement->temperature = (float) measurement->temperatureFixed / 100.0F;
+  }
+
+  // Computing the pressure (1 Pa resolution).
+  if (channels & BME280_CHANNEL_PRESSURE)
+  {
+    int32_t var1 = (tFine >> 1) - 64000;
+    int32_t var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * digP[5];
+    var2 = var2 + ((var1 * digP[4]) << 1);
+    var2 = (var2 >> 2) + (digP[3] << 16);
+    var1 = (((digP[2] * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) + ((digP[1] * var1) >> 1)) >> 18;
+    var1 = ((32768 + var1) * digP[0]) >> 15;
+    if (var1 != 0)
+    {
+      uint32_t p = ((uint32_t) (1048576 - rawData->pressure) - (var2 >> 12)) * 3125;
+      p = p < 0x80000000 ? (p << 1) / (uint32_t) var1 : (p / (uint32_t) var1) * 2;
+      var1 = (digP[8] * (int32_t) (((p >> 3) * (p >> 3)) >> 13)) >> 12;
+      var2 = ((int32_t) (p >> 2) * digP[7]) >> 13;
+      p = (uint32_t) ((int32_t) p + ((var1 + var2 + digP[6]) >> 4));
+      measurement->pressure = (float) p;
+      measurement->pressureFixed = p << 8;
+    }
+    else
+    {
+      measurement->pressure = 0;
+      measurement->pressureFixed = 0;
+    }
+  }
+
+  // Computing the humidity.
+  if (channels & BME280_CHANNEL_HUMIDITY)
+  {
+    measurement->humidityFixed = BME280_GetHumidityInt32(params, rawData->humidity, tFine);
+    measurement->humidity = (float) measurement->humidityFixed / 1024.0F;
+  }
+}
+
+/**
+ * @brief Calculates the climatic data using the 32-bit integer formulas and the 64-bit integer pressure formula.
+ * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param rawData A pointer to the BME280 raw data structure containing the uncompensated ADC data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to calculate.
+ * @param measurement A pointer to the BME280 measurement structure that will be filled with the calculated climatic
+ *   data. The values of the channels not requested are left unchanged.
+ */
+void BME280_CompensateInt64(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement)
+{
+  const int32_t *digP = params->digP;
+
+  // Computing the temperature (0.01 degC resolution).
+  int32_t tFine = BME280_GetFineTemperature(params, rawData->temperature);
+  if (channels & BME280_CHANNEL_TEMPERATURE)
+  {
+    measurement->temperatureFixed = (tFine * 5 + 128) >> 8;
+    measurement->temperature = (float) measurement->temperatureFixed / 100.0F;
+  }
+
+  // Computing the pressure (Q24.8 format, 1/256 Pa resolution).
+  if (channels & BME280_CHANNEL_PRESSURE)
+  {
+    int64_t var1 = (int64_t) tFine - 128000;
+    int64_t var2 = var1 * var1 * digP[5];
+    var2 = var2 + ((var1 * digP[4]) << 17);
+    var2 = var2 + ((int64_t) digP[3] << 35);
+    var1 = ((var1 * var1 * digP[2]) >> 8) + ((var1 * digP[1]) << 12);
+    var1 = ((((int64_t) 1 << 47) + var1) * digP[0]) >> 33;
+    if (var1 != 0)
+    {
+      int64_t p = 1048576 - rawData->pressure;
+      p = (((p << 31) - var2) * 3125) / var1;
+      var1 = (digP[8] * (p >> 13) * (p >> 13)) >> 25;
+      var2 = (digP[7] * p) >> 19;
+      p = ((p + var1 + var2) >> 8) + ((int64_t) digP[6] << 4);
+      measurement->pressureFixed = (uint32_t) p;
+      measurement->pressure = (float) measurement->pressureFixed / 256.0F;
+    }
+    else
+    {
+      measurement->pressure = 0;
+      measurement->pressureFixed = 0;
+    }
+  }
+
+  // Computing the humidity.
+  if (channels & BME280_CHANNEL_HUMIDITY)
+  {
+    measurement->humidityFixed = BME280_GetHumidityInt32(params, rawData->humidity, tFine);
+    measurement->humidity = (float) measurement->humidityFixed / 1024.0F;
+  }
+}
+
+/**
+ * @brief Multiplies two 32-bit values and adds two more ones to the 64-bit product. The result never overflows.
+ * @note Uses the UMAAL instruction of the Cortex-M4 DSP extension if available.
+ */
+static inline uint64_t BME280_MultiplyAccumulate(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+  __ASM ("umaal %0, %1, %2, %3" : "+r" (c), "+r" (d) : "r" (a), "r" (b));
+  return (uint64_t) d << 32 | c;
+#else
+  return (uint64_t) a * b + c + d;
+#endif
+}
+
+/**
+ * @brief Gets the upper 64 bits of the 128-bit product of two 64-bit values.
+ */
+static inline uint64_t BME280_MultiplyHigh(uint64_t a, uint64_t b)
+{
+  uint32_t aLow = (uint32_t) a, aHigh = (uint32_t) (a >> 32);
+  uint32_t bLow = (uint32_t) b, bHigh = (uint32_t) (b >> 32);
+
+  uint64_t low = (uint64_t) aLow * bLow;
+  uint64_t middle1 = BME280_MultiplyAccumulate(aHigh, bLow, (uint32_t) (low >> 32), 0);
+  uint64_t middle2 = BME280_MultiplyAccumulate(aLow, bHigh, (uint32_t) middle1, 0);
+  return BME280_MultiplyAccumulate(aHigh, bHigh, (uint32_t) (middle1 >> 32), (uint32_t) (middle2 >> 32));
+}
+
+/**
+ * @brief The terms of the integer compensation formulas depending on the temperature only. They are shared by the
+ *   consecutive samples having the same temperature ADC value, which is typical for the oversampled bursts.
+ */
+typedef struct BME280_BatchTerms
+{
+  int32_t adcT;
+  int32_t tFine;
+  int32_t temperatureFixed;
+  float temperature;
+  int64_t pressureOffset;
+  int64_t pressureDivisor;
+  uint64_t pressureReciprocal;
+  uint32_t humidityOffset;
+  int32_t humidityFactor;
+} BME280_BatchTerms;
+
+/**
+ * @brief Calculates the temperature dependent terms of the integer formulas the same way the
+ *   <i>BME280_CompensateInt64</i> function does.
+ */
+static void BME280_GetBatchTerms(const BME280_TrimmingParams *params, int32_t adcT, BME280_BatchTerms *terms)
+{
+  const int32_t *digP = params->digP;
+  const int32_t *digH = params->digH;
+
+  terms->adcT = adcT;
+  terms->tFine = BME280_GetFineTemperature(params, adcT);
+  terms->temperatureFixed = (terms->tFine * 5 + 128) >> 8;
+  terms->temperature = (float) terms->temperatureFixed / 100.0F;
+
+  int64_t var1 = (int64_t) terms->tFine - 128000;
+  int64_t var2 = var1 * var1 * digP[5];
+  var2 = var2 + ((var1 * digP[4]) << 17);
+  terms->pressureOffset = var2 + ((int64_t) digP[3] << 35);
+  var1 = ((var1 * var1 * digP[2]) >> 8) + ((var1 * digP[1]) << 12);
+  terms->pressureDivisor = ((((int64_t) 1 << 47) + var1) * digP[0]) >> 33;
+
+  terms->pressureReciprocal = 0;
+
+  // The wrapping unsigned arithmetic keeps the result of the reordered sum the same.
+  int32_t h = terms->tFine - 76800;
+  terms->humidityOffset = 16384U - ((uint32_t) digH[3] << 20) - (uint32_t) (digH[4] * h);
+  terms->humidityFactor = (((((((h * digH[5]) >> 10) * (((h * digH[2]) >> 11) + 32768)) >> 10) + 2097152) * digH[1] +
+    8192) >> 14);
+}
+
+/**
+ * @brief Divides the 64-bit value by the pressure divisor truncating the quotient towards zero. The quotient estimated
+ *   using the reciprocal is less than the exact one by one at most.
+ */
+static inline int64_t BME280_DividePressure(const BME280_BatchTerms *terms, int64_t value)
+{
+  if (terms->pressureReciprocal == 0)
+    return value / terms->pressureDivisor;
+
+  uint64_t divisor = (uint64_t) terms->pressureDivisor;
+  uint64_t dividend = value < 0 ? -(uint64_t) value : (uint64_t) value;
+  uint64_t quotient = BME280_MultiplyHigh(dividend, terms->pressureReciprocal);
+  if (dividend - quotient * divisor >= divisor)
+    quotient++;
+  return value < 0 ? -(int64_t) quotient : (int64_t) quotient;
+}
+
+/**
+ * @brief Calculates the climatic data of a batch of samples using the same formulas as the
+ *   <i>BME280_CompensateInt64</i> function with the bit-exact results, but several times faster. The temperature
+ *   dependent terms are calculated once for the consecutive samples having the same temperature ADC value, and the
+ *   64-bit pressure division is replaced with the multiplication by the reciprocal.
+ * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param rawData An array of the BME280 raw data structures containing the uncompensated ADC data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to calculate.
+ * @param measurements An array of the BME280 measurement structures that will be filled with the calculated climatic
+ *   data. The values of the channels not requested are left unchanged.
+ * @param count The number of samples.
+ */
+void BME280_CompensateInt64Batch(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurements, uint32_t count)
+{
+  const int32_t *digP = params->digP;
+  const int32_t *digH = params->digH;
+  BME280_BatchTerms terms = {.adcT = -1};
+
+  for (uint32_t index = 0; index < count; index++)
+  {
+    const BME280_RawData *sample = &rawData[index];
+    BME280_Measurement *measurement = &measurements[index];
+    if (sample->temperature != terms.adcT)
+      BME280_GetBatchTerms(params, sample->temperature, &terms);
+
+    // The divisor of the valid trimming parameters fits into 32 bits, so that once the terms are shared by several
+    // samples, the 64-bit divisions are replaced with the multiplications by the reciprocal.
+    else if (terms.pressureReciprocal == 0 && terms.pressureDivisor > 0 && terms.pressureDivisor <= UINT32_MAX)
+      terms.pressureReciprocal = UINT64_MAX / (uint64_t) terms.pressureDivisor;
+
+    // Computing the temperature (0.01 degC resolution).
+    if (channels & BME280_CHANNEL_TEMPERATURE)
+    {
+      measurement->temperature = terms.temperature;
+      measurement->temperatureFixed = terms.temperatureFixed;
+    }
+
+    // Computing the pressure (Q24.8 format, 1/256 Pa resolution).
+    if (channels & BME280_CHANNEL_PRESSURE)
+    {
+      if (terms.pressureDivisor != 0)
+      {
+        int64_t p = 1048576 - sample->pressure;
+        p = BME280_DividePressure(&terms, ((p << 31) - terms.pressureOffset) * 3125);
+        int64_t var1 = (digP[8] * (p >> 13) * (p >> 13)) >> 25;
+        int64_t var2 = (digP[7] * p) >> 19;
+        p = ((p + var1 + var2) >> 8) + ((int64_t) digP[6] << 4);
+        measurement->pressureFixed = (uint32_t) p;
+        measurement->pressure = (float) measurement->pressureFixed / 256.0F;
+      }
+      else
+      {
+        measurement->pressure = 0;
+        measurement->pressureFixed = 0;
+      }
+    }
+
+    // Computing the humidity.
+    if (channels & BME280_CHANNEL_HUMIDITY)
+    {
+      int32_t h = (int32_t) (((uint32_t) sample->humidity << 14) + terms.humidityOffset) >> 15;
+      h = h * terms.humidityFactor;
+      h = h - (((((h >> 15) * (h >> 15)) >> 7) * digH[0]) >> 4);
+      h = h < 0 ? 0 : h;
+      h = h > 419430400 ? 419430400 : h;
+      measurement->humidityFixed = (uint32_t) (h >> 12);
+      measurement->humidity = (float) measurement->humidityFixed / 1024.0F;
+    }
+  }
+}
+
+/**
+ * @brief Calculates the climatic data of a batch of samples using the engine selected by the
+ *   <i>BME280_compensation</i> variable. The 64-bit integer engine uses the batched kernel (see
+ *   <i>BME280_CompensateInt64Batch</i>), the other ones compensate the samples one by one.
+ * @param params A pointer to the BME280 trimming parameters structure that will be used to calibrate the measured data.
+ * @param rawData An array of the BME280 raw data structures containing the uncompensated ADC data.
+ * @param channels The mask of the <i>BME280_Channel</i> flags selecting the data to calculate.
+ * @param measurements An array of the BME280 measurement structures that will be filled with the calculated climatic
+ *   data. The values of the channels not requested are left unchanged.
+ * @param count The number of samples.
+ */
+void BME280_CompensateBatch(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurements, uint32_t count)
+{
+  if (BME280_compensation == BME280_COMPENSATION_INT64)
+    return BME280_CompensateInt64Batch(params, rawData, channels, measurements, count);
+
+  for (uint32_t index = 0; index < count; index++)
+    BME280_Compensate(params, &rawData[index], channels, &measurements[index]);
 }
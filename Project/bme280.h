@@ -14,6 +14,65 @@
 #include "main.h"
 #include "i2c.h"
 
+/**
+ * @brief Defines the address of the first control register (ctrl_hum).
+ */
+#define BME280_CONTROL_ADDRESS 0xF2
+
+/**
+ * @brief Defines the number of the control registers (ctrl_hum .. config).
+ */
+#define BME280_CONTROL_LENGTH 4
+
+/**
+ * @brief Defines the address of the first data register (press_msb).
+ */
+#define BME280_RAW_DATA_ADDRESS 0xF7
+
+/**
+ * @brief Defines the number of the data registers (press_msb .. hum_lsb).
+ */
+#define BME280_RAW_DATA_LENGTH 8
+
+/**
+ * @brief Defines the length of the raw calibration data block (calib00 .. calib41).
+ */
+#define BME280_TRIMMING_DATA_LENGTH 42
+
+/**
+ * @brief Defines the length of the calibration data block signature (calib00 .. calib07, the temperature trimming
+ *   parameters and dig_P1). The devices are trimmed individually, so it tells them apart at a fraction of the whole
+ *   block reading cost.
+ */
+#define BME280_TRIMMING_SIGNATURE_LENGTH 8
+
+/**
+ * @brief Defines the uncompensated pressure and temperature data value reported before the first measurement after a
+ *   reset, or for the skipped channel.
+ */
+#define BME280_RAW_DATA_RESET_VALUE 0x80000
+
+/**
+ * @brief Defines the length of the register writes setting the device configuration (config, ctrl_hum, and ctrl_meas
+ *   address and value pairs).
+ */
+#define BME280_CONFIG_DATA_LENGTH 6
+
+/**
+ * @brief Defines the offset of the status register from the first control register.
+ */
+#define BME280_STATUS_OFFSET 1
+
+/**
+ * @brief Defines the offset of the temperature data registers (temp_msb .. temp_xlsb) from the first data register.
+ */
+#define BME280_RAW_TEMPERATURE_OFFSET 3
+
+/**
+ * @brief Defines the offset of the humidity data registers (hum_msb .. hum_lsb) from the first data register.
+ */
+#define BME280_RAW_HUMIDITY_OFFSET 6
+
 /**
  * @brief The BME280 status structure.
  */
@@ -113,32 +172,128 @@ typedef struct BME280_Config
   bool useSPI3WireMode;
 } BME280_Config;
 
+/**
+ * @brief The BME280 measurement compensation engines enumeration.
+ */
+typedef enum BME280_Compensation
+{
+  /**
+   * @brief Single-precision floating-point compensation formulas.
+   */
+  BME280_COMPENSATION_FLOAT,
+
+  /**
+   * @brief 32-bit integer compensation formulas. The temperature resolution is limited to 0.01 degC, and the pressure
+   *   resolution is limited to 1 Pa.
+   */
+  BME280_COMPENSATION_INT32,
+
+  /**
+   * @brief 32-bit integer compensation formulas with the 64-bit integer pressure formula. The temperature resolution
+   *   is limited to 0.01 degC, and the pressure resolution is 1/256 Pa.
+   */
+  BME280_COMPENSATION_INT64
+} BME280_Compensation;
+
+/**
+ * @brief The BME280 measurement channel flags. The channels are combined into a mask to select the data to be read and
+ *   compensated. The temperature is always compensated internally, as the other channels depend on it.
+ */
+typedef enum BME280_Channel
+{
+  BME280_CHANNEL_TEMPERATURE = 0x01,
+  BME280_CHANNEL_PRESSURE = 0x02,
+  BME280_CHANNEL_HUMIDITY = 0x04,
+  BME280_CHANNEL_ALL = 0x07
+} BME280_Channel;
+
+/**
+ * @brief The BME280 uncompensated ADC data structure.
+ */
+typedef struct BME280_RawData
+{
+  int32_t pressure;
+  int32_t temperature;
+  int32_t humidity;
+} BME280_RawData;
+
 /**
  * @brief The BME280 measurement data structure.
+ * @note The fixed-point values are the exact results of the integer compensation engines, while the floating-point
+ *   ones may be rounded, e.g. the pressure above 65536 Pa has less than 8 fractional bits in the single precision. The
+ *   floating-point engine rounds its results to the fixed-point values.
  */
 typedef struct BME280_Measurement
 {
   float temperature;
   float pressure;
   float humidity;
+
+  /**
+   * @brief The temperature in 0.01 degC.
+   */
+  int32_t temperatureFixed;
+
+  /**
+   * @brief The pressure in the Q24.8 format (256 LSB/Pa).
+   */
+  uint32_t pressureFixed;
+
+  /**
+   * @brief The relative humidity in the Q22.10 format (1024 LSB/%).
+   */
+  uint32_t humidityFixed;
 } BME280_Measurement;
 
 /**
  * @brief The BME280 trimming parameters data arrays.
+ * @note The <i>digT</i>, <i>digP</i>, and <i>digH</i> arrays contain the values read from the device and are used by
+ *   the integer compensation formulas. The <i>t</i>, <i>p</i>, and <i>h</i> arrays contain the coefficients prepared
+ *   from them for the floating-point formulas (see <i>BME280_PrepareTrimmingParams</i>).
  */
 typedef struct BME280_TrimmingParams
 {
+  int32_t digT[3];
+  int32_t digP[9];
+  int32_t digH[6];
   float t[3];
   float p[9];
   float h[6];
 } BME280_TrimmingParams;
 
+extern volatile uint8_t BME280_address;
+extern BME280_Compensation BME280_compensation;
+
 I2C_Result BME280_GetID(I2C_TypeDef *i2c, uint8_t *id);
 I2C_Result BME280_Reset(I2C_TypeDef *i2c);
 I2C_Result BME280_SetConfig(I2C_TypeDef *i2c, BME280_Config *config);
+void BME280_PrepareConfigData(const BME280_Config *config, uint8_t *data);
 I2C_Result BME280_GetConfig(I2C_TypeDef *i2c, BME280_Config *config);
+void BME280_ParseConfig(const uint8_t *data, BME280_Config *config);
 I2C_Result BME280_GetStatus(I2C_TypeDef *i2c, BME280_Status *status);
+void BME280_ParseStatus(uint8_t statusByte, BME280_Status *status);
+uint32_t BME280_GetMeasurementTime(const BME280_Config *config, bool isMaximal);
+uint32_t BME280_GetCycleTime(const BME280_Config *config, bool isMaximal);
 I2C_Result BME280_GetTrimmingParams(I2C_TypeDef *i2c, BME280_TrimmingParams *params);
-I2C_Result BME280_GetMeasurement(I2C_TypeDef *i2c, BME280_TrimmingParams *params, BME280_Measurement *measurement);
+I2C_Result BME280_GetTrimmingData(I2C_TypeDef *i2c, uint8_t *trimmingData);
+I2C_Result BME280_GetTrimmingSignature(I2C_TypeDef *i2c, uint8_t *signature);
+void BME280_ParseTrimmingParams(const uint8_t *trimmingData, BME280_TrimmingParams *params);
+void BME280_PrepareTrimmingParams(BME280_TrimmingParams *params);
+I2C_Result BME280_GetRawData(I2C_TypeDef *i2c, uint8_t channels, BME280_RawData *rawData);
+void BME280_ParseRawData(const uint8_t *data, BME280_RawData *rawData);
+I2C_Result BME280_GetMeasurement(I2C_TypeDef *i2c, BME280_TrimmingParams *params, uint8_t channels,
+  BME280_Measurement *measurement);
+void BME280_Compensate(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement);
+void BME280_CompensateFloat(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement);
+void BME280_CompensateInt32(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement);
+void BME280_CompensateInt64(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurement);
+void BME280_CompensateInt64Batch(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurements, uint32_t count);
+void BME280_CompensateBatch(const BME280_TrimmingParams *params, const BME280_RawData *rawData, uint8_t channels,
+  BME280_Measurement *measurements, uint32_t count);
 
 #endif
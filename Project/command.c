@@ -8,15 +8,13 @@
 
 #include "command.h"
 
-#define _TO_STR(s) #s
-#define TO_STR(s) _TO_STR(s)
-
 /**
  * @brief The default empty default command callback. Returns an empty string as a command response.
  */
-void Command_EmptyDefaultCallback(__unused const Command_Descriptor *descriptor, __unused char *response)
+uint16_t Command_EmptyDefaultCallback(__unused const Command_Descriptor *descriptor, char *response)
 {
-  response = "";
+  response[0] = '\0';
+  return 0;
 }
 
 /**
@@ -28,47 +26,198 @@ void Command_EmptyDefaultCallback(__unused const Command_Descriptor *descriptor,
 __weak_symbol Command_Callback Command_DefaultCallback = Command_EmptyDefaultCallback;
 
 /**
- * @brief An array that defines bindings between command names and corresponding command callback functions.
+ * @brief An array that binds the command identifiers to the corresponding command callback functions.
  * @note This array must be set or overridden in external code before any command processing is performed.
- *   By default the array is empty.
+ *   By default the array is empty, so all the commands are handled by the default callback.
+ */
+__weak_symbol Command_Callback Command_Bindings[COMMAND_ID_COUNT] = {};
+
+#if (CONFIG_COMMAND_HASH_TABLE_SIZE & (CONFIG_COMMAND_HASH_TABLE_SIZE - 1)) != 0
+#error "The command hash table size must be a power of two."
+#endif
+
+_Static_assert(COMMAND_ID_COUNT < UINT8_MAX, "Too many commands for the command hash table.");
+
+/**
+ * @brief Expands a <i>COMMAND_TABLE</i> entry to its command name string.
+ */
+#define COMMAND_NAME_ENTRY(id, name, first, last, callback) [COMMAND_ID_##id] = #name,
+
+/**
+ * @brief The command names indexed by the command identifiers.
+ */
+static const char *const Command_Names[COMMAND_ID_COUNT] = {COMMAND_TABLE(COMMAND_NAME_ENTRY)};
+
+/**
+ * @brief The command name hash table containing the command identifiers plus one, or zeros for the empty slots.
+ */
+static const uint8_t Command_HashTable[CONFIG_COMMAND_HASH_TABLE_SIZE] = {COMMAND_TABLE(COMMAND_HASH_ENTRY)};
+
+/**
+ * @brief Never called. Fails the compilation if any of the command name hashes collide.
+ */
+__unused static inline void Command_CheckHashCollisions(uint32_t hash)
+{
+  switch (hash)
+  {
+    COMMAND_TABLE(COMMAND_HASH_CASE)
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Checks if the character is a white-space character (as defined by the <i>isspace</i> function in the "C"
+ *   locale).
+ */
+static inline bool Command_IsSpace(char character)
+{
+  return character == ' ' || (character >= '\t' && character <= '\r');
+}
+
+/**
+ * @brief Converts the ASCII letter to the lower case. Other characters are returned unchanged.
+ */
+static inline char Command_ToLower(char character)
+{
+  return character >= 'A' && character <= 'Z' ? (char) (character + ('a' - 'A')) : character;
+}
+
+/**
+ * @brief Splits the command message into the white-space delimited name, parameter, and value tokens in a single pass.
+ *   The tokens refer to the message string, no characters are copied. Missing tokens are set empty, and the excessive
+ *   ones are ignored.
+ * @param commandMessage A null-terminated string containing the command message.
+ * @param descriptor A pointer to the command descriptor structure that will be filled with the tokens.
+ */
+void Command_Tokenize(const char *commandMessage, Command_Descriptor *descriptor)
+{
+  Command_Token *tokens[] = {&descriptor->name, &descriptor->param, &descriptor->value};
+  const char *position = commandMessage;
+
+  for (uint8_t index = 0; index < sizeof(tokens) / sizeof(tokens[0]); index++)
+  {
+    while (Command_IsSpace(*position))
+      position++;
+
+    const char *start = position;
+    while (*position != '\0' && !Command_IsSpace(*position))
+      position++;
+
+    tokens[index]->string = start;
+    tokens[index]->length = (uint16_t) (position - start);
+  }
+}
+
+/**
+ * @brief Compares the command token with the string ignoring the ASCII letters case.
+ * @param token A pointer to the command token structure.
+ * @param string A null-terminated string to compare the token with.
+ * @return <i>true</i> if the token matches the whole string, otherwise <i>false</i>.
+ */
+bool Command_TokenEquals(const Command_Token *token, const char *string)
+{
+  for (uint16_t index = 0; index < token->length; index++)
+  {
+    if (string[index] == '\0' || Command_ToLower(token->string[index]) != Command_ToLower(string[index]))
+      return false;
+  }
+
+  return string[token->length] == '\0';
+}
+
+/**
+ * @brief Converts the command token to an unsigned decimal integer value.
+ * @param token A pointer to the command token structure.
+ * @param value A pointer to the variable that will be set to the converted value.
+ * @return <i>true</i> if the token is a decimal number not exceeding <i>UINT32_MAX</i>, otherwise <i>false</i>.
  */
-__weak_symbol Command_Binding Command_Bindings[] = {};
+bool Command_TokenToUint(const Command_Token *token, uint32_t *value)
+{
+  uint32_t result = 0;
+  if (token->length == 0)
+    return false;
+
+  for (uint16_t index = 0; index < token->length; index++)
+  {
+    uint32_t digit = (uint32_t) (token->string[index] - '0');
+    if (digit > 9 || result > (UINT32_MAX - digit) / 10)
+      return false;
+    result = result * 10 + digit;
+  }
+
+  *value = result;
+  return true;
+}
 
 /**
- * @brief A constant that must provide the size of the <i>Command_Bindings</i> array.
- * @note This value must be set or overridden in external code before any command processing is performed.
- *   By default it is set to 0.
+ * @brief Computes the <i>COMMAND_HASH</i> value of the command token ignoring the ASCII letters case.
+ * @param token A pointer to the non-empty command token structure.
+ * @param size The hash table size. Must be a power of two.
+ * @return The hash table slot index.
  */
-__weak_symbol uint32_t Command_BindingsCount = 0;
+uint32_t Command_GetTokenHash(const Command_Token *token, uint32_t size)
+{
+  return COMMAND_HASH(Command_ToLower(token->string[0]), Command_ToLower(token->string[token->length - 1]),
+    token->length, size);
+}
 
 /**
- * @brief Processes a command message.
+ * @brief Finds the command by its name with a single hash table lookup and a single name comparison.
+ * @param name A pointer to the command name token.
+ * @return The matching command identifier, or <i>COMMAND_ID_COUNT</i> if the command is unknown.
+ */
+Command_Id Command_Find(const Command_Token *name)
+{
+  if (name->length == 0)
+    return COMMAND_ID_COUNT;
+
+  uint8_t slot = Command_HashTable[Command_GetTokenHash(name, CONFIG_COMMAND_HASH_TABLE_SIZE)];
+  if (slot == 0 || !Command_TokenEquals(name, Command_Names[slot - 1]))
+    return COMMAND_ID_COUNT;
+
+  return (Command_Id) (slot - 1);
+}
+
+/**
+ * @brief Gets the command name.
+ * @param id The command identifier.
+ * @return The command name string, or <i>NULL</i> for an unknown command identifier.
+ */
+const char *Command_GetName(Command_Id id)
+{
+  return id < COMMAND_ID_COUNT ? Command_Names[id] : NULL;
+}
+
+/**
+ * @brief Invokes the callback bound to the command identifier of the descriptor, or the default callback for unknown
+ *   commands. Shared by the text and binary protocols.
+ * @param descriptor A pointer to the command descriptor structure.
+ * @param responseMessage A pointer to the buffer that will be provided a response returned by the processing callback
+ *   method.
+ * @return The response length in bytes.
+ */
+uint16_t Command_Dispatch(const Command_Descriptor *descriptor, char *responseMessage)
+{
+  if (descriptor->id < COMMAND_ID_COUNT && Command_Bindings[descriptor->id] != NULL)
+    return Command_Bindings[descriptor->id](descriptor, responseMessage);
+
+  return Command_DefaultCallback(descriptor, responseMessage);
+}
+
+/**
+ * @brief Processes a text command message.
  * @param commandMessage A string containing the command message to process.
  * @param responseMessage A pointer to the buffer that will be provided a response string returned by the processing
  *   callback method.
+ * @return The response length in bytes.
  */
-void Command_ProcessMessage(const char *commandMessage, char *responseMessage)
+uint16_t Command_ProcessMessage(const char *commandMessage, char *responseMessage)
 {
-  Command_Descriptor descriptor = {
-    .name = "",
-    .param = "",
-    .value = ""
-  };
-
-  sscanf(commandMessage,
-    "%" TO_STR(CONFIG_MAX_COMMAND_MESSAGE_LENGTH) "s"
-    "%" TO_STR(CONFIG_MAX_COMMAND_MESSAGE_LENGTH) "s"
-    "%" TO_STR(CONFIG_MAX_COMMAND_MESSAGE_LENGTH) "s",
-    descriptor.name, descriptor.param, descriptor.value);
-
-  for (uint32_t index = 0; index < Command_BindingsCount; index++)
-  {
-    if (strcasecmp(descriptor.name, Command_Bindings[index].commandName) == 0)
-    {
-      Command_Bindings[index].commandCallback(&descriptor, responseMessage);
-      return;
-    }
-  }
+  Command_Descriptor descriptor;
+  Command_Tokenize(commandMessage, &descriptor);
+  descriptor.id = Command_Find(&descriptor.name);
+  descriptor.format = COMMAND_FORMAT_TEXT;
 
-  Command_DefaultCallback(&descriptor, responseMessage);
+  return Command_Dispatch(&descriptor, responseMessage);
 }
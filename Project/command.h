@@ -15,54 +15,157 @@
 #include <string.h>
 
 #include "config.h"
+#include "command_table.h"
 
 /**
- * @brief Defines the parsed command descriptor structure.
+ * @brief Defines the <i>printf</i> format placeholder for a command token.
  */
-typedef struct Command_Descriptor
+#define COMMAND_TOKEN_FORMAT "%.*s"
+
+/**
+ * @brief Expands to the <i>printf</i> arguments for the <i>COMMAND_TOKEN_FORMAT</i> placeholder.
+ * @param token The command token structure.
+ */
+#define COMMAND_TOKEN_ARGS(token) (int) (token).length, (token).string
+
+/**
+ * @brief Computes the command name hash. Expands to an integer constant expression when the arguments are constant,
+ *   so the same formula is used for building the hash tables at compile time and for the lookups at run time.
+ * @param first The lower-case first character of the command name.
+ * @param last The lower-case last character of the command name.
+ * @param length The command name length.
+ * @param size The hash table size. Must be a power of two.
+ */
+#define COMMAND_HASH(first, last, length, size) \
+  ((3U * (uint32_t) (first) + 11U * (uint32_t) (last) + 13U * (uint32_t) (length)) & ((size) - 1U))
+
+/**
+ * @brief Expands a <i>COMMAND_TABLE</i> entry to a hash table entry mapping the command name hash to the command
+ *   identifier plus one (zero marks an empty slot).
+ */
+#define COMMAND_HASH_ENTRY(id, name, first, last, callback) \
+  [COMMAND_HASH(first, last, sizeof(#name) - 1, CONFIG_COMMAND_HASH_TABLE_SIZE)] = COMMAND_ID_##id + 1,
+
+/**
+ * @brief Expands a <i>COMMAND_TABLE</i> entry to a case label of its hash, so that the hash collisions are reported
+ *   by the compiler as the duplicate case values.
+ */
+#define COMMAND_HASH_CASE(id, name, first, last, callback) \
+  case COMMAND_HASH(first, last, sizeof(#name) - 1, CONFIG_COMMAND_HASH_TABLE_SIZE):
+
+/**
+ * @brief Expands a <i>COMMAND_TABLE</i> entry to its command identifier enumeration value.
+ */
+#define COMMAND_ID_ENTRY(id, name, first, last, callback) COMMAND_ID_##id,
+
+/**
+ * @brief Defines the command identifiers generated from the <i>COMMAND_TABLE</i> entries.
+ */
+typedef enum Command_Id
 {
+  COMMAND_TABLE(COMMAND_ID_ENTRY)
+
   /**
-   * @brief The command name string.
+   * @brief The number of the supported commands. Also used as the identifier of unknown commands.
    */
-  char name[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+  COMMAND_ID_COUNT
+} Command_Id;
 
+/**
+ * @brief Defines the command response formats.
+ */
+typedef enum Command_Format
+{
   /**
-   * @brief The command parameter string.
+   * @brief The text response: a status word followed by an optional message, terminated with a LF symbol.
    */
-  char param[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+  COMMAND_FORMAT_TEXT,
 
   /**
-   * @brief The command value string.
+   * @brief The binary response: a <i>Command_Status</i> byte followed by an optional binary payload or message text.
    */
-  char value[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
-} Command_Descriptor;
+  COMMAND_FORMAT_BINARY
+} Command_Format;
 
 /**
- * @brief The function pointer type for command callbacks.
+ * @brief Defines the binary response status values.
  */
-typedef void (*Command_Callback)(const Command_Descriptor *commandDescriptor, char *response);
+typedef enum Command_Status
+{
+  COMMAND_STATUS_OK = 0x00,
+  COMMAND_STATUS_ERROR = 0x01
+} Command_Status;
 
 /**
- * @brief The structure for binding command names and corresponding callback functions.
+ * @brief Defines the command token structure. The token refers to a part of the command message string without
+ *   copying it, so it is not null-terminated.
  */
-typedef struct Command_Binding
+typedef struct Command_Token
 {
   /**
-   * @brief The command name used for invoking the bound <i>callback</i> function.
+   * @brief A pointer to the first token character in the command message string.
    */
-  char *commandName;
+  const char *string;
 
   /**
-   * @brief The callback function that will be invoked when the command name matches the bound <i>commandName</i>
-   *   value.
+   * @brief The token length in characters. Zero for an empty (missing) token.
    */
-  Command_Callback commandCallback;
-} Command_Binding;
+  uint16_t length;
+} Command_Token;
+
+/**
+ * @brief Defines the parsed command descriptor structure.
+ */
+typedef struct Command_Descriptor
+{
+  /**
+   * @brief The command identifier matching the command name, or <i>COMMAND_ID_COUNT</i> for an unknown command.
+   */
+  Command_Id id;
+
+  /**
+   * @brief The requested response format.
+   */
+  Command_Format format;
+
+  /**
+   * @brief The command name token.
+   */
+  Command_Token name;
+
+  /**
+   * @brief The command parameter token. For the binary commands refers to the whole frame payload.
+   */
+  Command_Token param;
+
+  /**
+   * @brief The command value token.
+   */
+  Command_Token value;
+} Command_Descriptor;
+
+/**
+ * @brief The function pointer type for command callbacks. The callbacks return the response length in bytes.
+ */
+typedef uint16_t (*Command_Callback)(const Command_Descriptor *commandDescriptor, char *response);
 
 extern Command_Callback Command_DefaultCallback;
-extern Command_Binding Command_Bindings[];
-extern uint32_t Command_BindingsCount;
+extern Command_Callback Command_Bindings[COMMAND_ID_COUNT];
+
+void Command_Tokenize(const char *commandMessage, Command_Descriptor *descriptor);
+
+bool Command_TokenEquals(const Command_Token *token, const char *string);
+
+bool Command_TokenToUint(const Command_Token *token, uint32_t *value);
+
+uint32_t Command_GetTokenHash(const Command_Token *token, uint32_t size);
+
+Command_Id Command_Find(const Command_Token *name);
+
+const char *Command_GetName(Command_Id id);
+
+uint16_t Command_Dispatch(const Command_Descriptor *descriptor, char *responseMessage);
 
-void Command_ProcessMessage(const char *commandMessage, char *responseMessage);
+uint16_t Command_ProcessMessage(const char *commandMessage, char *responseMessage);
 
 #endif //BME_READER_COMMAND_H
@@ -6,23 +6,25 @@
  * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
  */
 
+#include <stdarg.h>
+
 #include "command.h"
 #include "project.h"
 
 #pragma ide diagnostic ignored "OCUnusedMacroInspection"
 
 /**
- * @brief Returns <i>true</i> when the two strings match each other.
- * @param str1 The first string to compare.
- * @param str2 The second string to compare.
+ * @brief Returns <i>true</i> when the command token matches the string.
+ * @param token The command token to compare.
+ * @param str The string to compare.
  */
-#define STR_EQUAL(str1, str2) (strcasecmp(str1, str2) == 0)
+#define TOKEN_EQUAL(token, str) (Command_TokenEquals(&(token), str))
 
 /**
- * @brief Returns <i>true</i> when the string is empty.
- * @param str The string to check.
+ * @brief Returns <i>true</i> when the command token is empty.
+ * @param token The command token to check.
  */
-#define STR_EMPTY(str) (strlen(str) == 0)
+#define TOKEN_EMPTY(token) ((token).length == 0)
 
 /**
  * @brief Defines the OK response string.
@@ -76,56 +78,164 @@
  */
 #define INVALID_VALUE_RANGE_RESPONSE_FORMAT(param, min, max) INVALID_VALUE_RESPONSE_FORMAT(param "; Allowed range: " min "-" max)
 
+/**
+ * @brief Formats the text response and converts it to the format requested by the command descriptor. The binary
+ *   response consists of the status byte followed by the response message without the status word and the LF symbol.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @param format The text response format string, e.g. defined with the <i>OK_RESPONSE_FORMAT</i> or
+ *   <i>ERROR_RESPONSE_FORMAT</i> macros.
+ * @return The response length in bytes.
+ * @note The arguments are checked against the format string by the compiler.
+ */
+__attribute__((format(printf, 3, 4)))
+static uint16_t Respond(const Command_Descriptor *descriptor, char *response, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(response, CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + 1, format, args);
+  va_end(args);
+
+  length = length > CONFIG_MAX_RESPONSE_MESSAGE_LENGTH ? CONFIG_MAX_RESPONSE_MESSAGE_LENGTH : length;
+  if (descriptor->format == COMMAND_FORMAT_TEXT)
+    return (uint16_t) length;
+
+  bool isOk = strncmp(response, "OK", 2) == 0;
+  const char *message = strchr(response, ';');
+  message = message != NULL ? message + 2 : &response[length];
+  int messageLength = (int) (&response[length] - message) - (length > 0 && response[length - 1] == '\n');
+  messageLength = messageLength > 0 ? messageLength : 0;
+
+  memmove(&response[1], message, (size_t) messageLength);
+  response[0] = (char) (isOk ? COMMAND_STATUS_OK : COMMAND_STATUS_ERROR);
+  return (uint16_t) (messageLength + 1);
+}
+
 /**
  * @brief Gets the message string describing the I2C result.
+ * @param descriptor The pointer to the input command descriptor structure.
  * @param result The I2C result value to get the message for.
  * @param resultMessage A string buffer where the message will be put.
+ * @return The response length in bytes.
  */
-static void GetI2cResultMessage(I2C_Result result, char *resultMessage)
+static uint16_t GetI2cResultMessage(const Command_Descriptor *descriptor, I2C_Result result, char *resultMessage)
 {
   switch (result)
   {
     case I2C_RESULT_OK:
     {
-      sprintf(resultMessage, OK_RESPONSE);
-      return;
+      return Respond(descriptor, resultMessage, OK_RESPONSE);
     }
     case I2C_RESULT_START_FAILED:
     {
-      sprintf(resultMessage, ERROR_RESPONSE_FORMAT("Failed to start an I2C transmission."));
-      return;
+      return Respond(descriptor, resultMessage, ERROR_RESPONSE_FORMAT("Failed to start an I2C transmission."));
     }
     case I2C_RESULT_ADDRESS_FAILED:
     {
-      sprintf(resultMessage, ERROR_RESPONSE_FORMAT("The BME280 sensor was not detected on the I2C bus."));
-      return;
+      return Respond(descriptor, resultMessage,
+        ERROR_RESPONSE_FORMAT("The BME280 sensor was not detected on the I2C bus."));
     }
     case I2C_RESULT_ACK_FAILED:
     {
-      sprintf(resultMessage, ERROR_RESPONSE_FORMAT("The BME280 sensor failed to acknowledge the data."));
-      return;
+      return Respond(descriptor, resultMessage,
+        ERROR_RESPONSE_FORMAT("The BME280 sensor failed to acknowledge the data."));
     }
     case I2C_RESULT_READ_FAILED:
     {
-      sprintf(resultMessage, ERROR_RESPONSE_FORMAT("Failed to read data from the BME280 sensor."));
-      return;
+      return Respond(descriptor, resultMessage, ERROR_RESPONSE_FORMAT("Failed to read data from the BME280 sensor."));
     }
     default:
     {
-      sprintf(resultMessage, ERROR_RESPONSE_FORMAT("An unknown error has occurred."));
-      return;
+      return Respond(descriptor, resultMessage, ERROR_RESPONSE_FORMAT("An unknown error has occurred."));
     }
   }
 }
 
+/**
+ * @brief Gets the latest sample taken in background. Defers the command until the first sample is taken.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param sample A pointer to the structure that will be filled with the sample.
+ * @param response The output response message buffer. Filled with the error message if the sample is not valid.
+ * @return Zero if the sample is valid, otherwise the error message length.
+ */
+static uint16_t GetLatestSample(const Command_Descriptor *descriptor, Sampler_Sample *sample, char *response)
+{
+  // Waiting for the first sample taken shortly after the start. The response is discarded when deferred.
+  if (!Sampler_GetLatest(sample))
+  {
+    Project_DeferCommand();
+    return Respond(descriptor, response, ERROR_RESPONSE_FORMAT("No measurement data are available yet."));
+  }
+
+  if (sample->status == SAMPLER_STATUS_INIT_FAILED)
+    return Respond(descriptor, response, ERROR_RESPONSE_FORMAT("Failed to initialize the BME280 sensor."));
+
+  if (sample->status == SAMPLER_STATUS_I2C_FAILED)
+    return GetI2cResultMessage(descriptor, sample->result, response);
+
+  return 0;
+}
+
+/**
+ * @brief Splits the binary frame payload passed as a single parameter token into the white-space delimited parameter
+ *   and value tokens.
+ * @param param A pointer to the parameter token that will be truncated to the first word.
+ * @param value A pointer to the token that will be set to the rest of the parameter token.
+ */
+static void SplitParamToken(Command_Token *param, Command_Token *value)
+{
+  uint16_t length = 0;
+  while (length < param->length && param->string[length] != ' ')
+    length++;
+
+  value->string = &param->string[length < param->length ? length + 1 : length];
+  value->length = (uint16_t) (length < param->length ? param->length - length - 1 : 0);
+  param->length = length;
+}
+
+/**
+ * @brief The <i>Config</i> command oversampling values indexed by the oversampling register value. Zero skips the
+ *   channel measurement.
+ */
+static const char *const ConfigOversamplings[] = {"0", "1", "2", "4", "8", "16"};
+
+/**
+ * @brief The <i>Config</i> command filter coefficient values indexed by the filter register value. Zero turns the
+ *   filter off.
+ */
+static const char *const ConfigFilters[] = {"0", "2", "4", "8", "16"};
+
+/**
+ * @brief The <i>Config</i> command standby time values in milliseconds indexed by the standby time register value.
+ */
+static const char *const ConfigStandbyTimes[] = {"0.5", "62.5", "125", "250", "500", "1000", "10", "20"};
+
+/**
+ * @brief Finds the command token in the list of the setting values.
+ * @param token A pointer to the command token to find.
+ * @param values The setting values list.
+ * @param count The number of the values in the list.
+ * @return The index of the value matching the token, or a negative value if not found.
+ */
+static int8_t FindConfigValue(const Command_Token *token, const char *const *values, uint8_t count)
+{
+  for (uint8_t index = 0; index < count; index++)
+  {
+    if (Command_TokenEquals(token, values[index]))
+      return (int8_t) index;
+  }
+  return -1;
+}
+
 /**
  * @brief The default callback for unknown commands.
- * @param commandDescriptor The pointer to the input command descriptor structure.
+ * @param descriptor The pointer to the input command descriptor structure.
  * @param response The output response message buffer.
  */
-static void UnknownCommand(const Command_Descriptor *commandDescriptor, char *response)
+static uint16_t UnknownCommand(const Command_Descriptor *descriptor, char *response)
 {
-  sprintf(response, INVALID_COMMAND_RESPONSE_FORMAT("%s"), commandDescriptor->name);
+  return Respond(descriptor, response, INVALID_COMMAND_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT),
+    COMMAND_TOKEN_ARGS(descriptor->name));
 }
 
 /**
@@ -135,52 +245,107 @@ static void UnknownCommand(const Command_Descriptor *commandDescriptor, char *re
  * @remarks Command usage:
  *   @code Id
  */
-static void IdCommand(__unused const Command_Descriptor *descriptor, char *response)
+static uint16_t IdCommand(const Command_Descriptor *descriptor, char *response)
 {
-  sprintf(response, OK_RESPONSE_FORMAT("%s; Version: %s; SN: %08lX%08lX%08lX"), PROJECT_NAME, PROJECT_VERSION,
-    LL_GetUID_Word2(), LL_GetUID_Word1(), LL_GetUID_Word0());
+  return Respond(descriptor, response, OK_RESPONSE_FORMAT("%s; Version: %s; SN: %08lX%08lX%08lX"), PROJECT_NAME,
+    PROJECT_VERSION, (unsigned long) LL_GetUID_Word2(), (unsigned long) LL_GetUID_Word1(),
+    (unsigned long) LL_GetUID_Word0());
 }
 
 /**
- * @brief The command returning the measured climatic data.
+ * @brief The command returning the latest climatic data sampled in background.
  * @param descriptor The pointer to the input command descriptor structure.
  * @param response The output response message buffer.
  * @remarks Command usage:
- *   @code Measure P|T|H|All
+ *   @code Measure P|T|H|All [<max age>]
+ *   Without the maximal age (0-60000 ms) the latest background sample is returned at once. Otherwise, if the latest
+ *   sample is older, an on-demand measurement is performed, and the response is delayed until it is completed, while
+ *   the following commands wait. The shorter maximal age gives the fresher data at the cost of the latency up to the
+ *   measurement time and the extra measurements heating the sensor. In the binary mode all the values are returned
+ *   packed, and the optional maximal age is passed as a 32-bit little-endian integer.
  */
-static void MeasureCommand(const Command_Descriptor *descriptor, char *response)
+static uint16_t MeasureCommand(const Command_Descriptor *descriptor, char *response)
 {
-  BME280_Config config;
-  BME280_Measurement measurement;
-  I2C_Result result;
+  Sampler_Sample sample;
+  uint8_t channels;
+  uint32_t maxAge = UINT32_MAX;
 
-  Project_RecoverI2cState();
+  if (descriptor->format == COMMAND_FORMAT_BINARY && !TOKEN_EMPTY(descriptor->param))
+  {
+    if (descriptor->param.length != 4)
+      return Respond(descriptor, response, INVALID_PARAMETER_RESPONSE_FORMAT("%u bytes; Expected: 4 bytes"),
+        descriptor->param.length);
 
-  result = BME280_GetConfig(I2C1, &config);
-  if (result != I2C_RESULT_OK)
-    return GetI2cResultMessage(result, response);
+    maxAge = Frame_GetUint32((const uint8_t *) &descriptor->param.string[0]);
+  }
+  else if (!TOKEN_EMPTY(descriptor->value) && !Command_TokenToUint(&descriptor->value, &maxAge))
+    return Respond(descriptor, response, INVALID_VALUE_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT),
+      COMMAND_TOKEN_ARGS(descriptor->value));
 
-  if (config.mode == BME280_MODE_SLEEP && !Project_Bme280Init())
-    return (void) sprintf(response, ERROR_RESPONSE_FORMAT("Failed to initialize the BME280 sensor."));
+  if (maxAge != UINT32_MAX && maxAge > 60000)
+    return Respond(descriptor, response, INVALID_VALUE_RANGE_RESPONSE_FORMAT("%lu", "%d", "%d"),
+      (unsigned long) maxAge, 0, 60000);
 
-  result = BME280_GetMeasurement(I2C1, &Project_TrimmingParams, &measurement);
-  if (result != I2C_RESULT_OK)
-    return GetI2cResultMessage(result, response);
+  // Selecting the channels to compensate, so that a single value costs only its own formula and formatting.
+  if (descriptor->format == COMMAND_FORMAT_BINARY || TOKEN_EQUAL(descriptor->param, "All"))
+    channels = BME280_CHANNEL_ALL;
+  else if (TOKEN_EQUAL(descriptor->param, "P"))
+    channels = BME280_CHANNEL_PRESSURE;
+  else if (TOKEN_EQUAL(descriptor->param, "T"))
+    channels = BME280_CHANNEL_TEMPERATURE;
+  else if (TOKEN_EQUAL(descriptor->param, "H"))
+    channels = BME280_CHANNEL_HUMIDITY;
+  else
+    return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+      COMMAND_TOKEN_ARGS(descriptor->param), "P, T, H, All");
+
+  if (maxAge != UINT32_MAX && !Sampler_GetFresh(maxAge, &sample))
+  {
+    Project_DeferCommand();
+    return 0;
+  }
+
+  uint16_t length = GetLatestSample(descriptor, &sample, response);
+  if (length != 0)
+    return length;
+
+  // Packing all of the values at once regardless of the parameter.
+  BME280_Measurement measurement;
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+    channels = BME280_CHANNEL_ALL;
+  BME280_Compensate(&Project_TrimmingParams, &sample.rawData, channels, &measurement);
+
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+  {
+    response[0] = COMMAND_STATUS_OK;
+    Frame_PutMeasurement((uint8_t *) &response[1], &measurement);
+    return 1 + FRAME_MEASUREMENT_LENGTH;
+  }
+
+  char pressure[NUMBER_FORMAT_MAX_LENGTH];
+  char temperature[NUMBER_FORMAT_MAX_LENGTH];
+  char humidity[NUMBER_FORMAT_MAX_LENGTH];
 
   // Converting Pa to mmHg.
-  measurement.pressure *= 0.007500617F;
-
-  if (STR_EQUAL(descriptor->param, "All"))
-    sprintf(response, OK_RESPONSE_FORMAT("P = %f mmHg; T = %f degC; H = %f %%"),
-      measurement.pressure, measurement.temperature, measurement.humidity);
-  else if (STR_EQUAL(descriptor->param, "P"))
-    sprintf(response, OK_RESPONSE_FORMAT("%f mmHg"), measurement.pressure);
-  else if (STR_EQUAL(descriptor->param, "T"))
-    sprintf(response, OK_RESPONSE_FORMAT("%f degC"), measurement.temperature);
-  else if (STR_EQUAL(descriptor->param, "H"))
-    sprintf(response, OK_RESPONSE_FORMAT("%f %%"), measurement.humidity);
-  else
-    sprintf(response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT("%s", "%s"), descriptor->param, "P, T, H, All");
+  if (channels & BME280_CHANNEL_PRESSURE)
+    NumberFormat_Fixed(pressure, measurement.pressure * 0.007500617F, CONFIG_MEASUREMENT_PRECISION);
+  if (channels & BME280_CHANNEL_TEMPERATURE)
+    NumberFormat_Fixed(temperature, measurement.temperature, CONFIG_MEASUREMENT_PRECISION);
+  if (channels & BME280_CHANNEL_HUMIDITY)
+    NumberFormat_Fixed(humidity, measurement.humidity, CONFIG_MEASUREMENT_PRECISION);
+
+  switch (channels)
+  {
+    case BME280_CHANNEL_PRESSURE:
+      return Respond(descriptor, response, OK_RESPONSE_FORMAT("%s mmHg"), pressure);
+    case BME280_CHANNEL_TEMPERATURE:
+      return Respond(descriptor, response, OK_RESPONSE_FORMAT("%s degC"), temperature);
+    case BME280_CHANNEL_HUMIDITY:
+      return Respond(descriptor, response, OK_RESPONSE_FORMAT("%s %%"), humidity);
+    default:
+      return Respond(descriptor, response, OK_RESPONSE_FORMAT("P = %s mmHg; T = %s degC; H = %s %%"), pressure,
+        temperature, humidity);
+  }
 }
 
 /**
@@ -190,43 +355,378 @@ static void MeasureCommand(const Command_Descriptor *descriptor, char *response)
  * @remarks Command usage:
  *   @code Reset Normal|Bootloader
  */
-static void ResetCommand(__unused const Command_Descriptor *descriptor, __unused char *response)
+static uint16_t ResetCommand(const Command_Descriptor *descriptor, char *response)
 {
-  if (STR_EQUAL(descriptor->param, "Normal"))
+  if (TOKEN_EQUAL(descriptor->param, "Normal"))
     Project_RequestSoftwareReset(false);
-  else if (STR_EQUAL(descriptor->param, "Bootloader"))
+  else if (TOKEN_EQUAL(descriptor->param, "Bootloader"))
     Project_RequestSoftwareReset(true);
   else
-    return (void) sprintf(response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT("%s", "%s"), descriptor->param,
-      "Normal, Bootloader");
+    return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+      COMMAND_TOKEN_ARGS(descriptor->param), "Normal, Bootloader");
 
-  sprintf(response, OK_RESPONSE_FORMAT("Performing a %s software reset shortly..."), descriptor->param);
+  return Respond(descriptor, response,
+    OK_RESPONSE_FORMAT("Performing a " COMMAND_TOKEN_FORMAT " software reset shortly..."),
+    COMMAND_TOKEN_ARGS(descriptor->param));
 }
 
 /**
- * @brief The default command callback.
+ * @brief The command returning the firmware runtime statistics.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code Stats
  */
-Command_Callback Command_DefaultCallback = UnknownCommand;
+static uint16_t StatsCommand(const Command_Descriptor *descriptor, char *response)
+{
+  CommandQueue_Stats queueStats;
+  CommandQueue_GetStats(&queueStats);
+  Stream_Stats streamStats;
+  Stream_GetStats(&streamStats);
+
+  return Respond(descriptor, response,
+    OK_RESPONSE_FORMAT("Queue: %lu/%lu; Peak: %lu; Dropped: %lu; Stream: %lu/%lu; Stream dropped: %lu"),
+    (unsigned long) queueStats.depth, (unsigned long) queueStats.capacity, (unsigned long) queueStats.highWater,
+    (unsigned long) queueStats.dropped, (unsigned long) streamStats.depth, (unsigned long) streamStats.capacity,
+    (unsigned long) streamStats.dropped);
+}
+
+/**
+ * @brief The command switching the protocol between the text and binary framed modes. The response is sent in the
+ *   current mode, and the new mode applies to the following commands.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code Mode Text|Binary
+ */
+static uint16_t ModeCommand(const Command_Descriptor *descriptor, char *response)
+{
+  if (TOKEN_EQUAL(descriptor->param, "Text"))
+    Project_SetCommandFormat(COMMAND_FORMAT_TEXT);
+  else if (TOKEN_EQUAL(descriptor->param, "Binary"))
+    Project_SetCommandFormat(COMMAND_FORMAT_BINARY);
+  else
+    return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+      COMMAND_TOKEN_ARGS(descriptor->param), "Text, Binary");
+
+  return Respond(descriptor, response, OK_RESPONSE);
+}
+
+/**
+ * @brief The command starting or stopping the continuous streaming of the background samples.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code Stream 1-<max rate> [Raw]|Off
+ *   The parameter sets the streaming rate in samples per second, up to the typical output rate of the sensor with the
+ *   x1 oversampling and the 0.5 ms standby time (117 samples per second with all the channels measured). The sensor
+ *   is switched to the normal mode with the oversampling and standby time making it output the samples not slower
+ *   than at this rate, and every sample output by the sensor is streamed once. The response reports the sensor output
+ *   rate achieved. The sensor settings are restored when the streaming is stopped. The samples are sent in the current
+ *   protocol mode, uncompensated if the <i>Raw</i> value is specified.
+ */
+static uint16_t StreamCommand(const Command_Descriptor *descriptor, char *response)
+{
+  Command_Token param = descriptor->param;
+  Command_Token value = descriptor->value;
+  uint32_t rate;
+  uint32_t maxRate = Stream_GetMaxRate();
+
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+    SplitParamToken(&param, &value);
+
+  // The sensor cannot output the samples faster than its shortest conversion cycle allows.
+  bool isOff = TOKEN_EQUAL(param, "Off");
+  if (!isOff && (!Command_TokenToUint(&param, &rate) || rate < 1 || rate > maxRate))
+    return Respond(descriptor, response, INVALID_VALUE_RANGE_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%d", "%lu"),
+      COMMAND_TOKEN_ARGS(param), 1, (unsigned long) maxRate);
+
+  if (!isOff && !TOKEN_EMPTY(value) && !TOKEN_EQUAL(value, "Raw"))
+    return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+      COMMAND_TOKEN_ARGS(value), "Raw");
+
+  // Waiting for the forced mode measurement in progress to complete. The response is discarded when deferred.
+  if (!Sampler_IsIdle())
+  {
+    Project_DeferCommand();
+    return 0;
+  }
+
+  I2C_Result result;
+  if (isOff)
+  {
+    Stream_Stats stats;
+    Stream_GetStats(&stats);
+    if ((result = Stream_Stop()) != I2C_RESULT_OK)
+      return GetI2cResultMessage(descriptor, result, response);
+    return Respond(descriptor, response, OK_RESPONSE_FORMAT("Dropped: %lu"), (unsigned long) stats.dropped);
+  }
+
+  if ((result = Stream_Start(rate, !TOKEN_EMPTY(value))) != I2C_RESULT_OK)
+    return GetI2cResultMessage(descriptor, result, response);
+
+  // The rate in tenths of hertz of the typical conversion cycle of the configuration selected.
+  uint32_t outputRate = 10000000 / BME280_GetCycleTime(&Project_Bme280Config, false);
+  return Respond(descriptor, response, OK_RESPONSE_FORMAT("Rate: %lu.%lu Hz"), (unsigned long) (outputRate / 10),
+    (unsigned long) (outputRate % 10));
+}
+
+/**
+ * @brief The command reading out a range of the stored sample history. Without parameters reports the range of the
+ *   available sample numbers and the history capacity. The requested samples are sent after the response in the
+ *   current protocol mode.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code History [<from> <count>]
+ *   In the binary mode the parameters are passed as two 32-bit little-endian integers.
+ */
+static uint16_t HistoryCommand(const Command_Descriptor *descriptor, char *response)
+{
+  uint32_t from;
+  uint32_t count;
+
+  if (TOKEN_EMPTY(descriptor->param))
+  {
+    uint32_t first;
+    uint32_t next;
+    History_GetRange(&first, &next);
+    return Respond(descriptor, response, OK_RESPONSE_FORMAT("First: %lu; Next: %lu; Capacity: %lu"),
+      (unsigned long) first, (unsigned long) next, (unsigned long) History_GetCapacity());
+  }
+
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+  {
+    if (descriptor->param.length != 8)
+      return Respond(descriptor, response, INVALID_PARAMETER_RESPONSE_FORMAT("%u bytes; Expected: 8 bytes"),
+        descriptor->param.length);
+
+    from = Frame_GetUint32((const uint8_t *) &descriptor->param.string[0]);
+    count = Frame_GetUint32((const uint8_t *) &descriptor->param.string[4]);
+  }
+  else if (!Command_TokenToUint(&descriptor->param, &from))
+    return Respond(descriptor, response, INVALID_VALUE_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT),
+      COMMAND_TOKEN_ARGS(descriptor->param));
+  else if (!Command_TokenToUint(&descriptor->value, &count))
+    return Respond(descriptor, response, INVALID_VALUE_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT),
+      COMMAND_TOKEN_ARGS(descriptor->value));
+
+  count = History_StartReadout(&from, count);
+  return Respond(descriptor, response, OK_RESPONSE_FORMAT("From: %lu; Count: %lu"), (unsigned long) from,
+    (unsigned long) count);
+}
+
+/**
+ * @brief The command returning the uncompensated ADC data of the latest sample taken in background, so the host can
+ *   compensate them with the calibration data returned by the <i>Calib</i> command.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code Raw
+ *   In the binary mode the values are returned packed.
+ */
+static uint16_t RawCommand(const Command_Descriptor *descriptor, char *response)
+{
+  Sampler_Sample sample;
+  uint16_t length = GetLatestSample(descriptor, &sample, response);
+  if (length != 0)
+    return length;
+
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+  {
+    response[0] = COMMAND_STATUS_OK;
+    Frame_PutRawData((uint8_t *) &response[1], &sample.rawData);
+    return 1 + FRAME_RAW_DATA_LENGTH;
+  }
+
+  return Respond(descriptor, response, OK_RESPONSE_FORMAT("P = %ld; T = %ld; H = %ld"),
+    (long) sample.rawData.pressure, (long) sample.rawData.temperature, (long) sample.rawData.humidity);
+}
+
+/**
+ * @brief The command returning the BME280 raw calibration data block (calib00 .. calib41) used by the compensation
+ *   formulas.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code Calib
+ *   In the text mode the data are returned as a hexadecimal string, and in the binary mode as is. The response is
+ *   delayed until the sensor initialization in progress is completed.
+ */
+static uint16_t CalibCommand(const Command_Descriptor *descriptor, char *response)
+{
+  // The response is discarded when deferred.
+  if (Sampler_IsInitializing())
+  {
+    Project_DeferCommand();
+    return 0;
+  }
+
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+  {
+    response[0] = COMMAND_STATUS_OK;
+    memcpy(&response[1], Project_TrimmingData, BME280_TRIMMING_DATA_LENGTH);
+    return 1 + BME280_TRIMMING_DATA_LENGTH;
+  }
+
+  char data[2 * BME280_TRIMMING_DATA_LENGTH + 1];
+  for (uint8_t index = 0; index < BME280_TRIMMING_DATA_LENGTH; index++)
+    sprintf(&data[2 * index], "%02X", Project_TrimmingData[index]);
+  return Respond(descriptor, response, OK_RESPONSE_FORMAT("%s"), data);
+}
 
 /**
- * @brief The command bindings array.
+ * @brief The command reading back or changing the sensor configuration at runtime. The changes are applied to the
+ *   sensor at once without resetting it and are saved to the persistent store, so they are restored on boot.
+ * @param descriptor The pointer to the input command descriptor structure.
+ * @param response The output response message buffer.
+ * @remarks Command usage:
+ *   @code Config [Mode Normal|Forced | P|H 0|1|2|4|8|16 | T 1|2|4|8|16 | Filter 0|2|4|8|16 |
+ *     Standby 0.5|10|20|62.5|125|250|500|1000 | Adaptive On|Off | Period 1-60000]
+ *   Without parameters returns the acquisition mode, the settings read back from the sensor, and the background
+ *   sampling period in milliseconds. Otherwise sets the selected setting, waiting for the measurement in progress to
+ *   complete. Setting the oversampling or the filter manually turns the adaptive oversampling off. The settings
+ *   cannot be changed while streaming. In the binary mode the parameters are passed as the text payload.
+ * @note Once per many thousands of changes saving the settings erases a flash sector, so the execution is stalled and
+ *   the USB interface is not serviced for about 1-2 seconds.
  */
-Command_Binding Command_Bindings[] = {
+static uint16_t ConfigCommand(const Command_Descriptor *descriptor, char *response)
+{
+  Command_Token param = descriptor->param;
+  Command_Token value = descriptor->value;
+  BME280_Config config = Project_Bme280UserConfig;
+  bool isAdaptive = Oversampling_IsEnabled();
+  uint32_t period = Sampler_GetDefaultPeriod();
+  I2C_Result result;
+  int8_t index;
+
+  if (descriptor->format == COMMAND_FORMAT_BINARY)
+    SplitParamToken(&param, &value);
+
+  if (TOKEN_EMPTY(param))
+  {
+    result = BME280_GetConfig(I2C1, &config);
+    if (result != I2C_RESULT_OK)
+      return GetI2cResultMessage(descriptor, result, response);
+
+    return Respond(descriptor, response,
+      OK_RESPONSE_FORMAT("Mode: %s; P: %s; T: %s; H: %s; Filter: %s; Standby: %s ms; Adaptive: %s; Period: %lu ms"),
+      Project_Bme280Config.mode == BME280_MODE_NORMAL ? "Normal" : "Forced",
+      ConfigOversamplings[config.pressureOversampling < 5 ? config.pressureOversampling : 5],
+      ConfigOversamplings[config.temperatureOversampling < 5 ? config.temperatureOversampling : 5],
+      ConfigOversamplings[config.humidityOversampling < 5 ? config.humidityOversampling : 5],
+      ConfigFilters[config.filter < 4 ? config.filter : 4], ConfigStandbyTimes[config.standbyTime],
+      isAdaptive ? "On" : "Off", (unsigned long) period);
+  }
+
+  if (TOKEN_EQUAL(param, "Mode"))
+  {
+    if (TOKEN_EQUAL(value, "Normal"))
+      config.mode = BME280_MODE_NORMAL;
+    else if (TOKEN_EQUAL(value, "Forced"))
+      config.mode = BME280_MODE_FORCED;
+    else
+      return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+        COMMAND_TOKEN_ARGS(value), "Normal, Forced");
+  }
+  else if (TOKEN_EQUAL(param, "P") || TOKEN_EQUAL(param, "H"))
+  {
+    if ((index = FindConfigValue(&value, ConfigOversamplings, 6)) < 0)
+      return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+        COMMAND_TOKEN_ARGS(value), "0, 1, 2, 4, 8, 16");
+
+    if (TOKEN_EQUAL(param, "P"))
+      config.pressureOversampling = index;
+    else
+      config.humidityOversampling = index;
+    isAdaptive = false;
+  }
+  else if (TOKEN_EQUAL(param, "T"))
+  {
+    // The temperature measurement cannot be skipped, as the other channels compensation depends on it.
+    if ((index = FindConfigValue(&value, &ConfigOversamplings[1], 5)) < 0)
+      return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+        COMMAND_TOKEN_ARGS(value), "1, 2, 4, 8, 16");
+
+    config.temperatureOversampling = index + 1;
+    isAdaptive = false;
+  }
+  else if (TOKEN_EQUAL(param, "Filter"))
+  {
+    if ((index = FindConfigValue(&value, ConfigFilters, 5)) < 0)
+      return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+        COMMAND_TOKEN_ARGS(value), "0, 2, 4, 8, 16");
+
+    config.filter = index;
+    isAdaptive = false;
+  }
+  else if (TOKEN_EQUAL(param, "Standby"))
+  {
+    if ((index = FindConfigValue(&value, ConfigStandbyTimes, 8)) < 0)
+      return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+        COMMAND_TOKEN_ARGS(value), "0.5, 10, 20, 62.5, 125, 250, 500, 1000");
+
+    config.standbyTime = index;
+  }
+  else if (TOKEN_EQUAL(param, "Adaptive"))
   {
-    .commandName = "Id",
-    .commandCallback = IdCommand
-  },
+    if (TOKEN_EQUAL(value, "On"))
+      isAdaptive = true;
+    else if (TOKEN_EQUAL(value, "Off"))
+      isAdaptive = false;
+    else
+      return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+        COMMAND_TOKEN_ARGS(value), "On, Off");
+  }
+  else if (TOKEN_EQUAL(param, "Period"))
   {
-    .commandName = "Measure",
-    .commandCallback = MeasureCommand
-  },
+    if (!Command_TokenToUint(&value, &period) || period < SAMPLER_MIN_PERIOD || period > SAMPLER_MAX_PERIOD)
+      return Respond(descriptor, response, INVALID_VALUE_RANGE_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%d", "%d"),
+        COMMAND_TOKEN_ARGS(value), SAMPLER_MIN_PERIOD, SAMPLER_MAX_PERIOD);
+  }
+  else
+    return Respond(descriptor, response, INVALID_PARAMETER_LIST_RESPONSE_FORMAT(COMMAND_TOKEN_FORMAT, "%s"),
+      COMMAND_TOKEN_ARGS(param), "Mode, P, T, H, Filter, Standby, Adaptive, Period");
+
+  // The streaming selects its own sensor settings and restores the saved ones when stopped.
+  if (Stream_IsActive())
+    return Respond(descriptor, response, ERROR_RESPONSE_FORMAT("The settings cannot be changed while streaming."));
+
+  // Waiting for the forced mode measurement in progress to complete. The response is discarded when deferred.
+  if (!Sampler_IsIdle())
   {
-    .commandName = "Reset",
-    .commandCallback = ResetCommand
+    Project_DeferCommand();
+    return 0;
   }
-};
+
+  // The adaptive oversampling starts over from the factors set by the user.
+  Project_Bme280UserConfig = config;
+  Project_Bme280Config = config;
+  Oversampling_SetEnabled(isAdaptive);
+  Sampler_SetDefaultPeriod(period);
+  Sampler_SetPeriod(period);
+
+  result = Sampler_ApplyConfig();
+  if (result != I2C_RESULT_OK)
+    return GetI2cResultMessage(descriptor, result, response);
+
+  if (!Project_SaveSettings())
+    return Respond(descriptor, response, ERROR_RESPONSE_FORMAT("Failed to save the settings."));
+
+  return Respond(descriptor, response, OK_RESPONSE);
+}
+
+/**
+ * @brief The default command callback.
+ */
+Command_Callback Command_DefaultCallback = UnknownCommand;
+
+/**
+ * @brief Expands a <i>COMMAND_TABLE</i> entry to its command binding.
+ */
+#define COMMAND_BINDING_ENTRY(id, name, first, last, callback) [COMMAND_ID_##id] = callback,
 
 /**
- * @brief The command bindings count value.
+ * @brief The command bindings array generated from the command table.
  */
-uint32_t Command_BindingsCount = sizeof(Command_Bindings) / sizeof(Command_Binding);
+Command_Callback Command_Bindings[COMMAND_ID_COUNT] = {COMMAND_TABLE(COMMAND_BINDING_ENTRY)};
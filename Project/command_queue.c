@@ -0,0 +1,150 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include "command_queue.h"
+#include "main.h"
+
+#if (CONFIG_COMMAND_QUEUE_LENGTH & (CONFIG_COMMAND_QUEUE_LENGTH - 1)) != 0
+#error "CONFIG_COMMAND_QUEUE_LENGTH must be a power of two."
+#endif
+
+/**
+ * @brief The command message slots. The messages are assembled directly in the slot following the last queued one.
+ */
+static char CommandQueue_Slots[CONFIG_COMMAND_QUEUE_LENGTH][CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
+
+/**
+ * @brief The free-running count of queued messages. Modified by the producer only.
+ */
+static volatile uint32_t CommandQueue_Head = 0;
+
+/**
+ * @brief The free-running count of processed messages. Modified by the consumer only.
+ */
+static volatile uint32_t CommandQueue_Tail = 0;
+
+/**
+ * @brief The length of the message being assembled.
+ */
+static uint16_t CommandQueue_AssembledLength = 0;
+
+/**
+ * @brief The flag indicating if the message being assembled is dropped because the queue is full.
+ */
+static bool CommandQueue_IsDropping = false;
+
+/**
+ * @brief The maximal observed queue depth.
+ */
+static uint32_t CommandQueue_HighWater = 0;
+
+/**
+ * @brief The number of dropped messages.
+ */
+static uint32_t CommandQueue_Dropped = 0;
+
+/**
+ * @brief The character terminating the command messages.
+ */
+static volatile char CommandQueue_Delimiter = 0x0A;
+
+/**
+ * @brief Sets the character terminating the command messages, e.g. the LF symbol for the text commands or the frame
+ *   delimiter for the binary ones. The new delimiter applies to the data received afterwards.
+ * @param delimiter The delimiter character.
+ */
+void CommandQueue_SetDelimiter(char delimiter)
+{
+  CommandQueue_Delimiter = delimiter;
+}
+
+/**
+ * @brief Splits the received data into delimiter-terminated command messages and queues them. This is the producer
+ *   side of the queue, it must be called from a single context (the USB CDC reception interrupt).
+ * @param string A pointer to the received data.
+ * @param length Length of the received data.
+ * @note Messages longer than <i>CONFIG_MAX_COMMAND_MESSAGE_LENGTH</i> are truncated. Messages that arrive while the
+ *   queue is full are dropped entirely.
+ */
+void CommandQueue_Put(const char *string, uint16_t length)
+{
+  for (uint16_t index = 0; index < length; index++)
+  {
+    uint32_t head = CommandQueue_Head;
+    bool isFull = head - CommandQueue_Tail >= CONFIG_COMMAND_QUEUE_LENGTH;
+    char *slot = CommandQueue_Slots[head & (CONFIG_COMMAND_QUEUE_LENGTH - 1)];
+
+    // Deciding on a message drop only when its first character arrives.
+    if (CommandQueue_AssembledLength == 0 && !CommandQueue_IsDropping)
+      CommandQueue_IsDropping = isFull;
+
+    if (string[index] != CommandQueue_Delimiter)
+    {
+      if (!CommandQueue_IsDropping && CommandQueue_AssembledLength < CONFIG_MAX_COMMAND_MESSAGE_LENGTH)
+        slot[CommandQueue_AssembledLength++] = string[index];
+      continue;
+    }
+
+    if (CommandQueue_IsDropping)
+    {
+      CommandQueue_Dropped++;
+      CommandQueue_IsDropping = false;
+      continue;
+    }
+
+    slot[CommandQueue_AssembledLength] = 0x00;
+    CommandQueue_AssembledLength = 0;
+    __DMB();
+    CommandQueue_Head = ++head;
+
+    uint32_t depth = head - CommandQueue_Tail;
+    if (depth > CommandQueue_HighWater)
+      CommandQueue_HighWater = depth;
+  }
+}
+
+/**
+ * @brief Gets the oldest queued command message without removing it from the queue. This is the consumer side of the
+ *   queue, it must be called from a single context (the main loop).
+ * @return A pointer to the null-terminated command message, or <i>NULL</i> if the queue is empty. The message stays
+ *   valid until <i>CommandQueue_Pop</i> is called.
+ */
+const char *CommandQueue_Peek()
+{
+  uint32_t tail = CommandQueue_Tail;
+  if (tail == CommandQueue_Head)
+    return NULL;
+
+  __DMB();
+  return CommandQueue_Slots[tail & (CONFIG_COMMAND_QUEUE_LENGTH - 1)];
+}
+
+/**
+ * @brief Removes the oldest queued command message from the queue releasing its slot for the producer.
+ */
+void CommandQueue_Pop()
+{
+  uint32_t tail = CommandQueue_Tail;
+  if (tail == CommandQueue_Head)
+    return;
+
+  __DMB();
+  CommandQueue_Tail = tail + 1;
+}
+
+/**
+ * @brief Gets the queue statistics.
+ * @param stats A pointer to the statistics structure to be filled.
+ */
+void CommandQueue_GetStats(CommandQueue_Stats *stats)
+{
+  stats->depth = CommandQueue_Head - CommandQueue_Tail;
+  stats->capacity = CONFIG_COMMAND_QUEUE_LENGTH;
+  stats->highWater = CommandQueue_HighWater;
+  stats->dropped = CommandQueue_Dropped;
+}
@@ -0,0 +1,53 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_COMMAND_QUEUE_H
+#define BME_READER_COMMAND_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+/**
+ * @brief The command queue statistics structure.
+ */
+typedef struct CommandQueue_Stats
+{
+  /**
+   * @brief The number of command messages currently waiting in the queue.
+   */
+  uint32_t depth;
+
+  /**
+   * @brief The maximal number of command messages the queue can hold.
+   */
+  uint32_t capacity;
+
+  /**
+   * @brief The maximal queue depth observed since the start.
+   */
+  uint32_t highWater;
+
+  /**
+   * @brief The number of command messages dropped because the queue was full.
+   */
+  uint32_t dropped;
+} CommandQueue_Stats;
+
+void CommandQueue_SetDelimiter(char delimiter);
+
+void CommandQueue_Put(const char *string, uint16_t length);
+
+const char *CommandQueue_Peek();
+
+void CommandQueue_Pop();
+
+void CommandQueue_GetStats(CommandQueue_Stats *stats);
+
+#endif //BME_READER_COMMAND_QUEUE_H
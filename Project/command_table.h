@@ -0,0 +1,35 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_COMMAND_TABLE_H
+#define BME_READER_COMMAND_TABLE_H
+
+/**
+ * @brief Defines the table of the supported commands. The command identifiers, the name lookup hash table, and the
+ *   callback bindings are generated from this table at compile time.
+ * @param X The macro expanded for every command as <i>X(id, name, first, last, callback)</i>, where <i>id</i> is the
+ *   upper-case command identifier suffix, <i>name</i> is the command name, <i>first</i> and <i>last</i> are the
+ *   lower-case first and last characters of the command name (as the C preprocessor cannot extract them from a string
+ *   literal at compile time), and <i>callback</i> is the command callback function defined in
+ *   <i>command_callbacks.c</i>.
+ * @note The command name hashes must not collide, otherwise the compilation fails with a duplicate case value error.
+ *   If so, a different name or a larger <i>CONFIG_COMMAND_HASH_TABLE_SIZE</i> value has to be selected.
+ */
+#define COMMAND_TABLE(X) \
+  X(ID, Id, 'i', 'd', IdCommand) \
+  X(MEASURE, Measure, 'm', 'e', MeasureCommand) \
+  X(RESET, Reset, 'r', 't', ResetCommand) \
+  X(STATS, Stats, 's', 's', StatsCommand) \
+  X(MODE, Mode, 'm', 'e', ModeCommand) \
+  X(STREAM, Stream, 's', 'm', StreamCommand) \
+  X(HISTORY, History, 'h', 'y', HistoryCommand) \
+  X(RAW, Raw, 'r', 'w', RawCommand) \
+  X(CALIB, Calib, 'c', 'b', CalibCommand) \
+  X(CONFIG, Config, 'c', 'g', ConfigCommand)
+
+#endif //BME_READER_COMMAND_TABLE_H
@@ -19,6 +19,22 @@
  */
 #define CONFIG_MAX_RESPONSE_MESSAGE_LENGTH (2 * (CONFIG_MAX_COMMAND_MESSAGE_LENGTH))
 
+/**
+ * @brief Defines the maximal number of received command messages waiting for processing. Must be a power of two.
+ */
+#define CONFIG_COMMAND_QUEUE_LENGTH 8
+
+/**
+ * @brief Defines the size of the command name lookup hash table. Must be a power of two.
+ */
+#define CONFIG_COMMAND_HASH_TABLE_SIZE 32
+
+/**
+ * @brief Defines the size of the buffer accumulating the response messages waiting for transmission. Must be a power
+ *   of two not less than the maximal response message length.
+ */
+#define CONFIG_TRANSMIT_BUFFER_SIZE 1024
+
 /**
  * @brief Defines the BME280 sensor pressure oversampling factor.
  * @see <i>BME280_PressureOversampling</i> enumeration values.
@@ -32,8 +48,8 @@
 #define CONFIG_TEMPERATURE_OVERSAMPLING_FACTOR BME280_TEMPERATURE_OVERSAMPLING_16
 
 /**
- * @brief Defines the BME280 sensor temperature oversampling factor.
- * @see <i>BME280_TemperatureOversampling</i> enumeration values.
+ * @brief Defines the BME280 sensor humidity oversampling factor.
+ * @see <i>BME280_HumidityOversampling</i> enumeration values.
  */
 #define CONFIG_HUMIDITY_OVERSAMPLING_FACTOR BME280_HUMIDITY_OVERSAMPLING_16
 
@@ -44,9 +60,80 @@
 #define CONFIG_FILTER_FACTOR BME280_FILTER_OFF
 
 /**
- * @brief Defines the BME280 sensor standby time.
+ * @brief Defines if the oversampling factors and the filter coefficient are adapted at runtime to the observed noise:
+ *   the settings with the shortest measurement time meeting the target noise values below are selected, and the ones
+ *   defined above are used initially. Off by default, as it overrides the configured settings; it can be enabled here
+ *   or at runtime with the <i>Config Adaptive On</i> command. The adapted settings are never saved.
+ */
+#define CONFIG_ADAPTIVE_OVERSAMPLING false
+
+/**
+ * @brief Defines the target RMS noise of the pressure values in Pa for the adaptive oversampling. The default one is
+ *   the typical noise with the x16 oversampling.
+ */
+#define CONFIG_PRESSURE_NOISE_TARGET 1.3F
+
+/**
+ * @brief Defines the target RMS noise of the temperature values in degC for the adaptive oversampling. Must not be less
+ *   than the resolution of the compensation engine used.
+ */
+#define CONFIG_TEMPERATURE_NOISE_TARGET 0.01F
+
+/**
+ * @brief Defines the target RMS noise of the humidity values in %RH for the adaptive oversampling.
+ */
+#define CONFIG_HUMIDITY_NOISE_TARGET 0.01F
+
+/**
+ * @brief Defines the number of the samples the noise is estimated over by the adaptive oversampling.
+ */
+#define CONFIG_NOISE_WINDOW_LENGTH 32
+
+/**
+ * @brief Defines the maximal time in milliseconds the filter output may take to follow a step change of the measured
+ *   values, which limits the filter coefficient selected by the adaptive oversampling at the given sampling period.
+ */
+#define CONFIG_MAX_FILTER_RESPONSE_TIME 2000
+
+/**
+ * @brief Defines the BME280 sensor acquisition mode: <i>BME280_MODE_NORMAL</i> for the continuous conversions, or
+ *   <i>BME280_MODE_FORCED</i> for the conversions triggered by the background sampling and the on-demand measurements
+ *   only, with the sensor sleeping in between.
+ * @see <i>BME280_Mode</i> enumeration values.
+ */
+#define CONFIG_MODE BME280_MODE_NORMAL
+
+/**
+ * @brief Defines the BME280 sensor standby time. Used in the normal mode only.
  * @see <i>BME280_StandbyTime</i> enumeration values.
  */
 #define CONFIG_STANDBY_TIME BME280_STANDBY_TIME_62ms5
 
+/**
+ * @brief Defines the engine used for BME280 measurements compensation. The integer engines do not use the FPU, but
+ *   change the reported values: the temperature is computed in 0.01 degC steps, and the pressure differs from the
+ *   double-precision formulas by up to 0.5 Pa with the 64-bit integer engine, or by several Pa with the 32-bit one.
+ * @see <i>BME280_Compensation</i> enumeration values.
+ */
+#define CONFIG_COMPENSATION BME280_COMPENSATION_FLOAT
+
+/**
+ * @brief Defines the background sampling period in milliseconds. In the normal mode the sensor is not read more often
+ *   than it outputs the new data. In the forced mode the sensor sleeps between the measurements, so the longer periods
+ *   reduce its self-heating and power consumption, and the <i>Measure</i> commands needing fresher data trigger the
+ *   measurements on demand.
+ */
+#define CONFIG_SAMPLING_PERIOD 50
+
+/**
+ * @brief Defines the maximal number of streamed samples waiting for transmission. Must be a power of two.
+ */
+#define CONFIG_STREAM_QUEUE_LENGTH 16
+
+/**
+ * @brief Defines the number of decimal places of the measured values in the command responses.
+ * @see <i>NUMBER_FORMAT_MAX_PRECISION</i> value.
+ */
+#define CONFIG_MEASUREMENT_PRECISION 6
+
 #endif //BME_READER_CONFIG_H
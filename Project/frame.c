@@ -0,0 +1,143 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include "frame.h"
+
+/**
+ * @brief Computes the CRC-16/CCITT-FALSE checksum (polynomial 0x1021, initial value 0xFFFF).
+ * @param data The data to compute the checksum of.
+ * @param length The data length in bytes.
+ * @return The checksum value.
+ */
+uint16_t Frame_GetCrc(const uint8_t *data, uint16_t length)
+{
+  uint16_t crc = 0xFFFF;
+  for (uint16_t index = 0; index < length; index++)
+  {
+    crc ^= (uint16_t) (data[index] << 8);
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = crc & 0x8000 ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+  }
+  return crc;
+}
+
+/**
+ * @brief Encodes the data with the Consistent Overhead Byte Stuffing (COBS) and appends the frame delimiter.
+ * @param data The data to encode.
+ * @param length The data length in bytes.
+ * @param frame The output buffer of at least <i>FRAME_ENCODED_LENGTH(length)</i> bytes.
+ * @return The encoded frame length including the delimiter.
+ */
+uint16_t Frame_Encode(const uint8_t *data, uint16_t length, uint8_t *frame)
+{
+  uint16_t codeIndex = 0;
+  uint16_t frameLength = 1;
+  uint8_t code = 1;
+
+  for (uint16_t index = 0; index < length; index++)
+  {
+    if (data[index] != FRAME_DELIMITER)
+    {
+      frame[frameLength++] = data[index];
+      code++;
+    }
+
+    // Closing the block on a zero byte or when the block reaches its maximal length.
+    if (data[index] == FRAME_DELIMITER || code == 0xFF)
+    {
+      frame[codeIndex] = code;
+      codeIndex = frameLength++;
+      code = 1;
+    }
+  }
+
+  frame[codeIndex] = code;
+  frame[frameLength++] = FRAME_DELIMITER;
+  return frameLength;
+}
+
+/**
+ * @brief Decodes the COBS encoded frame.
+ * @param frame The encoded frame without the delimiter.
+ * @param length The encoded frame length.
+ * @param data The output buffer of at least <i>length</i> bytes.
+ * @param dataLength A pointer to the variable that will be set to the decoded data length.
+ * @return <i>true</i> if the frame is valid, otherwise <i>false</i>.
+ */
+bool Frame_Decode(const uint8_t *frame, uint16_t length, uint8_t *data, uint16_t *dataLength)
+{
+  uint16_t index = 0;
+  uint16_t decodedLength = 0;
+
+  while (index < length)
+  {
+    uint8_t code = frame[index++];
+    if (code == FRAME_DELIMITER || index + code - 1 > length)
+      return false;
+
+    for (uint8_t count = 1; count < code; count++)
+    {
+      if (frame[index] == FRAME_DELIMITER)
+        return false;
+      data[decodedLength++] = frame[index++];
+    }
+
+    // A block shorter than the maximal one is followed by an encoded zero byte, except for the last block.
+    if (code != 0xFF && index < length)
+      data[decodedLength++] = FRAME_DELIMITER;
+  }
+
+  *dataLength = decodedLength;
+  return true;
+}
+
+/**
+ * @brief Writes the 32-bit value to the buffer in the little-endian byte order.
+ */
+void Frame_PutUint32(uint8_t *buffer, uint32_t value)
+{
+  buffer[0] = (uint8_t) value;
+  buffer[1] = (uint8_t) (value >> 8);
+  buffer[2] = (uint8_t) (value >> 16);
+  buffer[3] = (uint8_t) (value >> 24);
+}
+
+/**
+ * @brief Reads the 32-bit value from the buffer in the little-endian byte order.
+ */
+uint32_t Frame_GetUint32(const uint8_t *buffer)
+{
+  return (uint32_t) buffer[0] | (uint32_t) buffer[1] << 8 | (uint32_t) buffer[2] << 16 | (uint32_t) buffer[3] << 24;
+}
+
+/**
+ * @brief Packs the fixed-point values of the measurement in the formats of the BME280 integer compensation formulas:
+ *   the pressure in Pa as Q24.8, the temperature in 0.01 degC, and the humidity in %RH as Q22.10, each one as a 32-bit
+ *   little-endian value. The results of the integer compensation engines are packed as is, bit for bit.
+ * @param buffer The output buffer of at least <i>FRAME_MEASUREMENT_LENGTH</i> bytes.
+ * @param measurement A pointer to the measurement to pack.
+ */
+void Frame_PutMeasurement(uint8_t *buffer, const BME280_Measurement *measurement)
+{
+  Frame_PutUint32(&buffer[0], measurement->pressureFixed);
+  Frame_PutUint32(&buffer[4], (uint32_t) measurement->temperatureFixed);
+  Frame_PutUint32(&buffer[8], measurement->humidityFixed);
+}
+
+/**
+ * @brief Packs the uncompensated ADC data: the pressure, temperature, and humidity values, each one as a 32-bit
+ *   little-endian value.
+ * @param buffer The output buffer of at least <i>FRAME_RAW_DATA_LENGTH</i> bytes.
+ * @param rawData A pointer to the uncompensated ADC data to pack.
+ */
+void Frame_PutRawData(uint8_t *buffer, const BME280_RawData *rawData)
+{
+  Frame_PutUint32(&buffer[0], (uint32_t) rawData->pressure);
+  Frame_PutUint32(&buffer[4], (uint32_t) rawData->temperature);
+  Frame_PutUint32(&buffer[8], (uint32_t) rawData->humidity);
+}
@@ -0,0 +1,62 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_FRAME_H
+#define BME_READER_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bme280.h"
+
+/**
+ * @brief Defines the binary frame delimiter. The COBS encoded frames never contain it.
+ */
+#define FRAME_DELIMITER 0x00
+
+/**
+ * @brief Defines the length of the binary frame header: the command identifier and sequence number bytes.
+ */
+#define FRAME_HEADER_LENGTH 2
+
+/**
+ * @brief Defines the length of the binary frame CRC trailer.
+ */
+#define FRAME_CRC_LENGTH 2
+
+/**
+ * @brief Defines the length of the packed measurement.
+ */
+#define FRAME_MEASUREMENT_LENGTH 12
+
+/**
+ * @brief Defines the length of the packed uncompensated ADC data.
+ */
+#define FRAME_RAW_DATA_LENGTH 12
+
+/**
+ * @brief Gets the maximal COBS encoded frame length including the delimiter.
+ * @param length The decoded frame length.
+ */
+#define FRAME_ENCODED_LENGTH(length) ((length) + (length) / 254 + 2)
+
+uint16_t Frame_GetCrc(const uint8_t *data, uint16_t length);
+
+uint16_t Frame_Encode(const uint8_t *data, uint16_t length, uint8_t *frame);
+
+bool Frame_Decode(const uint8_t *frame, uint16_t length, uint8_t *data, uint16_t *dataLength);
+
+void Frame_PutUint32(uint8_t *buffer, uint32_t value);
+
+uint32_t Frame_GetUint32(const uint8_t *buffer);
+
+void Frame_PutMeasurement(uint8_t *buffer, const BME280_Measurement *measurement);
+
+void Frame_PutRawData(uint8_t *buffer, const BME280_RawData *rawData);
+
+#endif //BME_READER_FRAME_H
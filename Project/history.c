@@ -0,0 +1,155 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include "history.h"
+
+/**
+ * @brief The start of the sample history section reserved by the linker script.
+ */
+extern uint8_t _shistory[];
+
+/**
+ * @brief The end of the sample history section reserved by the linker script.
+ */
+extern uint8_t _ehistory[];
+
+/**
+ * @brief The free-running count of the stored samples. The index of the next sample to store.
+ */
+static uint32_t History_Head = 0;
+
+/**
+ * @brief The index of the next sample to read out by the <i>History_ReadNext</i> function.
+ */
+static uint32_t History_ReadoutIndex = 0;
+
+/**
+ * @brief The index following the last sample to read out by the <i>History_ReadNext</i> function.
+ */
+static uint32_t History_ReadoutEnd = 0;
+
+/**
+ * @brief Gets the pointer to the packed entry of the sample.
+ */
+static inline uint8_t *History_GetSlot(uint32_t index)
+{
+  return &_shistory[(index % History_GetCapacity()) * HISTORY_ENTRY_LENGTH];
+}
+
+/**
+ * @brief Stores the uncompensated sample in the history ring buffer overwriting the oldest one if the buffer is full.
+ *   The compensation is performed only when the sample is read out.
+ * @param timestamp The system tick value (in milliseconds) when the sample has been taken.
+ * @param rawData A pointer to the uncompensated sample data.
+ */
+void History_Put(uint32_t timestamp, const BME280_RawData *rawData)
+{
+  if (History_GetCapacity() == 0)
+    return;
+
+  uint8_t *slot = History_GetSlot(History_Head++);
+  uint32_t pressure = (uint32_t) rawData->pressure;
+  uint32_t temperature = (uint32_t) rawData->temperature;
+  uint32_t humidity = (uint32_t) rawData->humidity;
+
+  slot[0] = (uint8_t) timestamp;
+  slot[1] = (uint8_t) (timestamp >> 8);
+  slot[2] = (uint8_t) (timestamp >> 16);
+  slot[3] = (uint8_t) (timestamp >> 24);
+  slot[4] = (uint8_t) pressure;
+  slot[5] = (uint8_t) (pressure >> 8);
+  slot[6] = (uint8_t) (((pressure >> 16) & 0x0F) | (temperature << 4));
+  slot[7] = (uint8_t) (temperature >> 4);
+  slot[8] = (uint8_t) (temperature >> 12);
+  slot[9] = (uint8_t) humidity;
+  slot[10] = (uint8_t) (humidity >> 8);
+}
+
+/**
+ * @brief Gets the maximal number of samples the history section reserved by the linker script can hold.
+ */
+uint32_t History_GetCapacity()
+{
+  return (uint32_t) (_ehistory - _shistory) / HISTORY_ENTRY_LENGTH;
+}
+
+/**
+ * @brief Gets the range of the sample indices available in the history.
+ * @param first A pointer to the variable that will be set to the oldest available sample index.
+ * @param next A pointer to the variable that will be set to the index of the next sample to be stored.
+ */
+void History_GetRange(uint32_t *first, uint32_t *next)
+{
+  uint32_t capacity = History_GetCapacity();
+  *next = History_Head;
+  *first = History_Head > capacity ? History_Head - capacity : 0;
+}
+
+/**
+ * @brief Gets the sample from the history.
+ * @param index The sample index.
+ * @param entry A pointer to the structure that will be filled with the unpacked sample.
+ * @return <i>true</i> if the sample is available, or <i>false</i> if it has not been stored yet or has been already
+ *   overwritten.
+ */
+bool History_Get(uint32_t index, History_Entry *entry)
+{
+  uint32_t first;
+  uint32_t next;
+  History_GetRange(&first, &next);
+  if (index < first || index >= next)
+    return false;
+
+  const uint8_t *slot = History_GetSlot(index);
+  entry->index = index;
+  entry->timestamp = (uint32_t) slot[0] | (uint32_t) slot[1] << 8 | (uint32_t) slot[2] << 16 |
+    (uint32_t) slot[3] << 24;
+  entry->rawData.pressure = (int32_t) (slot[4] | slot[5] << 8 | (slot[6] & 0x0F) << 16);
+  entry->rawData.temperature = (int32_t) (slot[6] >> 4 | slot[7] << 4 | slot[8] << 12);
+  entry->rawData.humidity = (int32_t) (slot[9] | slot[10] << 8);
+  return true;
+}
+
+/**
+ * @brief Starts reading out the range of samples with the <i>History_ReadNext</i> function. Cancels the previous
+ *   readout.
+ * @param from A pointer to the index of the first sample to read out. Clamped to the range of the available samples.
+ * @param count The maximal number of samples to read out.
+ * @return The number of samples to be read out.
+ */
+uint32_t History_StartReadout(uint32_t *from, uint32_t count)
+{
+  uint32_t first;
+  uint32_t next;
+  History_GetRange(&first, &next);
+
+  *from = *from < first ? first : *from > next ? next : *from;
+  History_ReadoutIndex = *from;
+  History_ReadoutEnd = next - History_ReadoutIndex < count ? next : History_ReadoutIndex + count;
+  return History_ReadoutEnd - History_ReadoutIndex;
+}
+
+/**
+ * @brief Gets the next sample of the range requested by the <i>History_StartReadout</i> function. The samples
+ *   overwritten during the readout are skipped.
+ * @param entry A pointer to the structure that will be filled with the unpacked sample.
+ * @return <i>true</i> if the sample has been read, or <i>false</i> if the readout has been completed.
+ */
+bool History_ReadNext(History_Entry *entry)
+{
+  uint32_t first;
+  uint32_t next;
+  History_GetRange(&first, &next);
+  if (History_ReadoutIndex < first)
+    History_ReadoutIndex = first;
+
+  if (History_ReadoutIndex >= History_ReadoutEnd)
+    return false;
+
+  return History_Get(History_ReadoutIndex++, entry);
+}
@@ -0,0 +1,56 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_HISTORY_H
+#define BME_READER_HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "bme280.h"
+
+/**
+ * @brief Defines the length of a packed history entry: the 32-bit timestamp followed by the 20-bit pressure, 20-bit
+ *   temperature, and 16-bit humidity raw values.
+ */
+#define HISTORY_ENTRY_LENGTH 11
+
+/**
+ * @brief The unpacked history entry structure.
+ */
+typedef struct History_Entry
+{
+  /**
+   * @brief The free-running sample number.
+   */
+  uint32_t index;
+
+  /**
+   * @brief The system tick value (in milliseconds) when the sample has been taken.
+   */
+  uint32_t timestamp;
+
+  /**
+   * @brief The uncompensated sample data.
+   */
+  BME280_RawData rawData;
+} History_Entry;
+
+void History_Put(uint32_t timestamp, const BME280_RawData *rawData);
+
+uint32_t History_GetCapacity();
+
+void History_GetRange(uint32_t *first, uint32_t *next);
+
+bool History_Get(uint32_t index, History_Entry *entry);
+
+uint32_t History_StartReadout(uint32_t *from, uint32_t count);
+
+bool History_ReadNext(History_Entry *entry);
+
+#endif //BME_READER_HISTORY_H
@@ -9,124 +9,388 @@
 #include "i2c.h"
 
 /**
- * @brief Writes the buffer bytes to the I2C bus.
- * @param i2c The I2C peripheral structure to be used for communication.
- * @param address The 7-bit I2C address with the "read/write" flag bit shifted out.
- * @param buffer A pointer to the buffer where the buffer to be written are stored.
- * @param length The number of buffer bytes to be written from the buffer.
- * @param sendStop Defines if the "stop" condition should be issued after the buffer have been written.
- *   Set to <i>true</i> if further sequential read/write operations will take place after completing the function.
- * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ * @brief The transaction currently running on the bus, or <i>NULL</i> if the engine is idle.
+ */
+static I2C_Transaction *volatile I2C_Current = NULL;
+
+/**
+ * @brief The first transaction waiting in the queue.
+ */
+static I2C_Transaction *I2C_QueueHead = NULL;
+
+/**
+ * @brief The last transaction waiting in the queue.
  */
-I2C_Result I2C_Write(I2C_TypeDef *i2c, uint8_t address, uint8_t *buffer, uint16_t length, bool sendStop)
+static I2C_Transaction *I2C_QueueTail = NULL;
+
+/**
+ * @brief The DMA stream serving the reception of the I2C peripheral.
+ */
+static struct
 {
-  I2C_CLEAR_ALL_FLAGS(i2c);
+  I2C_TypeDef *i2c;
+  DMA_TypeDef *dma;
+  uint32_t stream;
+} I2C_RxDma = {0};
 
-  // Sending the "(re)start" condition.
-  uint16_t attempts = I2C_MAX_ATTEMPTS;
-  I2C_SEND_START(i2c);
-  while (!I2C_IS_START_OK(i2c) && --attempts);
-  if (!attempts)
-  {
-    I2C_CLEAR_START(i2c);
-    I2C_SEND_STOP(i2c);
-    return I2C_RESULT_START_FAILED;
-  }
+/**
+ * @brief Checks if the transaction data are read using the DMA.
+ * @param transaction A pointer to the transaction.
+ * @return <i>true</i> if the DMA stream is assigned to the transaction I2C peripheral, and the read is long enough.
+ */
+static bool I2C_IsRxDmaUsed(const I2C_Transaction *transaction)
+{
+  return I2C_RxDma.i2c == transaction->i2c && transaction->readLength >= I2C_DMA_MIN_LENGTH;
+}
+
+/**
+ * @brief Issues the START condition for the transaction phase following the current one.
+ * @param transaction A pointer to the transaction.
+ */
+static void I2C_StartPhase(I2C_Transaction *transaction)
+{
+  transaction->phase = I2C_PHASE_START;
+  I2C_SEND_START(transaction->i2c);
+}
+
+/**
+ * @brief Starts the next queued transaction, if any. Must be called with the interrupts disabled or from the I2C
+ *   interrupt context.
+ */
+static void I2C_StartNext()
+{
+  I2C_Transaction *transaction = I2C_QueueHead;
+  I2C_Current = transaction;
+  if (transaction == NULL)
+    return;
+
+  I2C_QueueHead = transaction->next;
+  if (I2C_QueueHead == NULL)
+    I2C_QueueTail = NULL;
 
-  // Sending the address with the "write" flag.
-  attempts = I2C_MAX_ATTEMPTS;
-  I2C_SEND_ADDRESS_WRITE(i2c, address);
-  while (!I2C_IS_ADDRESS_OK(i2c) && !I2C_IS_ACK_FAILED(i2c) && --attempts);
-  if (!attempts || I2C_IS_ACK_FAILED(i2c))
+  transaction->index = 0;
+  transaction->startTick = HAL_GetTick();
+  I2C_CLEAR_ALL_FLAGS(transaction->i2c);
+  I2C_ENABLE_INTERRUPTS(transaction->i2c);
+  I2C_StartPhase(transaction);
+}
+
+/**
+ * @brief Completes the current transaction, notifies its owner, and starts the next queued transaction.
+ * @param transaction A pointer to the current transaction.
+ * @param result The transaction result.
+ */
+static void I2C_Complete(I2C_Transaction *transaction, I2C_Result result)
+{
+  I2C_DISABLE_INTERRUPTS(transaction->i2c);
+  if (I2C_IsRxDmaUsed(transaction))
   {
-    I2C_CLEAR_ACK_FAILED_FLAG(i2c);
-    I2C_SEND_STOP(i2c);
-    return I2C_RESULT_ADDRESS_FAILED;
+    LL_DMA_DisableStream(I2C_RxDma.dma, I2C_RxDma.stream);
+    I2C_DISABLE_RX_DMA(transaction->i2c);
   }
 
-  // Writing the buffer bytes.
-  I2C_CLEAR_ADDRESS_OK_FLAG(i2c);
-  for (uint16_t counter = 0; counter < length; counter++)
-  {
-    attempts = I2C_MAX_ATTEMPTS;
-    I2C_WRITE_BYTE(i2c, buffer[counter]);
-    while (!I2C_WRITE_BYTE_OK(i2c) && !I2C_IS_ACK_FAILED(i2c) && --attempts);
+  if (result != I2C_RESULT_OK)
+    I2C_SEND_STOP(transaction->i2c);
 
-    if (!attempts || I2C_IS_ACK_FAILED(i2c))
-    {
-      I2C_CLEAR_ACK_FAILED_FLAG(i2c);
-      I2C_SEND_STOP(i2c);
+  transaction->result = result;
+  __DMB();
+  transaction->isCompleted = true;
+
+  if (transaction->callback != NULL)
+    transaction->callback(transaction);
+
+  I2C_StartNext();
+}
+
+/**
+ * @brief Gets the failure result code corresponding to the transaction phase.
+ * @param transaction A pointer to the transaction.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ */
+static I2C_Result I2C_GetPhaseFailure(const I2C_Transaction *transaction)
+{
+  switch (transaction->phase)
+  {
+    case I2C_PHASE_START:
+      return I2C_RESULT_START_FAILED;
+    case I2C_PHASE_ADDRESS:
+      return I2C_RESULT_ADDRESS_FAILED;
+    case I2C_PHASE_WRITE:
       return I2C_RESULT_ACK_FAILED;
-    }
+    default:
+      return I2C_RESULT_READ_FAILED;
   }
+}
 
-  // Sending the "stop" condition if necessary.
-  if (sendStop)
-    I2C_SEND_STOP(i2c);
+/**
+ * @brief Assigns the DMA stream used to read the data bytes from the I2C peripheral. The stream must be configured for
+ *   the peripheral-to-memory byte transfers from the peripheral data register with the memory increment, and its
+ *   transfer complete and transfer error interrupts must call the <i>I2C_DmaInterruptHandler</i> function.
+ * @param i2c A pointer to the I2C peripheral structure.
+ * @param dma A pointer to the DMA controller structure, or <i>NULL</i> to read all the data in the interrupt handler.
+ * @param stream The DMA stream number.
+ */
+void I2C_SetRxDma(I2C_TypeDef *i2c, DMA_TypeDef *dma, uint32_t stream)
+{
+  I2C_RxDma.i2c = dma != NULL ? i2c : NULL;
+  I2C_RxDma.dma = dma;
+  I2C_RxDma.stream = stream;
+}
+
+/**
+ * @brief Queues the I2C transaction for execution. The transaction is performed in the I2C interrupt context, and its
+ *   completion is signalled by the <i>isCompleted</i> flag and the optional callback.
+ * @param transaction A pointer to the transaction structure. Must stay valid until the transaction is completed.
+ */
+void I2C_Submit(I2C_Transaction *transaction)
+{
+  transaction->isCompleted = false;
+  transaction->result = I2C_RESULT_OK;
+  transaction->next = NULL;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  if (I2C_QueueTail != NULL)
+    I2C_QueueTail->next = transaction;
+  else
+    I2C_QueueHead = transaction;
+  I2C_QueueTail = transaction;
 
-  return I2C_RESULT_OK;
+  if (I2C_Current == NULL)
+    I2C_StartNext();
+
+  __set_PRIMASK(primask);
 }
 
 /**
- * @brief Reads the data bytes from the I2C bus.
+ * @brief Performs the I2C write-then-read transaction and waits for its completion. The core sleeps while waiting.
  * @param i2c The I2C peripheral structure to be used for communication.
  * @param address The 7-bit I2C address with the "read/write" flag bit shifted out.
- * @param buffer A pointer to the buffer where the data to be read will be stored.
- * @param length The number of data bytes to be read to the buffer.
- * @param sendStop Defines if the "stop" condition should be issued after the data have been read.
- *   Set to <i>true</i> if further sequential read/write operations will take place after completing the function.
+ * @param writeBuffer A pointer to the buffer where the bytes to be written are stored.
+ * @param writeLength The number of bytes to be written. Set to zero to perform a read only.
+ * @param readBuffer A pointer to the buffer where the bytes to be read will be stored.
+ * @param readLength The number of bytes to be read. Set to zero to perform a write only.
  * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ * @note Must not be called from interrupts.
  */
-I2C_Result I2C_Read(I2C_TypeDef *i2c, uint8_t address, uint8_t *buffer, uint16_t length, bool sendStop)
+I2C_Result I2C_Transfer(I2C_TypeDef *i2c, uint8_t address, const uint8_t *writeBuffer, uint16_t writeLength,
+  uint8_t *readBuffer, uint16_t readLength)
 {
-  I2C_CLEAR_ALL_FLAGS(i2c);
+  I2C_Transaction transaction = {
+    .i2c = i2c,
+    .address = address,
+    .writeBuffer = writeBuffer,
+    .writeLength = writeLength,
+    .readBuffer = readBuffer,
+    .readLength = readLength
+  };
+
+  I2C_Submit(&transaction);
 
-  // Sending the "(re)start" condition.
-  uint16_t attempts = I2C_MAX_ATTEMPTS;
-  I2C_SEND_START(i2c);
-  while (!I2C_IS_START_OK(i2c) && --attempts);
-  if (!attempts)
+  // Checking the flag with the interrupts disabled, so that a completion occurring right before the WFI instruction
+  // still wakes the core up.
+  __disable_irq();
+  while (!transaction.isCompleted)
   {
-    I2C_CLEAR_START(i2c);
-    I2C_SEND_STOP(i2c);
-    return I2C_RESULT_START_FAILED;
+    I2C_CheckTimeout();
+    if (!transaction.isCompleted)
+      __WFI();
+    __enable_irq();
+    __disable_irq();
   }
+  __enable_irq();
 
-  // Sending the address with the "read" flag.
-  attempts = I2C_MAX_ATTEMPTS;
-  I2C_SEND_ADDRESS_READ(i2c, address);
-  while (!I2C_IS_ADDRESS_OK(i2c) && !I2C_IS_ACK_FAILED(i2c) && --attempts);
-  if (!attempts || I2C_IS_ACK_FAILED(i2c))
+  return transaction.result;
+}
+
+/**
+ * @brief Checks if there are no running or queued I2C transactions.
+ * @return <i>true</i> if the I2C engine is idle, otherwise <i>false</i>.
+ */
+bool I2C_IsIdle()
+{
+  return I2C_Current == NULL;
+}
+
+/**
+ * @brief Aborts the current I2C transaction if it has not been completed within the <i>I2C_TIMEOUT</i> period.
+ *   Must be called periodically from the main loop.
+ */
+void I2C_CheckTimeout()
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  I2C_Transaction *transaction = I2C_Current;
+  if (transaction != NULL && HAL_GetTick() - transaction->startTick > I2C_TIMEOUT)
   {
-    I2C_CLEAR_ACK_FAILED_FLAG(i2c);
-    I2C_SEND_STOP(i2c);
-    return I2C_RESULT_ADDRESS_FAILED;
+    I2C_CLEAR_START(transaction->i2c);
+    I2C_Complete(transaction, I2C_GetPhaseFailure(transaction));
+  }
+
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Handles the I2C event interrupt. Must be called from the I2C event interrupt handler.
+ * @param i2c A pointer to the I2C peripheral structure that has raised the interrupt.
+ */
+void I2C_EventInterruptHandler(I2C_TypeDef *i2c)
+{
+  I2C_Transaction *transaction = I2C_Current;
+  if (transaction == NULL || transaction->i2c != i2c)
+  {
+    I2C_DISABLE_INTERRUPTS(i2c);
+    return;
   }
 
-  // Reading the data bytes.
-  I2C_CLEAR_ADDRESS_OK_FLAG(i2c);
-  for (uint16_t counter = 0; counter < length; counter++)
+  // The "(re)start" condition has been issued: sending the address with the "write" or "read" flag.
+  if (I2C_IS_START_OK(i2c))
   {
-    if (counter < length - 1)
-      I2C_ACK_NEXT_READ(i2c);
+    bool isWriting = transaction->index < transaction->writeLength;
+    transaction->phase = I2C_PHASE_ADDRESS;
+    if (isWriting)
+      I2C_SEND_ADDRESS_WRITE(i2c, transaction->address);
     else
+      I2C_SEND_ADDRESS_READ(i2c, transaction->address);
+    return;
+  }
+
+  // The address has been acknowledged.
+  if (I2C_IS_ADDRESS_OK(i2c))
+  {
+    if (transaction->index < transaction->writeLength)
     {
-      I2C_NACK_NEXT_READ(i2c);
+      transaction->phase = I2C_PHASE_WRITE;
+      I2C_CLEAR_ADDRESS_OK_FLAG(i2c);
+    }
+    else
+    {
+      // Reading a single byte requires the NACK and STOP to be set up around clearing the ADDR flag.
+      transaction->phase = I2C_PHASE_READ;
+      transaction->index = 0;
+      if (I2C_IsRxDmaUsed(transaction))
+      {
+        // The DMA reads all the bytes, and the LAST bit makes the peripheral not acknowledge the last one. The STOP
+        // condition is issued on the DMA transfer completion.
+        LL_DMA_SetMemoryAddress(I2C_RxDma.dma, I2C_RxDma.stream, (uintptr_t) transaction->readBuffer);
+        LL_DMA_SetDataLength(I2C_RxDma.dma, I2C_RxDma.stream, transaction->readLength);
+        LL_DMA_EnableStream(I2C_RxDma.dma, I2C_RxDma.stream);
+        I2C_ENABLE_RX_DMA(i2c);
+        I2C_ACK_NEXT_READ(i2c);
+        I2C_CLEAR_ADDRESS_OK_FLAG(i2c);
+        return;
+      }
 
-      if (sendStop)
+      if (transaction->readLength == 1)
+      {
+        I2C_NACK_NEXT_READ(i2c);
+        I2C_CLEAR_ADDRESS_OK_FLAG(i2c);
         I2C_SEND_STOP(i2c);
+      }
+      else
+      {
+        I2C_ACK_NEXT_READ(i2c);
+        I2C_CLEAR_ADDRESS_OK_FLAG(i2c);
+      }
+    }
+
+    I2C_ENABLE_BUFFER_INTERRUPT(i2c);
+    return;
+  }
+
+  if (transaction->phase == I2C_PHASE_WRITE)
+  {
+    // Feeding the data register, and waiting for the last byte transfer to finish with the buffer interrupt disabled.
+    if (transaction->index < transaction->writeLength)
+    {
+      if (I2C_IS_TX_EMPTY(i2c))
+      {
+        I2C_WRITE_BYTE(i2c, transaction->writeBuffer[transaction->index++]);
+        if (transaction->index == transaction->writeLength)
+          I2C_DISABLE_BUFFER_INTERRUPT(i2c);
+      }
+      return;
+    }
+
+    if (!I2C_WRITE_BYTE_OK(i2c))
+      return;
+
+    if (transaction->readLength > 0)
+    {
+      I2C_StartPhase(transaction);
+      return;
     }
 
-    attempts = I2C_MAX_ATTEMPTS;
-    while (!I2C_IS_BYTE_RECEIVED(i2c) && --attempts);
-    if (!attempts)
+    I2C_SEND_STOP(i2c);
+    I2C_Complete(transaction, I2C_RESULT_OK);
+    return;
+  }
+
+  if (transaction->phase == I2C_PHASE_READ && I2C_IS_BYTE_RECEIVED(i2c))
+  {
+    transaction->readBuffer[transaction->index++] = I2C_READ_BYTE(i2c);
+
+    // The second to last byte has been read: the last one must not be acknowledged.
+    if (transaction->readLength - transaction->index == 1)
     {
+      I2C_NACK_NEXT_READ(i2c);
       I2C_SEND_STOP(i2c);
-      return I2C_RESULT_READ_FAILED;
     }
+    else if (transaction->index == transaction->readLength)
+    {
+      I2C_ACK_NEXT_READ(i2c);
+      I2C_Complete(transaction, I2C_RESULT_OK);
+    }
+  }
+}
+
+/**
+ * @brief Handles the I2C error interrupt. Must be called from the I2C error interrupt handler.
+ * @param i2c A pointer to the I2C peripheral structure that has raised the interrupt.
+ */
+void I2C_ErrorInterruptHandler(I2C_TypeDef *i2c)
+{
+  I2C_Transaction *transaction = I2C_Current;
+  bool isAckFailed = I2C_IS_ACK_FAILED(i2c);
+  bool isBusError = I2C_IS_BUS_ERROR(i2c);
+
+  I2C_CLEAR_ACK_FAILED_FLAG(i2c);
+  I2C_CLEAR_BUS_ERROR_FLAGS(i2c);
+
+  if (transaction == NULL || transaction->i2c != i2c)
+  {
+    I2C_DISABLE_INTERRUPTS(i2c);
+    return;
+  }
+
+  if (isBusError)
+    I2C_Complete(transaction, I2C_RESULT_START_FAILED);
+  else if (isAckFailed)
+    I2C_Complete(transaction, I2C_GetPhaseFailure(transaction));
+}
+
+/**
+ * @brief Handles the DMA stream interrupt of the I2C reception. Must be called from the DMA stream interrupt handler
+ *   after its flags have been cleared.
+ * @param i2c A pointer to the I2C peripheral structure served by the DMA stream.
+ * @param isTransferCompleted <i>true</i> if the transfer has been completed, or <i>false</i> on a transfer error.
+ */
+void I2C_DmaInterruptHandler(I2C_TypeDef *i2c, bool isTransferCompleted)
+{
+  I2C_Transaction *transaction = I2C_Current;
+  if (transaction == NULL || transaction->i2c != i2c || transaction->phase != I2C_PHASE_READ)
+    return;
 
-    buffer[counter] = I2C_READ_BYTE(i2c);
+  if (!isTransferCompleted)
+  {
+    I2C_Complete(transaction, I2C_RESULT_READ_FAILED);
+    return;
   }
 
-  return I2C_RESULT_OK;
+  I2C_SEND_STOP(i2c);
+  transaction->index = transaction->readLength;
+  I2C_ACK_NEXT_READ(i2c);
+  I2C_Complete(transaction, I2C_RESULT_OK);
 }
@@ -14,9 +14,15 @@
 #include "main.h"
 
 /**
- * @brief Defines the maximal number of I2C successive flag polling attempts before the operation will be timed out.
+ * @brief Defines the maximal I2C transaction duration in milliseconds before the transaction will be timed out.
  */
-#define I2C_MAX_ATTEMPTS 1000
+#define I2C_TIMEOUT 10
+
+/**
+ * @brief Defines the minimal number of bytes to be read using the DMA. Single-byte reads require the NACK to be set up
+ *   before the ADDR flag is cleared, so they are always performed by the interrupt handler.
+ */
+#define I2C_DMA_MIN_LENGTH 2
 
 /* Hardware control macros. */
 #define I2C_CLEAR_ALL_FLAGS(i2c)            (WRITE_REG(i2c->SR1, 0x0000))
@@ -36,6 +42,15 @@
 #define I2C_NACK_NEXT_READ(i2c)             (LL_I2C_AcknowledgeNextData(i2c, LL_I2C_NACK))
 #define I2C_IS_BYTE_RECEIVED(i2c)           (LL_I2C_IsActiveFlag_RXNE(i2c))
 #define I2C_READ_BYTE(i2c)                  (LL_I2C_ReceiveData8(i2c))
+#define I2C_IS_TX_EMPTY(i2c)                (LL_I2C_IsActiveFlag_TXE(i2c))
+#define I2C_IS_BUS_ERROR(i2c)               (LL_I2C_IsActiveFlag_BERR(i2c) || LL_I2C_IsActiveFlag_ARLO(i2c))
+#define I2C_CLEAR_BUS_ERROR_FLAGS(i2c)      (LL_I2C_ClearFlag_BERR(i2c), LL_I2C_ClearFlag_ARLO(i2c))
+#define I2C_ENABLE_INTERRUPTS(i2c)          (LL_I2C_EnableIT_EVT(i2c), LL_I2C_EnableIT_ERR(i2c))
+#define I2C_DISABLE_INTERRUPTS(i2c)         (CLEAR_BIT(i2c->CR2, I2C_CR2_ITEVTEN | I2C_CR2_ITBUFEN | I2C_CR2_ITERREN))
+#define I2C_ENABLE_BUFFER_INTERRUPT(i2c)    (LL_I2C_EnableIT_BUF(i2c))
+#define I2C_DISABLE_BUFFER_INTERRUPT(i2c)   (LL_I2C_DisableIT_BUF(i2c))
+#define I2C_ENABLE_RX_DMA(i2c)              (LL_I2C_EnableDMAReq_RX(i2c), LL_I2C_EnableLastDMA(i2c))
+#define I2C_DISABLE_RX_DMA(i2c)             (LL_I2C_DisableDMAReq_RX(i2c), LL_I2C_DisableLastDMA(i2c))
 
 /**
  * @brief The enumeration of I2C operation results.
@@ -68,8 +83,119 @@ typedef enum I2C_Result
   I2C_RESULT_READ_FAILED
 } I2C_Result;
 
-I2C_Result I2C_Write(I2C_TypeDef *i2c, uint8_t address, uint8_t *buffer, uint16_t length, bool sendStop);
+/**
+ * @brief The enumeration of I2C transaction phases.
+ */
+typedef enum I2C_Phase
+{
+  /**
+   * @brief Waiting for the START condition to be issued.
+   */
+  I2C_PHASE_START,
+
+  /**
+   * @brief Waiting for the address to be acknowledged.
+   */
+  I2C_PHASE_ADDRESS,
+
+  /**
+   * @brief Writing the data bytes.
+   */
+  I2C_PHASE_WRITE,
+
+  /**
+   * @brief Reading the data bytes.
+   */
+  I2C_PHASE_READ
+} I2C_Phase;
+
+typedef struct I2C_Transaction I2C_Transaction;
+
+/**
+ * @brief The I2C transaction completion callback definition. Called from the I2C interrupt context.
+ */
+typedef void (*I2C_Callback)(I2C_Transaction *transaction);
+
+/**
+ * @brief The I2C transaction structure. Describes a write-then-read operation performed in a single bus session: the
+ *   write buffer bytes are written first, and then the read buffer is filled after a repeated START condition.
+ *   Either of the phases may be omitted by setting its length to zero.
+ * @note The structure must stay valid until the transaction is completed.
+ */
+struct I2C_Transaction
+{
+  /**
+   * @brief A pointer to the I2C peripheral structure to be used for communication.
+   */
+  I2C_TypeDef *i2c;
+
+  /**
+   * @brief The 7-bit I2C address with the "read/write" flag bit shifted out.
+   */
+  uint8_t address;
+
+  /**
+   * @brief A pointer to the buffer where the bytes to be written are stored.
+   */
+  const uint8_t *writeBuffer;
+
+  /**
+   * @brief The number of bytes to be written.
+   */
+  uint16_t writeLength;
+
+  /**
+   * @brief A pointer to the buffer where the bytes to be read will be stored.
+   */
+  uint8_t *readBuffer;
+
+  /**
+   * @brief The number of bytes to be read.
+   */
+  uint16_t readLength;
+
+  /**
+   * @brief The optional completion callback.
+   */
+  I2C_Callback callback;
+
+  /**
+   * @brief An arbitrary user context pointer for the completion callback.
+   */
+  void *context;
+
+  /**
+   * @brief The transaction result. Valid after the transaction is completed.
+   */
+  volatile I2C_Result result;
+
+  /**
+   * @brief The flag indicating if the transaction has been completed.
+   */
+  volatile bool isCompleted;
+
+  /* The engine private fields. */
+  I2C_Phase phase;
+  uint16_t index;
+  uint32_t startTick;
+  I2C_Transaction *next;
+};
+
+void I2C_SetRxDma(I2C_TypeDef *i2c, DMA_TypeDef *dma, uint32_t stream);
+
+void I2C_Submit(I2C_Transaction *transaction);
+
+I2C_Result I2C_Transfer(I2C_TypeDef *i2c, uint8_t address, const uint8_t *writeBuffer, uint16_t writeLength,
+  uint8_t *readBuffer, uint16_t readLength);
+
+bool I2C_IsIdle();
+
+void I2C_CheckTimeout();
+
+void I2C_EventInterruptHandler(I2C_TypeDef *i2c);
+
+void I2C_ErrorInterruptHandler(I2C_TypeDef *i2c);
 
-I2C_Result I2C_Read(I2C_TypeDef *i2c, uint8_t address, uint8_t *buffer, uint16_t length, bool sendStop);
+void I2C_DmaInterruptHandler(I2C_TypeDef *i2c, bool isTransferCompleted);
 
 #endif
@@ -0,0 +1,131 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+
+#include "number_format.h"
+
+/**
+ * @brief Defines the maximal number of fraction bits, so that the fraction multiplied by 10 still fits into 64 bits.
+ *   The values having more fraction bits are less than 2^-36 and always round to zero.
+ */
+#define NUMBER_FORMAT_MAX_FRACTION_BITS 60
+
+/**
+ * @brief The powers of ten used for detecting the rounding carry into the integer part.
+ */
+static const uint32_t NumberFormat_PowersOf10[NUMBER_FORMAT_MAX_PRECISION + 1] = {
+  1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/**
+ * @brief Writes the decimal digits of the value in reverse order.
+ * @return The number of digits written.
+ */
+static uint8_t NumberFormat_WriteDigitsReversed(char *buffer, uint64_t value, uint8_t minDigits)
+{
+  uint8_t count = 0;
+  while (value != 0 || count < minDigits)
+  {
+    buffer[count++] = (char) ('0' + value % 10);
+    value /= 10;
+  }
+  return count;
+}
+
+/**
+ * @brief Formats the single-precision value as a fixed-point decimal number, the way the <i>"%.*f"</i> <i>printf</i>
+ *   format does. The binary value is converted exactly using the integer arithmetic and rounded half to even, so the
+ *   result matches the <i>printf</i> one. No heap, locale or floating-point library functions are used.
+ * @param buffer The output buffer of at least <i>NUMBER_FORMAT_MAX_LENGTH</i> characters. The result is
+ *   null-terminated.
+ * @param value The value to format.
+ * @param precision The number of decimal places, up to <i>NUMBER_FORMAT_MAX_PRECISION</i>.
+ * @return The formatted string length.
+ * @note The values with the magnitude of 2^64 and greater are formatted as infinities.
+ */
+uint8_t NumberFormat_Fixed(char *buffer, float value, uint8_t precision)
+{
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+
+  uint8_t length = 0;
+  if (bits >> 31)
+    buffer[length++] = '-';
+
+  int32_t exponent = (int32_t) ((bits >> 23) & 0xFF);
+  uint64_t mantissa = bits & 0x7FFFFF;
+  if (exponent == 0xFF && mantissa != 0)
+    return (uint8_t) (length + strlen(strcpy(&buffer[length], "nan")));
+
+  // Normalizing the value to the mantissa * 2^(-shift) form.
+  if (exponent != 0)
+    mantissa |= 0x800000;
+  else
+    exponent = 1;
+  int32_t shift = 150 - exponent;
+
+  if (shift < -40 || exponent == 0xFF)
+    return (uint8_t) (length + strlen(strcpy(&buffer[length], "inf")));
+
+  if (precision > NUMBER_FORMAT_MAX_PRECISION)
+    precision = NUMBER_FORMAT_MAX_PRECISION;
+
+  uint64_t integer;
+  uint64_t fraction = 0;
+  if (shift <= 0)
+  {
+    integer = mantissa << -shift;
+    shift = 0;
+  }
+  else if (shift > NUMBER_FORMAT_MAX_FRACTION_BITS)
+  {
+    integer = 0;
+    fraction = 0;
+    shift = NUMBER_FORMAT_MAX_FRACTION_BITS;
+  }
+  else
+  {
+    integer = mantissa >> shift;
+    fraction = mantissa & ((1ULL << shift) - 1);
+  }
+
+  // Extracting the decimal places one by one and rounding the rest half to even.
+  uint64_t mask = (1ULL << shift) - 1;
+  uint64_t decimals = 0;
+  for (uint8_t index = 0; index < precision; index++)
+  {
+    fraction *= 10;
+    decimals = decimals * 10 + (fraction >> shift);
+    fraction &= mask;
+  }
+
+  uint64_t half = shift > 0 ? 1ULL << (shift - 1) : 1;
+  if (fraction > half || (fraction == half && ((precision > 0 ? decimals : integer) & 1)))
+    decimals++;
+  if (decimals >= NumberFormat_PowersOf10[precision])
+  {
+    decimals -= NumberFormat_PowersOf10[precision];
+    integer++;
+  }
+
+  char digits[NUMBER_FORMAT_MAX_LENGTH];
+  uint8_t count = 0;
+  if (precision > 0)
+  {
+    count = NumberFormat_WriteDigitsReversed(digits, decimals, precision);
+    digits[count++] = '.';
+  }
+  count += NumberFormat_WriteDigitsReversed(&digits[count], integer, 1);
+
+  while (count > 0)
+    buffer[length++] = digits[--count];
+  buffer[length] = '\0';
+
+  return length;
+}
@@ -0,0 +1,26 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_NUMBER_FORMAT_H
+#define BME_READER_NUMBER_FORMAT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Defines the maximal supported number of decimal places.
+ */
+#define NUMBER_FORMAT_MAX_PRECISION 9
+
+/**
+ * @brief Defines the buffer size sufficient for any formatted number including the terminating null character.
+ */
+#define NUMBER_FORMAT_MAX_LENGTH 32
+
+uint8_t NumberFormat_Fixed(char *buffer, float value, uint8_t precision);
+
+#endif //BME_READER_NUMBER_FORMAT_H
@@ -0,0 +1,316 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+
+#include "oversampling.h"
+#include "project.h"
+
+/**
+ * @brief Defines the number of the oversampling factors from x1 to x16.
+ */
+#define OVERSAMPLING_FACTOR_COUNT 5
+
+/**
+ * @brief Defines the number of the filter coefficients from off to 16.
+ */
+#define OVERSAMPLING_FILTER_COUNT 5
+
+/**
+ * @brief Defines the fraction of the target noise variance the predicted one must not exceed for a new setting to be
+ *   selected, so that the estimation errors do not make the controller switch the settings back and forth.
+ */
+#define OVERSAMPLING_VARIANCE_MARGIN 0.8F
+
+/**
+ * @brief The measurement channels the noise is tracked for.
+ */
+typedef enum Oversampling_Channel
+{
+  OVERSAMPLING_CHANNEL_PRESSURE,
+  OVERSAMPLING_CHANNEL_TEMPERATURE,
+  OVERSAMPLING_CHANNEL_HUMIDITY,
+  OVERSAMPLING_CHANNEL_COUNT
+} Oversampling_Channel;
+
+/**
+ * @brief The number of samples the IIR filter output takes to reach 75% of a step, indexed by the filter coefficient
+ *   register value (the datasheet, section 3.4.4).
+ */
+static const uint8_t Oversampling_FilterResponses[OVERSAMPLING_FILTER_COUNT] = {1, 2, 5, 11, 22};
+
+/**
+ * @brief The target noise variances of the compensated values.
+ */
+static const float Oversampling_TargetVariances[OVERSAMPLING_CHANNEL_COUNT] = {
+  CONFIG_PRESSURE_NOISE_TARGET * CONFIG_PRESSURE_NOISE_TARGET,
+  CONFIG_TEMPERATURE_NOISE_TARGET * CONFIG_TEMPERATURE_NOISE_TARGET,
+  CONFIG_HUMIDITY_NOISE_TARGET * CONFIG_HUMIDITY_NOISE_TARGET
+};
+
+/**
+ * @brief The flag indicating if the adaptive oversampling is enabled.
+ */
+static bool Oversampling_IsControllerEnabled = CONFIG_ADAPTIVE_OVERSAMPLING;
+
+/**
+ * @brief The previous sample values the differences are computed against.
+ */
+static float Oversampling_Previous[OVERSAMPLING_CHANNEL_COUNT];
+
+/**
+ * @brief The number of samples to be skipped until the filter settles after a settings change. The last skipped sample
+ *   becomes the previous one.
+ */
+static uint32_t Oversampling_SettleCount = 0;
+
+/**
+ * @brief The free-running count of the samples tracked by the noise estimation.
+ */
+static uint32_t Oversampling_TrackedCount = 0;
+
+/**
+ * @brief The number of the sample differences accumulated in the current window.
+ */
+static uint32_t Oversampling_Count = 0;
+
+/**
+ * @brief The sums of the squared sample differences accumulated in the current window.
+ */
+static float Oversampling_SumSquares[OVERSAMPLING_CHANNEL_COUNT];
+
+/**
+ * @brief The noise variances estimated in the last window.
+ */
+static float Oversampling_Variances[OVERSAMPLING_CHANNEL_COUNT];
+
+/**
+ * @brief Converts the oversampling register value to the number of the averaged ADC samples.
+ */
+static uint32_t Oversampling_GetSampleCount(uint8_t oversampling)
+{
+  return oversampling >= OVERSAMPLING_FACTOR_COUNT ? 1U << (OVERSAMPLING_FACTOR_COUNT - 1) : 1U << (oversampling - 1);
+}
+
+/**
+ * @brief Gets the factor the IIR filter reduces the white noise variance of the channel by: <i>2 * c - 1</i> for the
+ *   filter coefficient <i>c</i>. The humidity channel is not filtered.
+ */
+static uint32_t Oversampling_GetFilterGain(Oversampling_Channel channel, uint8_t filter)
+{
+  return channel == OVERSAMPLING_CHANNEL_HUMIDITY ? 1 : (2U << filter) - 1;
+}
+
+/**
+ * @brief Gets the oversampling register values of the configuration indexed by the channel.
+ */
+static void Oversampling_GetFactors(const BME280_Config *config, uint8_t *factors)
+{
+  factors[OVERSAMPLING_CHANNEL_PRESSURE] = config->pressureOversampling;
+  factors[OVERSAMPLING_CHANNEL_TEMPERATURE] = config->temperatureOversampling;
+  factors[OVERSAMPLING_CHANNEL_HUMIDITY] = config->humidityOversampling;
+}
+
+/**
+ * @brief Sets the oversampling register values of the configuration indexed by the channel.
+ */
+static void Oversampling_SetFactors(BME280_Config *config, const uint8_t *factors)
+{
+  config->pressureOversampling = factors[OVERSAMPLING_CHANNEL_PRESSURE];
+  config->temperatureOversampling = factors[OVERSAMPLING_CHANNEL_TEMPERATURE];
+  config->humidityOversampling = factors[OVERSAMPLING_CHANNEL_HUMIDITY];
+}
+
+/**
+ * @brief Checks if the filter is off or its response time does not exceed the <i>CONFIG_MAX_FILTER_RESPONSE_TIME</i>
+ *   value.
+ * @param config A pointer to the configuration to check.
+ * @param interval The sampling interval in milliseconds. The measurements cannot follow more often than the
+ *   measurement time allows.
+ */
+static bool Oversampling_IsResponseAllowed(const BME280_Config *config, uint32_t interval)
+{
+  uint32_t measurementTime = (BME280_GetMeasurementTime(config, false) + 999) / 1000;
+  interval = interval > measurementTime ? interval : measurementTime;
+  return config->filter == BME280_FILTER_OFF ||
+    Oversampling_FilterResponses[config->filter] * interval <= CONFIG_MAX_FILTER_RESPONSE_TIME;
+}
+
+/**
+ * @brief Finds the configuration with the shortest measurement time predicted to meet the target noise.
+ * @param config A pointer to the current configuration that will be replaced with the found one.
+ * @param interval The sampling interval in milliseconds.
+ * @param singleVariances The noise variances of a single ADC sample without filtering estimated for each channel.
+ * @return The measurement time of the found configuration in microseconds.
+ */
+static uint32_t Oversampling_FindCheapest(BME280_Config *config, uint32_t interval, const float *singleVariances)
+{
+  uint8_t currentFactors[OVERSAMPLING_CHANNEL_COUNT];
+  Oversampling_GetFactors(config, &currentFactors[0]);
+
+  BME280_Config best = *config;
+  uint32_t bestTime = UINT32_MAX;
+  for (uint8_t filter = 0; filter < OVERSAMPLING_FILTER_COUNT; filter++)
+  {
+    uint8_t factors[OVERSAMPLING_CHANNEL_COUNT];
+    for (uint8_t channel = 0; channel < OVERSAMPLING_CHANNEL_COUNT; channel++)
+    {
+      // The skipped channels are left skipped.
+      factors[channel] = currentFactors[channel];
+      if (factors[channel] == 0)
+        continue;
+
+      float reduction = (float) Oversampling_GetFilterGain(channel, filter) * OVERSAMPLING_VARIANCE_MARGIN *
+        Oversampling_TargetVariances[channel];
+      for (factors[channel] = 1; factors[channel] < OVERSAMPLING_FACTOR_COUNT; factors[channel]++)
+      {
+        if (singleVariances[channel] <= (float) Oversampling_GetSampleCount(factors[channel]) * reduction)
+          break;
+      }
+    }
+
+    BME280_Config candidate = *config;
+    candidate.filter = filter;
+    Oversampling_SetFactors(&candidate, &factors[0]);
+    uint32_t time = BME280_GetMeasurementTime(&candidate, false);
+    if (time < bestTime && Oversampling_IsResponseAllowed(&candidate, interval))
+    {
+      best = candidate;
+      bestTime = time;
+    }
+  }
+
+  *config = best;
+  return bestTime;
+}
+
+/**
+ * @brief Enables or disables the adaptive oversampling. The current sensor configuration is kept when disabled.
+ * @param isEnabled The flag indicating if the adaptive oversampling has to be enabled.
+ */
+void Oversampling_SetEnabled(bool isEnabled)
+{
+  Oversampling_IsControllerEnabled = isEnabled;
+  Oversampling_Restart();
+}
+
+/**
+ * @brief Checks if the adaptive oversampling is enabled.
+ */
+bool Oversampling_IsEnabled()
+{
+  return Oversampling_IsControllerEnabled;
+}
+
+/**
+ * @brief Restarts the noise estimation, e.g. after the sensor configuration has been changed.
+ */
+void Oversampling_Restart()
+{
+  uint8_t filter = Project_Bme280Config.filter;
+  Oversampling_SettleCount = Oversampling_FilterResponses[filter < OVERSAMPLING_FILTER_COUNT ? filter : 0];
+  Oversampling_Count = 0;
+  memset(Oversampling_SumSquares, 0, sizeof(Oversampling_SumSquares));
+}
+
+/**
+ * @brief Tracks the noise of the sample values and selects the oversampling factors and the filter coefficient with
+ *   the shortest measurement time meeting the target noise.
+ * @param rawData A pointer to the uncompensated sample data.
+ * @param interval The current sampling interval in milliseconds limiting the filter response time.
+ * @return <i>true</i> if the <i>Project_Bme280Config</i> configuration has been changed and has to be applied to the
+ *   sensor, otherwise <i>false</i>.
+ * @remarks The noise variance is estimated from the differences of the successive compensated values, so the slow
+ *   changes of the measured values do not contribute to it, and corrected for the filter, as its output values are
+ *   correlated. It is then scaled to the other settings assuming the oversampling and the filter reduce the white noise
+ *   variance by <i>N</i> and <i>2 * c - 1</i> times. The current settings are kept while they meet the target noise,
+ *   unless cheaper ones are predicted to meet it with a margin.
+ */
+bool Oversampling_Put(const BME280_RawData *rawData, uint32_t interval)
+{
+  if (!Oversampling_IsControllerEnabled)
+    return false;
+
+  Oversampling_TrackedCount++;
+  BME280_Measurement measurement;
+  BME280_Compensate(&Project_TrimmingParams, rawData, BME280_CHANNEL_ALL, &measurement);
+  float values[OVERSAMPLING_CHANNEL_COUNT] = {measurement.pressure, measurement.temperature, measurement.humidity};
+
+  if (Oversampling_SettleCount > 0)
+  {
+    Oversampling_SettleCount--;
+    memcpy(Oversampling_Previous, values, sizeof(values));
+    return false;
+  }
+
+  for (uint8_t channel = 0; channel < OVERSAMPLING_CHANNEL_COUNT; channel++)
+  {
+    float difference = values[channel] - Oversampling_Previous[channel];
+    Oversampling_SumSquares[channel] += difference * difference;
+    Oversampling_Previous[channel] = values[channel];
+  }
+  if (++Oversampling_Count < CONFIG_NOISE_WINDOW_LENGTH)
+    return false;
+
+  BME280_Config config = Project_Bme280Config;
+  uint8_t factors[OVERSAMPLING_CHANNEL_COUNT];
+  Oversampling_GetFactors(&config, &factors[0]);
+
+  // The filtered values differences variance is 2 / c times the values variance for the filter coefficient c.
+  bool isMeetingTarget = true;
+  float singleVariances[OVERSAMPLING_CHANNEL_COUNT] = {0};
+  for (uint8_t channel = 0; channel < OVERSAMPLING_CHANNEL_COUNT; channel++)
+  {
+    uint32_t coefficient = channel == OVERSAMPLING_CHANNEL_HUMIDITY ? 1 : 1U << config.filter;
+    float variance = Oversampling_SumSquares[channel] * (float) coefficient / (float) (2 * Oversampling_Count);
+    Oversampling_Variances[channel] = variance;
+    if (factors[channel] == 0)
+      continue;
+
+    singleVariances[channel] = variance * (float) Oversampling_GetSampleCount(factors[channel]) *
+      (float) Oversampling_GetFilterGain(channel, config.filter);
+    isMeetingTarget = isMeetingTarget && variance <= Oversampling_TargetVariances[channel];
+  }
+
+  Oversampling_Count = 0;
+  memset(Oversampling_SumSquares, 0, sizeof(Oversampling_SumSquares));
+
+  uint32_t currentTime = BME280_GetMeasurementTime(&config, false);
+  if (Oversampling_FindCheapest(&config, interval, &singleVariances[0]) >= currentTime && isMeetingTarget &&
+    Oversampling_IsResponseAllowed(&Project_Bme280Config, interval))
+    return false;
+
+  if (config.filter == Project_Bme280Config.filter &&
+    config.pressureOversampling == Project_Bme280Config.pressureOversampling &&
+    config.temperatureOversampling == Project_Bme280Config.temperatureOversampling &&
+    config.humidityOversampling == Project_Bme280Config.humidityOversampling)
+    return false;
+
+  Project_Bme280Config = config;
+  Oversampling_Restart();
+  return true;
+}
+
+/**
+ * @brief Gets the noise variances of the compensated values estimated in the last window.
+ * @param variance A pointer to the structure that will be filled with the variances in the measurement units squared.
+ */
+void Oversampling_GetVariance(BME280_Measurement *variance)
+{
+  variance->pressure = Oversampling_Variances[OVERSAMPLING_CHANNEL_PRESSURE];
+  variance->temperature = Oversampling_Variances[OVERSAMPLING_CHANNEL_TEMPERATURE];
+  variance->humidity = Oversampling_Variances[OVERSAMPLING_CHANNEL_HUMIDITY];
+}
+
+/**
+ * @brief Gets the free-running count of the samples tracked by the noise estimation while it is enabled.
+ */
+uint32_t Oversampling_GetTrackedCount()
+{
+  return Oversampling_TrackedCount;
+}
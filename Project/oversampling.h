@@ -0,0 +1,30 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_OVERSAMPLING_H
+#define BME_READER_OVERSAMPLING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "bme280.h"
+
+void Oversampling_SetEnabled(bool isEnabled);
+
+bool Oversampling_IsEnabled();
+
+void Oversampling_Restart();
+
+bool Oversampling_Put(const BME280_RawData *rawData, uint32_t interval);
+
+void Oversampling_GetVariance(BME280_Measurement *variance);
+
+uint32_t Oversampling_GetTrackedCount();
+
+#endif //BME_READER_OVERSAMPLING_H
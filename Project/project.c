@@ -6,6 +6,9 @@
  * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
  */
 
+#include <stdarg.h>
+#include <stdio.h>
+
 #include "project.h"
 
 /**
@@ -18,6 +21,32 @@
  */
 #define PROJECT_BOOTLOADER_KEY 0x12345678
 
+/**
+ * @brief Defines the maximal length of a binary response frame before encoding.
+ */
+#define PROJECT_MAX_RESPONSE_FRAME_LENGTH (FRAME_HEADER_LENGTH + CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + FRAME_CRC_LENGTH)
+
+/**
+ * @brief Defines the maximal length of a response in any of the command formats.
+ */
+#define PROJECT_MAX_RESPONSE_LENGTH FRAME_ENCODED_LENGTH(PROJECT_MAX_RESPONSE_FRAME_LENGTH)
+
+/**
+ * @brief Defines the maximal number of the history samples compensated in a batch.
+ */
+#define PROJECT_HISTORY_BATCH_LENGTH 16
+
+/**
+ * @brief Defines the length of the stored sensor settings: the mode, the filter, the pressure, temperature, and
+ *   humidity oversampling, the standby time register values, and the adaptive oversampling flag.
+ */
+#define PROJECT_SENSOR_SETTINGS_LENGTH 7
+
+/**
+ * @brief Defines the maximal time in milliseconds the BME280 sensor copies its NVM data after a reset for.
+ */
+#define PROJECT_BME280_STARTUP_TIMEOUT 10
+
 /**
  * @brief The simple action callback definition.
  */
@@ -28,11 +57,92 @@ typedef void (*Project_Action)();
  */
 BME280_TrimmingParams Project_TrimmingParams;
 
+/**
+ * @brief Stores the BME280 sensor configuration. In the forced mode the sensor is left sleeping, and its oversampling
+ *   factors are applied to every triggered measurement.
+ */
+BME280_Config Project_Bme280Config = {
+  .mode = CONFIG_MODE,
+  .filter = CONFIG_FILTER_FACTOR,
+  .pressureOversampling = CONFIG_PRESSURE_OVERSAMPLING_FACTOR,
+  .temperatureOversampling = CONFIG_TEMPERATURE_OVERSAMPLING_FACTOR,
+  .humidityOversampling = CONFIG_HUMIDITY_OVERSAMPLING_FACTOR,
+  .standbyTime = CONFIG_STANDBY_TIME,
+  .useSPI3WireMode = false
+};
+
+/**
+ * @brief Stores the BME280 sensor configuration set by the user: the defaults, the saved one, or the one set by the
+ *   <i>Config</i> command. Only this one is saved, as the adaptive oversampling and the streaming change the
+ *   <i>Project_Bme280Config</i> one at runtime.
+ */
+BME280_Config Project_Bme280UserConfig = {
+  .mode = CONFIG_MODE,
+  .filter = CONFIG_FILTER_FACTOR,
+  .pressureOversampling = CONFIG_PRESSURE_OVERSAMPLING_FACTOR,
+  .temperatureOversampling = CONFIG_TEMPERATURE_OVERSAMPLING_FACTOR,
+  .humidityOversampling = CONFIG_HUMIDITY_OVERSAMPLING_FACTOR,
+  .standbyTime = CONFIG_STANDBY_TIME,
+  .useSPI3WireMode = false
+};
+
+/**
+ * @brief The flag indicating if the BME280 sensor has been initialized successfully. If not, the initialization is
+ *   repeated when the sensor responds.
+ */
+bool Project_IsBme280Initialized = false;
+
+/**
+ * @brief Stores the BME280 raw calibration data block the trimming parameters are decoded from.
+ */
+uint8_t Project_TrimmingData[BME280_TRIMMING_DATA_LENGTH];
+
+/**
+ * @brief The BME280 sensor initialization steps following the device reset.
+ */
+typedef enum Project_InitStep
+{
+  /**
+   * @brief Waiting for the device to copy its NVM data.
+   */
+  PROJECT_INIT_STEP_LOADING,
+
+  /**
+   * @brief Waiting for the first normal mode measurement.
+   */
+  PROJECT_INIT_STEP_CONVERTING
+} Project_InitStep;
+
+/**
+ * @brief The current BME280 sensor initialization step.
+ */
+static Project_InitStep Project_CurrentInitStep = PROJECT_INIT_STEP_LOADING;
+
+/**
+ * @brief The system tick value when the current BME280 sensor initialization step has been started.
+ */
+static uint32_t Project_InitTick = 0;
+
+/**
+ * @brief The chip identifier read from the BME280 sensor being initialized.
+ */
+static uint8_t Project_Bme280Id = 0;
+
 /**
  * @brief The flag indicating if a software reset has been requested.
  */
 static bool Project_IsResetRequested = false;
 
+/**
+ * @brief The format of the command messages and responses currently in use.
+ */
+static Command_Format Project_CommandFormat = COMMAND_FORMAT_TEXT;
+
+/**
+ * @brief The flag indicating if the command being processed has been deferred.
+ */
+static bool Project_IsCommandDeferred = false;
+
 /**
  * @brief Requests a software reset of the MCU.
  * @param jumpToBootloader The flag indicating if it is necessary to jump to the MCU bootloader after performing a
@@ -64,7 +174,8 @@ void Project_JumpToBootloaderIfRequested()
 
   // Setting the bootloader stack pointer and jumping to the bootloader entry point.
   uint32_t bootloaderStackPointer = *((uint32_t *) PROJECT_BOOTLOADER_START_ADDRESS);
-  Project_Action bootloaderEntryPoint = (Project_Action) *((uint32_t *) (PROJECT_BOOTLOADER_START_ADDRESS + 4));
+  Project_Action bootloaderEntryPoint =
+    (Project_Action) (uintptr_t) *((uint32_t *) (PROJECT_BOOTLOADER_START_ADDRESS + 4));
   __set_MSP(bootloaderStackPointer);
   bootloaderEntryPoint();
 }
@@ -140,45 +251,192 @@ void Project_PreInit()
 }
 
 /**
- * @brief Initializes the BME280 sensor.
- * @return <i>true</i> on successful device initialization, otherwise <i>false</i>.
+ * @brief Gets the BME280 calibration data block to <i>Project_TrimmingData</i>. The block cached in the persistent
+ *   store is used if the chip identifier and the block signature read from the device match it, otherwise the whole
+ *   block is read from the device and cached.
+ * @param id The chip identifier read from the device.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
  */
-bool Project_Bme280Init()
+static I2C_Result Project_GetTrimmingData(uint8_t id)
 {
-  BME280_Config config = {
-    .mode = BME280_MODE_NORMAL,
-    .filter = CONFIG_FILTER_FACTOR,
-    .pressureOversampling = CONFIG_PRESSURE_OVERSAMPLING_FACTOR,
-    .temperatureOversampling = CONFIG_TEMPERATURE_OVERSAMPLING_FACTOR,
-    .humidityOversampling = CONFIG_HUMIDITY_OVERSAMPLING_FACTOR,
-    .standbyTime = CONFIG_STANDBY_TIME,
-    .useSPI3WireMode = false
-  };
+  uint8_t cache[1 + BME280_TRIMMING_DATA_LENGTH];
+  uint8_t signature[BME280_TRIMMING_SIGNATURE_LENGTH];
+  I2C_Result result = BME280_GetTrimmingSignature(I2C1, &signature[0]);
+  if (result != I2C_RESULT_OK)
+    return result;
+
+  if (Store_Get(STORE_KEY_CALIBRATION, &cache[0], sizeof(cache)) && cache[0] == id &&
+    memcmp(&cache[1], &signature[0], sizeof(signature)) == 0)
+  {
+    memcpy(&Project_TrimmingData[0], &cache[1], BME280_TRIMMING_DATA_LENGTH);
+    return I2C_RESULT_OK;
+  }
+
+  result = BME280_GetTrimmingData(I2C1, &Project_TrimmingData[0]);
+  if (result != I2C_RESULT_OK)
+    return result;
 
+  // A failed write only makes the next initialization read the block again.
+  cache[0] = id;
+  memcpy(&cache[1], &Project_TrimmingData[0], BME280_TRIMMING_DATA_LENGTH);
+  Store_Put(STORE_KEY_CALIBRATION, &cache[0], sizeof(cache));
+  return I2C_RESULT_OK;
+}
+
+/**
+ * @brief Starts the BME280 sensor initialization: checks the chip identifier and resets the device. The following
+ *   steps are completed by the <i>Project_ContinueBme280Init</i> function as soon as the device is ready for them.
+ * @return The initialization status. See the <i>Project_InitStatus</i> enumeration.
+ */
+Project_InitStatus Project_StartBme280Init()
+{
+  BME280_compensation = CONFIG_COMPENSATION;
+  Project_IsBme280Initialized = false;
   Project_RecoverI2cState();
 
-  uint8_t id;
-  if (BME280_GetID(I2C1, &id) != I2C_RESULT_OK || id != 0x60 || BME280_Reset(I2C1) != I2C_RESULT_OK)
-    return false;
+  if (BME280_GetID(I2C1, &Project_Bme280Id) != I2C_RESULT_OK || Project_Bme280Id != 0x60 ||
+    BME280_Reset(I2C1) != I2C_RESULT_OK)
+    return PROJECT_INIT_FAILED;
 
-  uint16_t attempts = 100;
-  BME280_Status status;
-  do
+  Project_CurrentInitStep = PROJECT_INIT_STEP_LOADING;
+  Project_InitTick = HAL_GetTick();
+  return PROJECT_INIT_IN_PROGRESS;
+}
+
+/**
+ * @brief Continues the BME280 sensor initialization started by the <i>Project_StartBme280Init</i> function without
+ *   blocking: waits for the device to copy its NVM data after the reset, loads the calibration data and sets the
+ *   configuration, and in the normal mode waits for the first measurement, polling the temperature data from the
+ *   typical measurement time on until it leaves its reset value.
+ * @return The initialization status. See the <i>Project_InitStatus</i> enumeration. The function must be called
+ *   repeatedly while the initialization is in progress.
+ */
+Project_InitStatus Project_ContinueBme280Init()
+{
+  uint32_t elapsed = HAL_GetTick() - Project_InitTick;
+  BME280_Config config = Project_Bme280Config;
+  if (config.mode != BME280_MODE_NORMAL)
+    config.mode = BME280_MODE_SLEEP;
+
+  if (Project_CurrentInitStep == PROJECT_INIT_STEP_LOADING)
   {
+    BME280_Status status;
     if (BME280_GetStatus(I2C1, &status) != I2C_RESULT_OK)
-      return false;
+      return PROJECT_INIT_FAILED;
+    if (status.isMemoryUpdating)
+      return elapsed < PROJECT_BME280_STARTUP_TIMEOUT ? PROJECT_INIT_IN_PROGRESS : PROJECT_INIT_FAILED;
+
+    if (Project_GetTrimmingData(Project_Bme280Id) != I2C_RESULT_OK)
+      return PROJECT_INIT_FAILED;
+
+    BME280_ParseTrimmingParams(&Project_TrimmingData[0], &Project_TrimmingParams);
+    if (BME280_SetConfig(I2C1, &config) != I2C_RESULT_OK)
+      return PROJECT_INIT_FAILED;
+
+    // In the forced mode the measurements are started by the sampler.
+    if (config.mode == BME280_MODE_NORMAL)
+    {
+      Project_CurrentInitStep = PROJECT_INIT_STEP_CONVERTING;
+      Project_InitTick = HAL_GetTick();
+      return PROJECT_INIT_IN_PROGRESS;
+    }
   }
-  while (status.isMemoryUpdating && --attempts);
-  if (!attempts)
-    return false;
+  else
+  {
+    if (elapsed < BME280_GetMeasurementTime(&config, false) / 1000)
+      return PROJECT_INIT_IN_PROGRESS;
+
+    BME280_RawData rawData;
+    if (BME280_GetRawData(I2C1, BME280_CHANNEL_TEMPERATURE, &rawData) != I2C_RESULT_OK)
+      return PROJECT_INIT_FAILED;
+    if (rawData.temperature == BME280_RAW_DATA_RESET_VALUE)
+      return elapsed <= (BME280_GetMeasurementTime(&config, true) + 999) / 1000 ? PROJECT_INIT_IN_PROGRESS :
+        PROJECT_INIT_FAILED;
+  }
+
+  Project_IsBme280Initialized = true;
+  return PROJECT_INIT_SUCCEEDED;
+}
+
+/**
+ * @brief Initializes the I2C interrupts and the DMA stream serving the I2C reception (DMA1 stream 0, channel 1).
+ */
+void Project_I2cInit()
+{
+  LL_AHB1_GRP1_EnableClock(LL_AHB1_GRP1_PERIPH_DMA1);
+  LL_DMA_SetChannelSelection(DMA1, LL_DMA_STREAM_0, LL_DMA_CHANNEL_1);
+  LL_DMA_ConfigTransfer(DMA1, LL_DMA_STREAM_0, LL_DMA_DIRECTION_PERIPH_TO_MEMORY | LL_DMA_MODE_NORMAL |
+    LL_DMA_PERIPH_NOINCREMENT | LL_DMA_MEMORY_INCREMENT | LL_DMA_PDATAALIGN_BYTE | LL_DMA_MDATAALIGN_BYTE |
+    LL_DMA_PRIORITY_HIGH);
+  LL_DMA_SetPeriphAddress(DMA1, LL_DMA_STREAM_0, LL_I2C_DMA_GetRegAddr(I2C1));
+  LL_DMA_EnableIT_TC(DMA1, LL_DMA_STREAM_0);
+  LL_DMA_EnableIT_TE(DMA1, LL_DMA_STREAM_0);
+  I2C_SetRxDma(I2C1, DMA1, LL_DMA_STREAM_0);
+
+  // Enabling the interrupts with the highest priority, as the data reception relies on the events being serviced
+  // within a single byte time.
+  NVIC_SetPriority(I2C1_EV_IRQn, 0);
+  NVIC_EnableIRQ(I2C1_EV_IRQn);
+  NVIC_SetPriority(I2C1_ER_IRQn, 0);
+  NVIC_EnableIRQ(I2C1_ER_IRQn);
+  NVIC_SetPriority(DMA1_Stream0_IRQn, 0);
+  NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+}
+
+/**
+ * @brief Saves the sensor configuration set by the user, the adaptive oversampling flag, and the background sampling
+ *   period to the persistent store, so that they are restored on the following boots. The factors selected by the
+ *   adaptive oversampling are never saved.
+ * @return <i>true</i> if the settings have been saved, otherwise <i>false</i>.
+ */
+bool Project_SaveSettings()
+{
+  uint8_t settings[PROJECT_SENSOR_SETTINGS_LENGTH] = {
+    Project_Bme280UserConfig.mode,
+    Project_Bme280UserConfig.filter,
+    Project_Bme280UserConfig.pressureOversampling,
+    Project_Bme280UserConfig.temperatureOversampling,
+    Project_Bme280UserConfig.humidityOversampling,
+    Project_Bme280UserConfig.standbyTime,
+    Oversampling_IsEnabled()
+  };
+  uint8_t period[4];
+  Frame_PutUint32(period, Sampler_GetDefaultPeriod());
 
-  if (BME280_GetTrimmingParams(I2C1, &Project_TrimmingParams) != I2C_RESULT_OK ||
-    BME280_SetConfig(I2C1, &config) != I2C_RESULT_OK)
-    return false;
+  return Store_Put(STORE_KEY_SENSOR_CONFIG, settings, sizeof(settings)) &&
+    Store_Put(STORE_KEY_SAMPLING_PERIOD, period, sizeof(period));
+}
 
-  LL_mDelay(100);
+/**
+ * @brief Restores the settings saved by the <i>Project_SaveSettings</i> function. The defaults are kept for the
+ *   settings not stored or invalid.
+ */
+static void Project_LoadSettings()
+{
+  uint8_t settings[PROJECT_SENSOR_SETTINGS_LENGTH];
+  if (Store_Get(STORE_KEY_SENSOR_CONFIG, settings, sizeof(settings)) &&
+    (settings[0] == BME280_MODE_NORMAL || settings[0] == BME280_MODE_FORCED) && settings[1] <= BME280_FILTER_16 &&
+    settings[2] <= BME280_PRESSURE_OVERSAMPLING_16 && settings[3] >= BME280_TEMPERATURE_OVERSAMPLING_1 &&
+    settings[3] <= BME280_TEMPERATURE_OVERSAMPLING_16 && settings[4] <= BME280_HUMIDITY_OVERSAMPLING_16 &&
+    settings[5] <= BME280_STANDBY_TIME_20ms)
+  {
+    Project_Bme280UserConfig.mode = settings[0];
+    Project_Bme280UserConfig.filter = settings[1];
+    Project_Bme280UserConfig.pressureOversampling = settings[2];
+    Project_Bme280UserConfig.temperatureOversampling = settings[3];
+    Project_Bme280UserConfig.humidityOversampling = settings[4];
+    Project_Bme280UserConfig.standbyTime = settings[5];
+    Project_Bme280Config = Project_Bme280UserConfig;
+    Oversampling_SetEnabled(settings[6] != 0);
+  }
 
-  return true;
+  uint8_t period[4];
+  if (Store_Get(STORE_KEY_SAMPLING_PERIOD, period, sizeof(period)) &&
+    Frame_GetUint32(period) >= SAMPLER_MIN_PERIOD && Frame_GetUint32(period) <= SAMPLER_MAX_PERIOD)
+  {
+    Sampler_SetDefaultPeriod(Frame_GetUint32(period));
+    Sampler_SetPeriod(Sampler_GetDefaultPeriod());
+  }
 }
 
 /**
@@ -186,60 +444,289 @@ bool Project_Bme280Init()
  */
 void Project_PostInit()
 {
-  Project_Bme280Init();
+  Store_Init();
+  Project_LoadSettings();
+  Project_I2cInit();
+  Sampler_InitSensor();
   Project_SetLedState(false);
 }
 
 /**
- * @brief Sends a message over USB CDC interface.
+ * @brief Queues a message for transmission over USB CDC interface.
  * @param string A pointer to the string containing the message to be sent.
  * @param length Length of the message in the string.
- * @return <i>true</i> if the message has been sent successfully, otherwise <i>false</i>.
+ * @return <i>true</i> if the message has been queued successfully, otherwise <i>false</i>.
  */
 inline bool Project_SendCdcMessage(const char *string, uint16_t length)
 {
-  return CDC_Transmit_FS((uint8_t *) string, length) == USBD_OK;
+  return TransmitQueue_Put(string, length);
 }
 
 /**
- * @brief Processes the provided command message.
- * @param command A pointer to the string containing the command message to process.
+ * @brief Switches the protocol between the text and binary framed modes for the following command messages.
+ * @param format The command format to use.
  */
-static void Project_ProcessCommand(const char *command)
+void Project_SetCommandFormat(Command_Format format)
 {
-  char response[CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + 1];
-  Command_ProcessMessage(command, &response[0]);
-  Project_SendCdcMessage(&response[0], strlen(response));
+  Project_CommandFormat = format;
+  CommandQueue_SetDelimiter(format == COMMAND_FORMAT_BINARY ? FRAME_DELIMITER : 0x0A);
 }
 
 /**
- * @brief The callback to be processed on USB CDC message reception.
- * @param string A pointer to the string containing the received message.
- * @param length Length of the message in the string.
+ * @brief Appends the CRC to the binary frame, encodes and sends it.
+ * @param data The frame header followed by the frame payload. Must have room for the CRC.
+ * @param length The frame header and payload length.
  */
-void Project_CdcMessageReceived(const char *string, uint16_t length)
+static void Project_SendFrame(uint8_t *data, uint16_t length)
 {
-  if (Project_IsResetRequested)
+  uint8_t frame[PROJECT_MAX_RESPONSE_LENGTH];
+  uint16_t crc = Frame_GetCrc(data, length);
+  data[length++] = (uint8_t) crc;
+  data[length++] = (uint8_t) (crc >> 8);
+
+  Project_SendCdcMessage((const char *) frame, Frame_Encode(data, length, frame));
+}
+
+/**
+ * @brief Processes the binary command frame. The decoded frame consists of the command identifier byte, the sequence
+ *   number byte, the optional parameter payload, and the CRC of the preceding bytes. The response frame repeats the
+ *   command identifier and sequence number, followed by the command response and the CRC.
+ * @param command A pointer to the string containing the COBS encoded frame without the delimiter.
+ */
+static void Project_ProcessFrame(const char *command)
+{
+  uint8_t request[CONFIG_MAX_COMMAND_MESSAGE_LENGTH];
+  uint8_t response[PROJECT_MAX_RESPONSE_FRAME_LENGTH + 1];
+  uint16_t length = (uint16_t) strlen(command);
+  uint16_t responseLength;
+
+  // Skipping the empty frames, as the delimiters may be repeated for the synchronization.
+  if (length == 0)
     return;
 
-  static char commandBuffer[CONFIG_MAX_COMMAND_MESSAGE_LENGTH + 1];
-  static int16_t commandBufferIndex = 0;
+  if (!Frame_Decode((const uint8_t *) command, length, request, &length) ||
+    length < FRAME_HEADER_LENGTH + FRAME_CRC_LENGTH ||
+    Frame_GetCrc(request, length - FRAME_CRC_LENGTH) != (request[length - 2] | request[length - 1] << 8))
+  {
+    response[0] = 0xFF;
+    response[1] = 0x00;
+    response[FRAME_HEADER_LENGTH] = COMMAND_STATUS_ERROR;
+    responseLength = 1 + (uint16_t) strlen(strcpy((char *) &response[FRAME_HEADER_LENGTH + 1], "Invalid frame."));
+  }
+  else
+  {
+    const char *name = Command_GetName((Command_Id) request[0]);
+    Command_Descriptor descriptor = {
+      .id = request[0] < COMMAND_ID_COUNT ? (Command_Id) request[0] : COMMAND_ID_COUNT,
+      .format = COMMAND_FORMAT_BINARY,
+      .name = {name != NULL ? name : "", name != NULL ? (uint16_t) strlen(name) : 0},
+      .param = {(const char *) &request[FRAME_HEADER_LENGTH], length - FRAME_HEADER_LENGTH - FRAME_CRC_LENGTH},
+      .value = {"", 0}
+    };
+
+    response[0] = request[0];
+    response[1] = request[1];
+    responseLength = Command_Dispatch(&descriptor, (char *) &response[FRAME_HEADER_LENGTH]);
+    if (Project_IsCommandDeferred)
+      return;
+  }
 
-  Project_SetLedState(true);
+  Project_SendFrame(response, FRAME_HEADER_LENGTH + responseLength);
+}
+
+/**
+ * @brief Appends the formatted text to the message, truncating it to the message buffer size.
+ * @param message The message buffer.
+ * @param size The message buffer size including the terminating zero.
+ * @param length The current message length, less than the buffer size.
+ * @param format The format string.
+ * @return The new message length, less than the buffer size.
+ */
+__attribute__((format(printf, 4, 5)))
+static int Project_AppendMessage(char *message, size_t size, int length, const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int appended = vsnprintf(&message[length], size - (size_t) length, format, args);
+  va_end(args);
 
-  for (uint16_t index = 0; index < length; index++)
+  length += appended > 0 ? appended : 0;
+  return length < (int) size ? length : (int) size - 1;
+}
+
+/**
+ * @brief Formats the measurement values for the text messages in the units of the <i>Measure</i> command, terminating
+ *   the message with a LF symbol.
+ * @param message The message buffer.
+ * @param size The message buffer size including the terminating zero.
+ * @param length The current message length the values are appended at.
+ * @param measurement A pointer to the measurement to format.
+ * @return The new message length, truncated to the buffer size.
+ */
+static int Project_FormatMeasurement(char *message, size_t size, int length, const BME280_Measurement *measurement)
+{
+  char pressure[NUMBER_FORMAT_MAX_LENGTH];
+  char temperature[NUMBER_FORMAT_MAX_LENGTH];
+  char humidity[NUMBER_FORMAT_MAX_LENGTH];
+
+  // Converting Pa to mmHg.
+  NumberFormat_Fixed(pressure, measurement->pressure * 0.007500617F, CONFIG_MEASUREMENT_PRECISION);
+  NumberFormat_Fixed(temperature, measurement->temperature, CONFIG_MEASUREMENT_PRECISION);
+  NumberFormat_Fixed(humidity, measurement->humidity, CONFIG_MEASUREMENT_PRECISION);
+  return Project_AppendMessage(message, size, length, "P = %s mmHg; T = %s degC; H = %s %%\n", pressure, temperature,
+    humidity);
+}
+
+/**
+ * @brief Sends the streamed samples while there is enough room for them in the transmission buffer. The text samples
+ *   are sent as the <i>DATA</i> messages, and the binary ones as the frames with the <i>Stream</i> command identifier,
+ *   the lowest byte of the streamed sample number, the status byte, the timestamp, and the packed measurement. In the
+ *   raw streaming mode the samples are sent uncompensated as the <i>RAW</i> messages or the frames with the <i>Raw</i>
+ *   command identifier, so no floating-point computations are performed per sample.
+ */
+static void Project_SendStreamSamples()
+{
+  const Stream_Sample *streamSample;
+  bool isRaw = Stream_IsRaw();
+  while (TransmitQueue_GetFreeSpace() >= PROJECT_MAX_RESPONSE_LENGTH && (streamSample = Stream_Peek()) != NULL)
   {
-    if (string[index] == 0x0A)
+    const Sampler_Sample *sample = &streamSample->sample;
+    bool isOk = sample->status == SAMPLER_STATUS_OK;
+    BME280_Measurement measurement;
+    if (isOk && !isRaw)
+      BME280_Compensate(&Project_TrimmingParams, &sample->rawData, BME280_CHANNEL_ALL, &measurement);
+
+    if (Project_CommandFormat == COMMAND_FORMAT_BINARY)
     {
-      commandBuffer[commandBufferIndex] = 0x00;
-      commandBufferIndex = 0;
-      Project_ProcessCommand(&commandBuffer[0]);
+      uint8_t data[PROJECT_MAX_RESPONSE_FRAME_LENGTH];
+      data[0] = isRaw ? COMMAND_ID_RAW : COMMAND_ID_STREAM;
+      data[1] = (uint8_t) streamSample->sequence;
+      data[FRAME_HEADER_LENGTH] = isOk ? COMMAND_STATUS_OK : COMMAND_STATUS_ERROR;
+      Frame_PutUint32(&data[FRAME_HEADER_LENGTH + 1], sample->timestamp);
+      if (isOk && isRaw)
+        Frame_PutRawData(&data[FRAME_HEADER_LENGTH + 5], &sample->rawData);
+      else if (isOk)
+        Frame_PutMeasurement(&data[FRAME_HEADER_LENGTH + 5], &measurement);
+      Project_SendFrame(data, FRAME_HEADER_LENGTH + 5 +
+        (!isOk ? 0 : isRaw ? FRAME_RAW_DATA_LENGTH : FRAME_MEASUREMENT_LENGTH));
     }
-    else if (commandBufferIndex <= CONFIG_MAX_COMMAND_MESSAGE_LENGTH)
-      commandBuffer[commandBufferIndex++] = string[index];
+    else
+    {
+      char message[CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + 1];
+      int length = Project_AppendMessage(message, sizeof(message), 0, "%s; t = %lu ms; ", isRaw ? "RAW" : "DATA",
+        (unsigned long) sample->timestamp);
+
+      if (isOk && isRaw)
+        length = Project_AppendMessage(message, sizeof(message), length, "P = %ld; T = %ld; H = %ld\n",
+          (long) sample->rawData.pressure, (long) sample->rawData.temperature, (long) sample->rawData.humidity);
+      else if (isOk)
+        length = Project_FormatMeasurement(message, sizeof(message), length, &measurement);
+      else
+        length = Project_AppendMessage(message, sizeof(message), length, "Sampling failed.\n");
+
+      Project_SendCdcMessage(message, (uint16_t) length);
+    }
+
+    Stream_Pop();
   }
+}
 
-  Project_SetLedState(false);
+/**
+ * @brief Sends the history samples requested by the <i>History</i> command while there is enough room for them in the
+ *   transmission buffer. The samples are stored uncompensated, so they are compensated only here, in batches (see
+ *   <i>BME280_CompensateBatch</i>). The text samples are sent as the <i>HIST</i> messages, and the binary ones as the
+ *   frames with the <i>History</i> command identifier, the lowest byte of the sample number, the status byte, the
+ *   sample number, the timestamp, and the packed measurement.
+ */
+static void Project_SendHistorySamples()
+{
+  History_Entry entries[PROJECT_HISTORY_BATCH_LENGTH];
+  BME280_RawData rawData[PROJECT_HISTORY_BATCH_LENGTH];
+  BME280_Measurement measurements[PROJECT_HISTORY_BATCH_LENGTH];
+  uint32_t count;
+
+  do
+  {
+    // Reading out as many samples as there is room for, so that they are compensated in a batch.
+    count = 0;
+    while (count < PROJECT_HISTORY_BATCH_LENGTH &&
+      TransmitQueue_GetFreeSpace() >= (count + 1) * PROJECT_MAX_RESPONSE_LENGTH && History_ReadNext(&entries[count]))
+    {
+      rawData[count] = entries[count].rawData;
+      count++;
+    }
+    BME280_CompensateBatch(&Project_TrimmingParams, rawData, BME280_CHANNEL_ALL, measurements, count);
+
+    for (uint32_t index = 0; index < count; index++)
+    {
+      const History_Entry *entry = &entries[index];
+      if (Project_CommandFormat == COMMAND_FORMAT_BINARY)
+      {
+        uint8_t data[PROJECT_MAX_RESPONSE_FRAME_LENGTH];
+        data[0] = COMMAND_ID_HISTORY;
+        data[1] = (uint8_t) entry->index;
+        data[FRAME_HEADER_LENGTH] = COMMAND_STATUS_OK;
+        Frame_PutUint32(&data[FRAME_HEADER_LENGTH + 1], entry->index);
+        Frame_PutUint32(&data[FRAME_HEADER_LENGTH + 5], entry->timestamp);
+        Frame_PutMeasurement(&data[FRAME_HEADER_LENGTH + 9], &measurements[index]);
+        Project_SendFrame(data, FRAME_HEADER_LENGTH + 9 + FRAME_MEASUREMENT_LENGTH);
+      }
+      else
+      {
+        char message[CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + 1];
+        int length = Project_AppendMessage(message, sizeof(message), 0, "HIST; n = %lu; t = %lu ms; ",
+          (unsigned long) entry->index, (unsigned long) entry->timestamp);
+        length = Project_FormatMeasurement(message, sizeof(message), length, &measurements[index]);
+        Project_SendCdcMessage(message, (uint16_t) length);
+      }
+    }
+  }
+  while (count > 0);
+}
+
+/**
+ * @brief Defers the command being processed: its response is not sent, and the command is left in the command queue
+ *   to be processed again on the following main loop iterations. The following commands wait for it.
+ */
+void Project_DeferCommand()
+{
+  Project_IsCommandDeferred = true;
+}
+
+/**
+ * @brief Processes the provided command message.
+ * @param command A pointer to the string containing the command message to process.
+ * @return <i>true</i> if the command has been processed, or <i>false</i> if it has been deferred.
+ */
+static bool Project_ProcessCommand(const char *command)
+{
+  Project_IsCommandDeferred = false;
+
+  if (Project_CommandFormat == COMMAND_FORMAT_BINARY)
+    Project_ProcessFrame(command);
+  else
+  {
+    char response[CONFIG_MAX_RESPONSE_MESSAGE_LENGTH + 1];
+    uint16_t length = Command_ProcessMessage(command, &response[0]);
+    if (!Project_IsCommandDeferred)
+      Project_SendCdcMessage(&response[0], length);
+  }
+
+  return !Project_IsCommandDeferred;
+}
+
+/**
+ * @brief The callback to be processed on USB CDC message reception. Called in the USB interrupt context, so the
+ *   received command messages are only queued here and processed later in the main loop.
+ * @param string A pointer to the string containing the received message.
+ * @param length Length of the message in the string.
+ */
+void Project_CdcMessageReceived(const char *string, uint16_t length)
+{
+  if (Project_IsResetRequested)
+    return;
+
+  CommandQueue_Put(string, length);
 }
 
 /**
@@ -249,12 +736,7 @@ void Project_CdcMessageReceived(const char *string, uint16_t length)
  */
 void Project_CdcTransmissionCompleted(__unused const char *string, __unused uint16_t length)
 {
-  // Resets the MCU after the corresponding software reset command response message has been transmitted.
-  if (Project_IsResetRequested)
-  {
-    LL_mDelay(100);
-    NVIC_SystemReset();
-  }
+  TransmitQueue_Completed();
 }
 
 /**
@@ -262,4 +744,32 @@ void Project_CdcTransmissionCompleted(__unused const char *string, __unused uint
  */
 void Project_Loop()
 {
+  // Resetting the MCU as soon as the software reset command response has been transmitted. The transmission is
+  // completed when the host has acknowledged the last packet, so the response is not lost.
+  if (Project_IsResetRequested && TransmitQueue_IsEmpty())
+    NVIC_SystemReset();
+
+  // Commands are processed only while their responses can be queued, otherwise they wait in the command queue.
+  const char *command;
+  while (!Project_IsResetRequested && TransmitQueue_GetFreeSpace() >= PROJECT_MAX_RESPONSE_LENGTH &&
+    (command = CommandQueue_Peek()) != NULL)
+  {
+    Project_SetLedState(true);
+    bool isProcessed = Project_ProcessCommand(command);
+    Project_SetLedState(false);
+    if (!isProcessed)
+      break;
+
+    CommandQueue_Pop();
+  }
+
+  if (!Project_IsResetRequested)
+  {
+    Project_SendStreamSamples();
+    Project_SendHistorySamples();
+  }
+
+  // Transmitting all the responses of the processed commands and the streamed samples together.
+  TransmitQueue_Kick();
+  Sampler_Process();
 }
@@ -17,6 +17,15 @@
 #include "i2c.h"
 #include "bme280.h"
 #include "command.h"
+#include "command_queue.h"
+#include "transmit_queue.h"
+#include "sampler.h"
+#include "oversampling.h"
+#include "stream.h"
+#include "history.h"
+#include "number_format.h"
+#include "frame.h"
+#include "store.h"
 
 /**
  * @brief Defines the project name.
@@ -28,7 +37,32 @@
  */
 #define PROJECT_VERSION "1.0"
 
+/**
+ * @brief The BME280 sensor initialization status enumeration.
+ */
+typedef enum Project_InitStatus
+{
+  /**
+   * @brief The initialization is waiting for the device, and has to be continued later.
+   */
+  PROJECT_INIT_IN_PROGRESS,
+
+  /**
+   * @brief The device has been initialized.
+   */
+  PROJECT_INIT_SUCCEEDED,
+
+  /**
+   * @brief The device communication has failed or the device has not become ready in time.
+   */
+  PROJECT_INIT_FAILED
+} Project_InitStatus;
+
 extern BME280_TrimmingParams Project_TrimmingParams;
+extern uint8_t Project_TrimmingData[BME280_TRIMMING_DATA_LENGTH];
+extern BME280_Config Project_Bme280Config;
+extern BME280_Config Project_Bme280UserConfig;
+extern bool Project_IsBme280Initialized;
 
 void Project_RequestSoftwareReset(bool jumpToBootloader);
 
@@ -40,12 +74,22 @@ void Project_RecoverI2cState();
 
 void Project_PreInit();
 
-bool Project_Bme280Init();
+Project_InitStatus Project_StartBme280Init();
+
+Project_InitStatus Project_ContinueBme280Init();
+
+void Project_I2cInit();
 
 void Project_PostInit();
 
+bool Project_SaveSettings();
+
 void Project_Loop();
 
+void Project_SetCommandFormat(Command_Format format);
+
+void Project_DeferCommand();
+
 bool Project_SendCdcMessage(const char *string, uint16_t length);
 
 void Project_CdcMessageReceived(const char *string, uint16_t length);
@@ -0,0 +1,515 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+
+#include "sampler.h"
+#include "project.h"
+
+/**
+ * @brief The double buffer holding the two latest published samples.
+ */
+static Sampler_Sample Sampler_Buffers[2];
+
+/**
+ * @brief The number of published samples. Its lowest bit selects the buffer holding the latest sample.
+ */
+static volatile uint32_t Sampler_Sequence = 0;
+
+/**
+ * @brief The system tick value when the last sample has been started.
+ */
+static uint32_t Sampler_LastTick = 0;
+
+/**
+ * @brief The system tick value when the registers of the last sample have been read.
+ */
+static uint32_t Sampler_ReadTick = 0;
+
+/**
+ * @brief The system tick value when the new sensor data have been read last time in the normal mode.
+ */
+static uint32_t Sampler_DataTick = 0;
+
+/**
+ * @brief The uncompensated data read last time in the normal mode, used to tell the new sensor data from the data
+ *   latched by the sensor earlier.
+ */
+static BME280_RawData Sampler_LastRawData;
+
+/**
+ * @brief The background sampling period in milliseconds.
+ */
+static uint32_t Sampler_Period = CONFIG_SAMPLING_PERIOD;
+
+/**
+ * @brief The background sampling period in milliseconds restored when the streaming is stopped.
+ */
+static uint32_t Sampler_DefaultPeriod = CONFIG_SAMPLING_PERIOD;
+
+/**
+ * @brief Defines the number of registers read per sample: the control registers followed by the data registers.
+ */
+#define SAMPLER_READ_LENGTH (BME280_RAW_DATA_ADDRESS + BME280_RAW_DATA_LENGTH - BME280_CONTROL_ADDRESS)
+
+/**
+ * @brief The address of the first register read per sample.
+ */
+static const uint8_t Sampler_ReadAddress = BME280_CONTROL_ADDRESS;
+
+/**
+ * @brief The buffer receiving the registers read per sample.
+ */
+static uint8_t Sampler_ReadData[SAMPLER_READ_LENGTH];
+
+/**
+ * @brief The background register read transaction.
+ */
+static I2C_Transaction Sampler_Transaction = {
+  .writeBuffer = &Sampler_ReadAddress,
+  .writeLength = sizeof(Sampler_ReadAddress),
+  .readBuffer = &Sampler_ReadData[0],
+  .readLength = sizeof(Sampler_ReadData)
+};
+
+/**
+ * @brief The buffer holding the register writes starting a forced mode measurement. The whole configuration is written
+ *   every time, so that it is restored if the sensor has been reset since the previous measurement.
+ */
+static uint8_t Sampler_TriggerData[BME280_CONFIG_DATA_LENGTH];
+
+/**
+ * @brief The background forced mode measurement trigger transaction.
+ */
+static I2C_Transaction Sampler_TriggerTransaction = {
+  .writeBuffer = &Sampler_TriggerData[0],
+  .writeLength = sizeof(Sampler_TriggerData),
+  .readBuffer = NULL,
+  .readLength = 0
+};
+
+/**
+ * @brief The background sampling state enumeration.
+ */
+typedef enum Sampler_State
+{
+  /**
+   * @brief Waiting for the sampling period to elapse or for an on-demand measurement request.
+   */
+  SAMPLER_STATE_IDLE,
+
+  /**
+   * @brief The forced mode measurement trigger transaction has been submitted.
+   */
+  SAMPLER_STATE_TRIGGERING,
+
+  /**
+   * @brief Waiting for the forced mode measurement to complete.
+   */
+  SAMPLER_STATE_CONVERTING,
+
+  /**
+   * @brief The register read transaction has been submitted.
+   */
+  SAMPLER_STATE_READING,
+
+  /**
+   * @brief The sensor is being initialized by the <i>Project_ContinueBme280Init</i> function.
+   */
+  SAMPLER_STATE_INITIALIZING
+} Sampler_State;
+
+/**
+ * @brief The background sampling state.
+ */
+static Sampler_State Sampler_CurrentState = SAMPLER_STATE_IDLE;
+
+/**
+ * @brief The time in milliseconds since the forced mode measurement start after which the registers are read.
+ */
+static uint32_t Sampler_ReadDelay = 0;
+
+/**
+ * @brief The maximal forced mode measurement time in milliseconds. The registers are read again while the measurement
+ *   is still in progress, but not longer than this time.
+ */
+static uint32_t Sampler_MaxReadDelay = 0;
+
+/**
+ * @brief The flag indicating if an on-demand measurement has been requested by the <i>Sampler_GetFresh</i> function.
+ */
+static bool Sampler_IsRequested = false;
+
+/**
+ * @brief The earliest sample timestamp satisfying the on-demand measurement request.
+ */
+static uint32_t Sampler_RequestedTimestamp = 0;
+
+/**
+ * @brief Publishes a new latest sample.
+ * @param sample A pointer to the sample to publish.
+ * @note Must be called from a single context only. The sample is written to the buffer not visible to readers and
+ *   then exposed by the sequence increment, so readers interrupting the writer always observe a complete sample.
+ */
+void Sampler_Publish(const Sampler_Sample *sample)
+{
+  uint32_t sequence = Sampler_Sequence + 1;
+  Sampler_Buffers[sequence & 1] = *sample;
+  __DMB();
+  Sampler_Sequence = sequence;
+}
+
+/**
+ * @brief Gets a copy of the latest published sample. Safe to call from any context including interrupts.
+ * @param sample A pointer to the sample structure to be filled.
+ * @return <i>true</i> if a sample has been published yet, otherwise <i>false</i>.
+ * @note If the writer interrupts the copying and publishes a new sample, the copy is retried.
+ */
+bool Sampler_GetLatest(Sampler_Sample *sample)
+{
+  uint32_t sequence;
+  do
+  {
+    sequence = Sampler_Sequence;
+    __DMB();
+    *sample = Sampler_Buffers[sequence & 1];
+    __DMB();
+  }
+  while (sequence != Sampler_Sequence);
+
+  return sequence != 0;
+}
+
+/**
+ * @brief Submits the background register read transaction.
+ * @param tick The current system tick value becoming the sample timestamp.
+ */
+static void Sampler_Read(uint32_t tick)
+{
+  Sampler_ReadTick = tick;
+  Sampler_Transaction.i2c = I2C1;
+  Sampler_Transaction.address = BME280_address;
+  Sampler_CurrentState = SAMPLER_STATE_READING;
+  I2C_Submit(&Sampler_Transaction);
+}
+
+/**
+ * @brief Starts taking a new sample: submits the forced mode measurement trigger transaction, or the register read
+ *   transaction in the normal mode.
+ * @param tick The current system tick value.
+ */
+static void Sampler_Start(uint32_t tick)
+{
+  Sampler_LastTick = tick;
+
+  if (I2C_IsIdle())
+    Project_RecoverI2cState();
+
+  if (Project_Bme280Config.mode == BME280_MODE_NORMAL)
+    return Sampler_Read(tick);
+
+  BME280_Config config = Project_Bme280Config;
+  config.mode = BME280_MODE_FORCED;
+  BME280_PrepareConfigData(&config, &Sampler_TriggerData[0]);
+  Sampler_TriggerTransaction.i2c = I2C1;
+  Sampler_TriggerTransaction.address = BME280_address;
+  Sampler_CurrentState = SAMPLER_STATE_TRIGGERING;
+  I2C_Submit(&Sampler_TriggerTransaction);
+}
+
+/**
+ * @brief Publishes the completed sample and puts it to the stream if it carries new data.
+ * @param sample A pointer to the completed sample.
+ * @param isNew If <i>false</i>, the sample repeats the data latched by the sensor in the normal mode and already read.
+ */
+static void Sampler_Finish(const Sampler_Sample *sample, bool isNew)
+{
+  Sampler_CurrentState = SAMPLER_STATE_IDLE;
+  Sampler_Publish(sample);
+  if (isNew)
+    Stream_Put(sample);
+}
+
+/**
+ * @brief Handles the sensor initialization status: takes the sample once the sensor has been initialized, or
+ *   publishes the failed sample.
+ * @param tick The current system tick value.
+ * @param status The sensor initialization status.
+ */
+static void Sampler_ContinueInit(uint32_t tick, Project_InitStatus status)
+{
+  if (status == PROJECT_INIT_IN_PROGRESS)
+    return;
+
+  if (status == PROJECT_INIT_SUCCEEDED)
+    return Sampler_Start(tick);
+
+  Sampler_Sample sample = {
+    .timestamp = tick,
+    .status = SAMPLER_STATUS_INIT_FAILED,
+    .result = I2C_RESULT_OK
+  };
+  Sampler_Finish(&sample, true);
+}
+
+/**
+ * @brief Starts the sensor initialization. It is continued by the <i>Sampler_Process</i> function without blocking the
+ *   main loop, and the sample is taken when it is completed.
+ * @note Must be called only while the sampler is idle.
+ */
+void Sampler_InitSensor()
+{
+  Sampler_CurrentState = SAMPLER_STATE_INITIALIZING;
+  Sampler_ContinueInit(HAL_GetTick(), Project_StartBme280Init());
+}
+
+/**
+ * @brief Checks if the sensor is being initialized.
+ */
+bool Sampler_IsInitializing()
+{
+  return Sampler_CurrentState == SAMPLER_STATE_INITIALIZING;
+}
+
+/**
+ * @brief Applies the <i>Project_Bme280Config</i> sensor configuration changed at runtime without resetting the sensor.
+ *   The sensor is put to the sleep mode first, as the configuration register writes may be ignored in the normal mode,
+ *   and then it is switched to the normal mode if selected. In the forced mode the configuration is also written by
+ *   every measurement trigger.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration. On failure the sensor is
+ *   initialized again before the next sample.
+ * @note Must be called only while the sampler is idle, so that a forced mode measurement is not interrupted.
+ */
+I2C_Result Sampler_ApplyConfig()
+{
+  BME280_Config config = Project_Bme280Config;
+  config.mode = BME280_MODE_SLEEP;
+  I2C_Result result = BME280_SetConfig(I2C1, &config);
+  if (result == I2C_RESULT_OK && Project_Bme280Config.mode == BME280_MODE_NORMAL)
+    result = BME280_SetConfig(I2C1, &Project_Bme280Config);
+
+  if (result != I2C_RESULT_OK)
+    Project_IsBme280Initialized = false;
+  return result;
+}
+
+/**
+ * @brief Checks if the sensor configuration read back differs from the one set, which happens when the sensor has been
+ *   reset or powered off.
+ */
+static bool Sampler_IsConfigLost(const BME280_Config *config)
+{
+  const BME280_Config *expected = &Project_Bme280Config;
+  return (expected->mode == BME280_MODE_NORMAL && config->mode != BME280_MODE_NORMAL) ||
+    config->temperatureOversampling != expected->temperatureOversampling ||
+    config->pressureOversampling != expected->pressureOversampling ||
+    config->humidityOversampling != expected->humidityOversampling || config->filter != expected->filter;
+}
+
+/**
+ * @brief Checks if the sensor may have output new data since the new data have been read last time. In the normal mode
+ *   the sensor outputs a sample once per conversion cycle, so the registers read earlier repeat the latched data.
+ * @param tick The current system tick value.
+ */
+static bool Sampler_IsDataExpected(uint32_t tick)
+{
+  return Project_Bme280Config.mode != BME280_MODE_NORMAL ||
+    tick - Sampler_DataTick >= BME280_GetCycleTime(&Project_Bme280Config, false) / 1000;
+}
+
+/**
+ * @brief Checks if the raw data read in the normal mode are new ones: either they differ from the ones read last time,
+ *   or the maximal conversion cycle time has elapsed, so that the steady values are not taken for the repeated ones.
+ * @param tick The system tick value when the registers have been read.
+ * @param rawData A pointer to the uncompensated data read.
+ */
+static bool Sampler_IsDataNew(uint32_t tick, const BME280_RawData *rawData)
+{
+  if (Project_Bme280Config.mode != BME280_MODE_NORMAL)
+    return true;
+
+  if (memcmp(rawData, &Sampler_LastRawData, sizeof(Sampler_LastRawData)) == 0 &&
+    tick - Sampler_DataTick < (BME280_GetCycleTime(&Project_Bme280Config, true) + 999) / 1000)
+    return false;
+
+  Sampler_DataTick = tick;
+  Sampler_LastRawData = *rawData;
+  return true;
+}
+
+/**
+ * @brief Completes the sample from the registers read by the background transaction.
+ * @param tick The current system tick value.
+ * @param result The result of the last submitted transaction.
+ */
+static void Sampler_Complete(uint32_t tick, I2C_Result result)
+{
+  BME280_Config config;
+  BME280_Status status;
+  bool isNew = true;
+  Sampler_Sample sample = {
+    .timestamp = Sampler_ReadTick,
+    .status = SAMPLER_STATUS_OK,
+    .result = result
+  };
+
+  if (sample.result == I2C_RESULT_OK)
+  {
+    BME280_ParseConfig(&Sampler_ReadData[0], &config);
+    BME280_ParseStatus(Sampler_ReadData[BME280_STATUS_OFFSET], &status);
+    if (!Project_IsBme280Initialized || Sampler_IsConfigLost(&config))
+      return Sampler_InitSensor();
+    else if (Project_Bme280Config.mode != BME280_MODE_NORMAL && status.isMeasuring &&
+      tick - Sampler_LastTick < Sampler_MaxReadDelay)
+    {
+      // The measurement takes longer than the typical time, polling the status every millisecond.
+      Sampler_ReadDelay = tick - Sampler_LastTick + 1;
+      Sampler_CurrentState = SAMPLER_STATE_CONVERTING;
+      return;
+    }
+    else
+    {
+      BME280_ParseRawData(&Sampler_ReadData[BME280_RAW_DATA_ADDRESS - BME280_CONTROL_ADDRESS], &sample.rawData);
+      isNew = Sampler_IsDataNew(sample.timestamp, &sample.rawData);
+
+      // The latched data read again would fill the history with duplicates and bias the noise estimation low.
+      if (isNew)
+      {
+        History_Put(sample.timestamp, &sample.rawData);
+        if (Oversampling_Put(&sample.rawData, Sampler_Period))
+          Sampler_ApplyConfig();
+      }
+    }
+  }
+
+  // The forced mode configuration is restored on every measurement, so the sensor reset cannot be detected from it,
+  // and the sensor is initialized again after the communication failure in case it has been replaced.
+  if (sample.result != I2C_RESULT_OK)
+  {
+    sample.status = SAMPLER_STATUS_I2C_FAILED;
+    if (Project_Bme280Config.mode != BME280_MODE_NORMAL)
+      Project_IsBme280Initialized = false;
+  }
+
+  Sampler_Finish(&sample, isNew);
+}
+
+/**
+ * @brief Checks if no measurement or register read is in progress.
+ */
+bool Sampler_IsIdle()
+{
+  return Sampler_CurrentState == SAMPLER_STATE_IDLE;
+}
+
+/**
+ * @brief Sets the background sampling period.
+ * @param period The sampling period in milliseconds. Values less than 1 millisecond are rounded up.
+ */
+void Sampler_SetPeriod(uint32_t period)
+{
+  Sampler_Period = period > 0 ? period : 1;
+}
+
+/**
+ * @brief Sets the background sampling period restored when the streaming is stopped. The current period is not
+ *   changed.
+ * @param period The sampling period in milliseconds. Values less than 1 millisecond are rounded up.
+ */
+void Sampler_SetDefaultPeriod(uint32_t period)
+{
+  Sampler_DefaultPeriod = period > 0 ? period : 1;
+}
+
+/**
+ * @brief Gets the background sampling period restored when the streaming is stopped.
+ */
+uint32_t Sampler_GetDefaultPeriod()
+{
+  return Sampler_DefaultPeriod;
+}
+
+/**
+ * @brief Gets a copy of the latest published sample if it is fresh enough, otherwise requests an on-demand
+ *   measurement started as soon as the sampler is idle.
+ * @param maxAge The maximal age of the sample in milliseconds at the moment of the first call.
+ * @param sample A pointer to the sample structure to be filled.
+ * @return <i>true</i> if the sample is fresh enough, otherwise <i>false</i>, and the call has to be repeated later with
+ *   the same parameters until the requested measurement is completed.
+ * @remarks The sample timestamp is the time its registers have been read. In the forced mode it is the measurement
+ *   completion time, so the measurement in progress satisfies any request. In the normal mode the registers are read
+ *   immediately, but the data latched by the sensor may be older by up to the measurement time and the standby time.
+ */
+bool Sampler_GetFresh(uint32_t maxAge, Sampler_Sample *sample)
+{
+  if (!Sampler_IsRequested)
+    Sampler_RequestedTimestamp = HAL_GetTick() - maxAge;
+
+  Sampler_IsRequested = !Sampler_GetLatest(sample) || (int32_t) (sample->timestamp - Sampler_RequestedTimestamp) < 0;
+  return !Sampler_IsRequested;
+}
+
+/**
+ * @brief Takes a new sample from the sensor if the sampling period has elapsed or an on-demand measurement has been
+ *   requested. Must be called in the main loop.
+ * @remarks In the normal mode the control and data registers are read in a single background I2C transaction, not
+ *   earlier than the typical conversion cycle time after the new data have been read last time. In the forced mode
+ *   a measurement is triggered first, and the registers are read after the typical measurement time calculated from
+ *   the oversampling factors, then polled every millisecond until the measurement is completed. The main loop is
+ *   never blocked while the bytes are being transferred or the measurement is in progress.
+ */
+void Sampler_Process()
+{
+  I2C_CheckTimeout();
+
+  uint32_t tick = HAL_GetTick();
+  switch (Sampler_CurrentState)
+  {
+    case SAMPLER_STATE_IDLE:
+    {
+      if (Sampler_Sequence == 0 || Sampler_IsRequested ||
+        (tick - Sampler_LastTick >= Sampler_Period && Sampler_IsDataExpected(tick)))
+        Sampler_Start(tick);
+      break;
+    }
+    case SAMPLER_STATE_TRIGGERING:
+    {
+      if (!Sampler_TriggerTransaction.isCompleted)
+        break;
+
+      if (Sampler_TriggerTransaction.result != I2C_RESULT_OK)
+      {
+        Sampler_ReadTick = tick;
+        Sampler_Complete(tick, Sampler_TriggerTransaction.result);
+        break;
+      }
+
+      Sampler_ReadDelay = (BME280_GetMeasurementTime(&Project_Bme280Config, false) + 999) / 1000;
+      Sampler_MaxReadDelay = (BME280_GetMeasurementTime(&Project_Bme280Config, true) + 999) / 1000;
+      Sampler_CurrentState = SAMPLER_STATE_CONVERTING;
+      break;
+    }
+    case SAMPLER_STATE_CONVERTING:
+    {
+      if (tick - Sampler_LastTick >= Sampler_ReadDelay)
+        Sampler_Read(tick);
+      break;
+    }
+    case SAMPLER_STATE_READING:
+    {
+      if (Sampler_Transaction.isCompleted)
+        Sampler_Complete(tick, Sampler_Transaction.result);
+      break;
+    }
+    case SAMPLER_STATE_INITIALIZING:
+    {
+      Sampler_ContinueInit(tick, Project_ContinueBme280Init());
+      break;
+    }
+  }
+}
@@ -0,0 +1,99 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_SAMPLER_H
+#define BME_READER_SAMPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "bme280.h"
+
+/**
+ * @brief The minimal background sampling period in milliseconds.
+ */
+#define SAMPLER_MIN_PERIOD 1
+
+/**
+ * @brief The maximal background sampling period in milliseconds.
+ */
+#define SAMPLER_MAX_PERIOD 60000
+
+/**
+ * @brief The background sampling status enumeration.
+ */
+typedef enum Sampler_Status
+{
+  /**
+   * @brief The sample contains valid measurement data.
+   */
+  SAMPLER_STATUS_OK,
+
+  /**
+   * @brief The sensor communication has failed. See the <i>result</i> sample field for the reason.
+   */
+  SAMPLER_STATUS_I2C_FAILED,
+
+  /**
+   * @brief The sensor initialization has failed.
+   */
+  SAMPLER_STATUS_INIT_FAILED
+} Sampler_Status;
+
+/**
+ * @brief The background sample structure.
+ */
+typedef struct Sampler_Sample
+{
+  /**
+   * @brief The uncompensated climatic data. Valid only if the <i>status</i> is <i>SAMPLER_STATUS_OK</i>. Compensated
+   *   when read out, only for the channels needed.
+   */
+  BME280_RawData rawData;
+
+  /**
+   * @brief The system tick value (in milliseconds) when the sample registers have been read. In the forced mode it is
+   *   the measurement completion time.
+   */
+  uint32_t timestamp;
+
+  /**
+   * @brief The sampling status.
+   */
+  Sampler_Status status;
+
+  /**
+   * @brief The I2C operation result for the <i>SAMPLER_STATUS_I2C_FAILED</i> status.
+   */
+  I2C_Result result;
+} Sampler_Sample;
+
+void Sampler_SetPeriod(uint32_t period);
+
+void Sampler_SetDefaultPeriod(uint32_t period);
+
+uint32_t Sampler_GetDefaultPeriod();
+
+bool Sampler_IsIdle();
+
+void Sampler_InitSensor();
+
+bool Sampler_IsInitializing();
+
+I2C_Result Sampler_ApplyConfig();
+
+void Sampler_Process();
+
+void Sampler_Publish(const Sampler_Sample *sample);
+
+bool Sampler_GetLatest(Sampler_Sample *sample);
+
+bool Sampler_GetFresh(uint32_t maxAge, Sampler_Sample *sample);
+
+#endif //BME_READER_SAMPLER_H
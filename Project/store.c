@@ -0,0 +1,341 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+
+#include "store.h"
+#include "main.h"
+#include "frame.h"
+
+/**
+ * @brief Defines the first of the flash sectors the store section is placed to by the linker script.
+ */
+#define STORE_FIRST_SECTOR FLASH_SECTOR_6
+
+/**
+ * @brief Defines the number of the equally sized flash sectors of the store section. The live records are copied to
+ *   the other sector before the current one is abandoned, so they are never kept in RAM only.
+ */
+#define STORE_SECTOR_COUNT 2
+
+/**
+ * @brief Defines the length of the sector header: the sector generation number followed by its bitwise complement,
+ *   programmed after the records copied to the sector. The valid sector with the latest generation is the current one.
+ */
+#define STORE_SECTOR_HEADER_LENGTH 8
+
+/**
+ * @brief Defines the length of the record header: the CRC of the following header bytes and the value, the key, and
+ *   the value length.
+ */
+#define STORE_HEADER_LENGTH 4
+
+/**
+ * @brief Gets the record length. The records are padded to the flash word boundary.
+ * @param valueLength The stored value length.
+ */
+#define STORE_RECORD_LENGTH(valueLength) (STORE_HEADER_LENGTH + (((uint32_t) (valueLength) + 3) & ~3U))
+
+/**
+ * @brief Defines the value of an erased flash word. The log ends at the first erased record header.
+ */
+#define STORE_ERASED_WORD 0xFFFFFFFF
+
+/**
+ * @brief Defines the index value of the keys not having a record.
+ */
+#define STORE_NO_RECORD UINT32_MAX
+
+/**
+ * @brief The start of the store section reserved by the linker script. The section occupies whole flash sectors.
+ */
+extern uint8_t _sstore[];
+
+/**
+ * @brief The end of the store section reserved by the linker script.
+ */
+extern uint8_t _estore[];
+
+/**
+ * @brief The in-RAM index of the store: the offsets of the latest valid records of the keys.
+ */
+static uint32_t Store_Index[STORE_KEY_COUNT];
+
+/**
+ * @brief The offset of the first free byte following the log of records.
+ */
+static uint32_t Store_End = 0;
+
+/**
+ * @brief The index of the current store sector holding the log of records.
+ */
+static uint32_t Store_Sector = 0;
+
+/**
+ * @brief The generation number of the current store sector.
+ */
+static uint32_t Store_Generation = 0;
+
+/**
+ * @brief The start of the current store sector. The record offsets are relative to it.
+ */
+static uint8_t *Store_Base = _sstore;
+
+/**
+ * @brief Gets the store sector size.
+ */
+static inline uint32_t Store_GetSize()
+{
+  return (uint32_t) (_estore - _sstore) / STORE_SECTOR_COUNT;
+}
+
+/**
+ * @brief Gets the start of the store sector.
+ * @param sector The store sector index.
+ */
+static inline uint8_t *Store_GetSector(uint32_t sector)
+{
+  return &_sstore[sector * Store_GetSize()];
+}
+
+/**
+ * @brief Checks the record value length and CRC.
+ * @param record A pointer to the record header followed by the value.
+ * @return <i>true</i> if the record is complete and valid, otherwise <i>false</i>.
+ */
+static bool Store_IsRecordValid(const uint8_t *record)
+{
+  return record[3] <= STORE_MAX_VALUE_LENGTH &&
+    Frame_GetCrc(&record[2], (uint16_t) (record[3] + 2)) == (record[0] | record[1] << 8);
+}
+
+/**
+ * @brief Programs the data to the erased flash words.
+ * @param address The flash address aligned to the flash word boundary.
+ * @param data A pointer to the data padded to the flash word boundary.
+ * @param length The padded data length.
+ * @return <i>true</i> if the data have been programmed and verified, otherwise <i>false</i>.
+ */
+static bool Store_ProgramAt(uint8_t *address, const uint8_t *data, uint32_t length)
+{
+  HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+  for (uint32_t offset = 0; status == HAL_OK && offset < length; offset += 4)
+    status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uintptr_t) &address[offset], Frame_GetUint32(&data[offset]));
+  HAL_FLASH_Lock();
+
+  return status == HAL_OK && memcmp(address, data, length) == 0;
+}
+
+/**
+ * @brief Programs the record to the end of the log.
+ * @param record A pointer to the record padded to the flash word boundary.
+ * @param length The padded record length.
+ * @return <i>true</i> if the record has been programmed and verified, otherwise <i>false</i>.
+ */
+static bool Store_Program(const uint8_t *record, uint32_t length)
+{
+  bool isProgrammed = Store_ProgramAt(&Store_Base[Store_End], record, length);
+
+  // The space of a partially programmed record is skipped anyway, as its header has been programmed first. The record
+  // itself is ignored on the following scans by its CRC.
+  Store_End += length;
+  return isProgrammed;
+}
+
+/**
+ * @brief Checks if the store sector is erased, so that it can be programmed without erasing it.
+ * @param sector The store sector index.
+ * @return <i>true</i> if all the sector words are erased, otherwise <i>false</i>.
+ */
+static bool Store_IsErased(uint32_t sector)
+{
+  const uint8_t *base = Store_GetSector(sector);
+  for (uint32_t offset = 0; offset < Store_GetSize(); offset += 4)
+  {
+    if (Frame_GetUint32(&base[offset]) != STORE_ERASED_WORD)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Copies the latest valid records to the other store sector, dropping the outdated ones, and makes it the
+ *   current one. The other sector is erased first unless it is already erased.
+ * @return <i>true</i> if the records have been copied, otherwise <i>false</i>.
+ * @note The current sector is left intact until the next compaction, so the records survive a power failure at any
+ *   step: the copy becomes current only once its header is programmed after all the records.
+ */
+static bool Store_Compact()
+{
+  uint32_t sector = Store_Sector ^ 1;
+  uint8_t *base = Store_GetSector(sector);
+
+  if (!Store_IsErased(sector))
+  {
+    FLASH_EraseInitTypeDef erase = {
+      .TypeErase = FLASH_TYPEERASE_SECTORS,
+      .Sector = STORE_FIRST_SECTOR + sector,
+      .NbSectors = 1,
+      .VoltageRange = FLASH_VOLTAGE_RANGE_3
+    };
+    uint32_t sectorError;
+    HAL_StatusTypeDef status = HAL_FLASH_Unlock();
+    if (status == HAL_OK)
+      status = HAL_FLASHEx_Erase(&erase, &sectorError);
+    HAL_FLASH_Lock();
+
+    if (status != HAL_OK)
+      return false;
+  }
+
+  uint32_t index[STORE_KEY_COUNT];
+  uint32_t end = STORE_SECTOR_HEADER_LENGTH;
+  for (uint8_t key = 0; key < STORE_KEY_COUNT; key++)
+  {
+    index[key] = STORE_NO_RECORD;
+    if (Store_Index[key] == STORE_NO_RECORD)
+      continue;
+
+    // Abandoning the copy if a record fails, it is erased on the next compaction.
+    uint32_t length = STORE_RECORD_LENGTH(Store_Base[Store_Index[key] + 3]);
+    if (!Store_ProgramAt(&base[end], &Store_Base[Store_Index[key]], length))
+      return false;
+
+    index[key] = end;
+    end += length;
+  }
+
+  uint8_t header[STORE_SECTOR_HEADER_LENGTH];
+  Frame_PutUint32(&header[0], Store_Generation + 1);
+  Frame_PutUint32(&header[4], ~(Store_Generation + 1));
+  if (!Store_ProgramAt(base, header, STORE_SECTOR_HEADER_LENGTH))
+    return false;
+
+  Store_Sector = sector;
+  Store_Generation++;
+  Store_Base = base;
+  Store_End = end;
+  memcpy(Store_Index, index, sizeof(Store_Index));
+  return true;
+}
+
+/**
+ * @brief Selects the current store sector by the headers and builds the in-RAM index of the store with a single scan
+ *   of its record log, so that the values are read without searching afterwards. Must be called before any other
+ *   store function.
+ * @note If no sector has a valid header, e.g. on the first boot, the store is treated as full, so that the first
+ *   value stored initializes the other sector.
+ */
+void Store_Init()
+{
+  uint32_t size = Store_GetSize();
+  bool isFound = false;
+  for (uint8_t key = 0; key < STORE_KEY_COUNT; key++)
+    Store_Index[key] = STORE_NO_RECORD;
+
+  // The generation numbers are compared by their difference to handle the wrap-around.
+  Store_Sector = 0;
+  Store_Generation = 0;
+  for (uint32_t sector = 0; sector < STORE_SECTOR_COUNT; sector++)
+  {
+    const uint8_t *base = Store_GetSector(sector);
+    uint32_t generation = Frame_GetUint32(&base[0]);
+    if (Frame_GetUint32(&base[4]) != ~generation || (isFound && (int32_t) (generation - Store_Generation) <= 0))
+      continue;
+
+    isFound = true;
+    Store_Sector = sector;
+    Store_Generation = generation;
+  }
+
+  Store_Base = Store_GetSector(Store_Sector);
+  Store_End = isFound ? STORE_SECTOR_HEADER_LENGTH : size;
+  while (Store_End + STORE_HEADER_LENGTH <= size && Frame_GetUint32(&Store_Base[Store_End]) != STORE_ERASED_WORD)
+  {
+    const uint8_t *record = &Store_Base[Store_End];
+    uint32_t length = STORE_RECORD_LENGTH(record[3]);
+
+    // Treating the rest of the sector as used if the record header is corrupted, so that it gets compacted.
+    if (Store_End + length > size)
+    {
+      Store_End = size;
+      break;
+    }
+
+    // The later records of a key supersede the earlier ones.
+    if (record[2] < STORE_KEY_COUNT && Store_IsRecordValid(record))
+      Store_Index[record[2]] = Store_End;
+    Store_End += length;
+  }
+}
+
+/**
+ * @brief Reads the stored value.
+ * @param key The value key.
+ * @param value The output value buffer.
+ * @param length The expected value length.
+ * @return <i>true</i> if the value has been read, or <i>false</i> if it is not stored or has a different length.
+ */
+bool Store_Get(Store_Key key, void *value, uint16_t length)
+{
+  if (key >= STORE_KEY_COUNT || Store_Index[key] == STORE_NO_RECORD || Store_Base[Store_Index[key] + 3] != length)
+    return false;
+
+  memcpy(value, &Store_Base[Store_Index[key] + STORE_HEADER_LENGTH], length);
+  return true;
+}
+
+/**
+ * @brief Stores the value appending its record to the log. The log is compacted to the other sector when it is full,
+ *   so a sector is erased once per many value changes.
+ * @param key The value key.
+ * @param value A pointer to the value to store.
+ * @param length The value length, up to <i>STORE_MAX_VALUE_LENGTH</i> bytes.
+ * @return <i>true</i> if the value has been stored, otherwise <i>false</i>.
+ * @note The flash is stalled while it is programmed or erased, so the execution from it is suspended for about
+ *   16 us per word programmed, and for up to a few seconds when the other sector is erased on compaction. The USB
+ *   interrupts are not serviced from the flash meanwhile, so the host sees the device stalled.
+ */
+bool Store_Put(Store_Key key, const void *value, uint16_t length)
+{
+  uint8_t record[STORE_RECORD_LENGTH(STORE_MAX_VALUE_LENGTH)];
+  if (key >= STORE_KEY_COUNT || length > STORE_MAX_VALUE_LENGTH)
+    return false;
+
+  // Skipping the unchanged values to save the flash endurance.
+  if (Store_Index[key] != STORE_NO_RECORD && Store_Base[Store_Index[key] + 3] == length &&
+    memcmp(&Store_Base[Store_Index[key] + STORE_HEADER_LENGTH], value, length) == 0)
+    return true;
+
+  uint32_t recordLength = STORE_RECORD_LENGTH(length);
+  memset(record, 0xFF, recordLength);
+  record[2] = (uint8_t) key;
+  record[3] = (uint8_t) length;
+  memcpy(&record[STORE_HEADER_LENGTH], value, length);
+  uint16_t crc = Frame_GetCrc(&record[2], length + 2);
+  record[0] = (uint8_t) crc;
+  record[1] = (uint8_t) (crc >> 8);
+
+  if (Store_End + recordLength > Store_GetSize() && (!Store_Compact() || Store_End + recordLength > Store_GetSize()))
+    return false;
+
+  uint32_t offset = Store_End;
+  if (!Store_Program(record, recordLength))
+    return false;
+
+  Store_Index[key] = offset;
+  return true;
+}
+
+/**
+ * @brief Gets the number of bytes left for the records before the store sector is compacted.
+ */
+uint32_t Store_GetFreeSpace()
+{
+  return Store_GetSize() - Store_End;
+}
@@ -0,0 +1,54 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_STORE_H
+#define BME_READER_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Defines the maximal length of a stored value.
+ */
+#define STORE_MAX_VALUE_LENGTH 64
+
+/**
+ * @brief The keys of the persistent values.
+ */
+typedef enum Store_Key
+{
+  /**
+   * @brief The sensor configuration saved by the <i>Config</i> command.
+   */
+  STORE_KEY_SENSOR_CONFIG,
+
+  /**
+   * @brief The background sampling period saved by the <i>Config</i> command.
+   */
+  STORE_KEY_SAMPLING_PERIOD,
+
+  /**
+   * @brief The sensor chip identifier followed by its calibration data block cached by the sensor initialization.
+   */
+  STORE_KEY_CALIBRATION,
+
+  /**
+   * @brief The number of the keys.
+   */
+  STORE_KEY_COUNT
+} Store_Key;
+
+void Store_Init();
+
+bool Store_Get(Store_Key key, void *value, uint16_t length);
+
+bool Store_Put(Store_Key key, const void *value, uint16_t length);
+
+uint32_t Store_GetFreeSpace();
+
+#endif //BME_READER_STORE_H
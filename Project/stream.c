@@ -0,0 +1,229 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include "stream.h"
+#include "project.h"
+
+#if (CONFIG_STREAM_QUEUE_LENGTH & (CONFIG_STREAM_QUEUE_LENGTH - 1)) != 0
+#error "CONFIG_STREAM_QUEUE_LENGTH must be a power of two."
+#endif
+
+/**
+ * @brief The ring buffer of the samples waiting for transmission.
+ */
+static Stream_Sample Stream_Samples[CONFIG_STREAM_QUEUE_LENGTH];
+
+/**
+ * @brief The free-running count of the queued samples.
+ */
+static uint32_t Stream_Head = 0;
+
+/**
+ * @brief The free-running count of the transmitted samples.
+ */
+static uint32_t Stream_Tail = 0;
+
+/**
+ * @brief The free-running count of the streamed samples including the dropped ones.
+ */
+static uint32_t Stream_Sequence = 0;
+
+/**
+ * @brief The number of samples dropped since the streaming start.
+ */
+static uint32_t Stream_Dropped = 0;
+
+/**
+ * @brief The flag indicating if the streaming is active.
+ */
+static bool Stream_IsStarted = false;
+
+/**
+ * @brief The flag indicating if the samples are streamed uncompensated.
+ */
+static bool Stream_IsRawStarted = false;
+
+/**
+ * @brief The sensor configuration restored when the streaming is stopped.
+ */
+static BME280_Config Stream_SavedConfig;
+
+/**
+ * @brief The adaptive oversampling state restored when the streaming is stopped.
+ */
+static bool Stream_WasAdaptive = false;
+
+/**
+ * @brief Selects the normal mode configuration making the sensor output the samples at the streaming rate. The
+ *   oversampling of the measured channels is halved until a conversion cycle fits the streaming period with the
+ *   shortest standby time, and then the longest standby time still fitting it is selected.
+ * @param rate The streaming rate in samples per second.
+ * @param config A pointer to the configuration to be changed.
+ * @note The maximal cycle time is fitted, so the sensor outputs the samples not slower than at the streaming rate. The
+ *   highest rate is reached with the x1 oversampling and the 0.5 ms standby time.
+ */
+static void Stream_SelectConfig(uint32_t rate, BME280_Config *config)
+{
+  uint32_t period = 1000000 / rate;
+  config->mode = BME280_MODE_NORMAL;
+  config->standbyTime = BME280_STANDBY_TIME_0ms5;
+  while (BME280_GetCycleTime(config, true) > period && (config->temperatureOversampling > 1 ||
+    config->pressureOversampling > 1 || config->humidityOversampling > 1))
+  {
+    config->temperatureOversampling -= config->temperatureOversampling > 1;
+    config->pressureOversampling -= config->pressureOversampling > 1;
+    config->humidityOversampling -= config->humidityOversampling > 1;
+  }
+
+  BME280_Config candidate = *config;
+  for (uint8_t standbyTime = 0; standbyTime < 8; standbyTime++)
+  {
+    candidate.standbyTime = standbyTime;
+    uint32_t cycleTime = BME280_GetCycleTime(&candidate, true);
+    if (cycleTime <= period && cycleTime > BME280_GetCycleTime(config, true))
+      config->standbyTime = standbyTime;
+  }
+}
+
+/**
+ * @brief Gets the highest streaming rate: the typical output rate of the sensor in the normal mode with the x1
+ *   oversampling of the measured channels and the 0.5 ms standby time.
+ * @return The highest streaming rate in samples per second.
+ */
+uint32_t Stream_GetMaxRate()
+{
+  BME280_Config config = Stream_IsStarted ? Stream_SavedConfig : Project_Bme280Config;
+  config.temperatureOversampling = BME280_TEMPERATURE_OVERSAMPLING_1;
+  if (config.pressureOversampling != BME280_PRESSURE_OVERSAMPLING_SKIPPED)
+    config.pressureOversampling = BME280_PRESSURE_OVERSAMPLING_1;
+  if (config.humidityOversampling != BME280_HUMIDITY_OVERSAMPLING_SKIPPED)
+    config.humidityOversampling = BME280_HUMIDITY_OVERSAMPLING_1;
+  config.standbyTime = BME280_STANDBY_TIME_0ms5;
+  return 1000000 / BME280_GetCycleTime(&config, false);
+}
+
+/**
+ * @brief Starts streaming of every new background sample. The sensor is switched to the normal mode with the
+ *   oversampling and standby time fitting the streaming rate, and the background sampler polls it every millisecond
+ *   once a new sample is expected, so every sample output by the sensor is streamed once.
+ * @param rate The streaming rate in samples per second, from 1 to the one returned by <i>Stream_GetMaxRate</i>.
+ * @param isRaw If <i>true</i>, the samples are streamed as the uncompensated ADC data, otherwise as the measurements.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ * @note Must be called only while the sampler is idle. The sensor configuration and the adaptive oversampling are
+ *   restored when the streaming is stopped.
+ */
+I2C_Result Stream_Start(uint32_t rate, bool isRaw)
+{
+  if (!Stream_IsStarted)
+  {
+    Stream_SavedConfig = Project_Bme280Config;
+    Stream_WasAdaptive = Oversampling_IsEnabled();
+  }
+
+  BME280_Config config = Stream_SavedConfig;
+  Stream_SelectConfig(rate, &config);
+  Project_Bme280Config = config;
+  Oversampling_SetEnabled(false);
+
+  Stream_Tail = Stream_Head;
+  Stream_Dropped = 0;
+  Stream_IsStarted = true;
+  Stream_IsRawStarted = isRaw;
+  Sampler_SetPeriod(1);
+  return Sampler_ApplyConfig();
+}
+
+/**
+ * @brief Stops streaming, discards the samples waiting for transmission, and restores the sensor configuration, the
+ *   adaptive oversampling, and the default background sampling period.
+ * @return A value indicating the I2C operation result. See the <i>I2C_Result</i> enumeration.
+ * @note Must be called only while the sampler is idle.
+ */
+I2C_Result Stream_Stop()
+{
+  if (!Stream_IsStarted)
+    return I2C_RESULT_OK;
+
+  Stream_IsStarted = false;
+  Stream_Tail = Stream_Head;
+  Project_Bme280Config = Stream_SavedConfig;
+  Oversampling_SetEnabled(Stream_WasAdaptive);
+  Sampler_SetPeriod(Sampler_GetDefaultPeriod());
+  return Sampler_ApplyConfig();
+}
+
+/**
+ * @brief Checks if the streaming is active.
+ */
+bool Stream_IsActive()
+{
+  return Stream_IsStarted;
+}
+
+/**
+ * @brief Checks if the samples are streamed as the uncompensated ADC data.
+ */
+bool Stream_IsRaw()
+{
+  return Stream_IsRawStarted;
+}
+
+/**
+ * @brief Queues the new background sample for transmission if the streaming is active. If the queue is full because the
+ *   host does not keep up with the streaming rate, the sample is dropped and counted.
+ * @param sample A pointer to the sample to queue.
+ */
+void Stream_Put(const Sampler_Sample *sample)
+{
+  if (!Stream_IsStarted)
+    return;
+
+  uint32_t sequence = Stream_Sequence++;
+  if (Stream_Head - Stream_Tail >= CONFIG_STREAM_QUEUE_LENGTH)
+  {
+    Stream_Dropped++;
+    return;
+  }
+
+  Stream_Sample *slot = &Stream_Samples[Stream_Head & (CONFIG_STREAM_QUEUE_LENGTH - 1)];
+  slot->sample = *sample;
+  slot->sequence = sequence;
+  Stream_Head++;
+}
+
+/**
+ * @brief Gets the oldest sample waiting for transmission without removing it from the queue.
+ * @return A pointer to the sample, or <i>NULL</i> if the queue is empty.
+ */
+const Stream_Sample *Stream_Peek()
+{
+  if (Stream_Tail == Stream_Head)
+    return NULL;
+
+  return &Stream_Samples[Stream_Tail & (CONFIG_STREAM_QUEUE_LENGTH - 1)];
+}
+
+/**
+ * @brief Removes the oldest sample from the queue after it has been transmitted.
+ */
+void Stream_Pop()
+{
+  if (Stream_Tail != Stream_Head)
+    Stream_Tail++;
+}
+
+/**
+ * @brief Gets the sample streaming statistics.
+ * @param stats A pointer to the structure that will be filled with the statistics.
+ */
+void Stream_GetStats(Stream_Stats *stats)
+{
+  stats->depth = Stream_Head - Stream_Tail;
+  stats->capacity = CONFIG_STREAM_QUEUE_LENGTH;
+  stats->dropped = Stream_Dropped;
+}
@@ -0,0 +1,73 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_STREAM_H
+#define BME_READER_STREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+#include "sampler.h"
+
+/**
+ * @brief The sample streaming statistics structure.
+ */
+typedef struct Stream_Stats
+{
+  /**
+   * @brief The number of samples currently waiting for transmission.
+   */
+  uint32_t depth;
+
+  /**
+   * @brief The maximal number of samples the stream queue can hold.
+   */
+  uint32_t capacity;
+
+  /**
+   * @brief The number of samples dropped because the stream queue was full since the streaming start.
+   */
+  uint32_t dropped;
+} Stream_Stats;
+
+/**
+ * @brief The streamed sample structure.
+ */
+typedef struct Stream_Sample
+{
+  /**
+   * @brief The sample taken by the background sampler.
+   */
+  Sampler_Sample sample;
+
+  /**
+   * @brief The free-running streamed sample number. The numbers of the dropped samples are skipped.
+   */
+  uint32_t sequence;
+} Stream_Sample;
+
+uint32_t Stream_GetMaxRate();
+
+I2C_Result Stream_Start(uint32_t rate, bool isRaw);
+
+I2C_Result Stream_Stop();
+
+bool Stream_IsActive();
+
+bool Stream_IsRaw();
+
+void Stream_Put(const Sampler_Sample *sample);
+
+const Stream_Sample *Stream_Peek();
+
+void Stream_Pop();
+
+void Stream_GetStats(Stream_Stats *stats);
+
+#endif //BME_READER_STREAM_H
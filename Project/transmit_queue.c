@@ -0,0 +1,138 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#include <string.h>
+
+#include "transmit_queue.h"
+#include "main.h"
+#include "usbd_cdc_if.h"
+
+#if (CONFIG_TRANSMIT_BUFFER_SIZE & (CONFIG_TRANSMIT_BUFFER_SIZE - 1)) != 0
+#error "CONFIG_TRANSMIT_BUFFER_SIZE must be a power of two."
+#endif
+
+#if CONFIG_TRANSMIT_BUFFER_SIZE < CONFIG_MAX_RESPONSE_MESSAGE_LENGTH
+#error "CONFIG_TRANSMIT_BUFFER_SIZE must not be less than CONFIG_MAX_RESPONSE_MESSAGE_LENGTH."
+#endif
+
+/**
+ * @brief The ring buffer accumulating the data waiting for transmission.
+ */
+static uint8_t TransmitQueue_Buffer[CONFIG_TRANSMIT_BUFFER_SIZE];
+
+/**
+ * @brief The free-running count of bytes put to the buffer. Modified by the producer only.
+ */
+static volatile uint32_t TransmitQueue_Head = 0;
+
+/**
+ * @brief The free-running count of transmitted bytes. Modified on the transmission completion only.
+ */
+static volatile uint32_t TransmitQueue_Tail = 0;
+
+/**
+ * @brief The number of bytes being transmitted, or zero if the transmitter is idle.
+ */
+static volatile uint32_t TransmitQueue_PendingLength = 0;
+
+/**
+ * @brief Puts the data to the transmission buffer. This is the producer side of the queue, it must be called from a
+ *   single context (the main loop). The transmission is started by the <i>TransmitQueue_Kick</i> function, so that the
+ *   messages put in a row are coalesced into a single transfer.
+ * @param string A pointer to the data to be transmitted.
+ * @param length Length of the data.
+ * @return <i>true</i> if the data have been queued, or <i>false</i> if there is not enough free space in the buffer.
+ *   The data are never queued partially.
+ */
+bool TransmitQueue_Put(const char *string, uint16_t length)
+{
+  if (length > TransmitQueue_GetFreeSpace())
+    return false;
+
+  uint32_t head = TransmitQueue_Head;
+  uint32_t offset = head & (CONFIG_TRANSMIT_BUFFER_SIZE - 1);
+  uint32_t firstLength = CONFIG_TRANSMIT_BUFFER_SIZE - offset < length ? CONFIG_TRANSMIT_BUFFER_SIZE - offset : length;
+  memcpy(&TransmitQueue_Buffer[offset], string, firstLength);
+  memcpy(&TransmitQueue_Buffer[0], string + firstLength, length - firstLength);
+
+  __DMB();
+  TransmitQueue_Head = head + length;
+  return true;
+}
+
+/**
+ * @brief Gets the free space in the transmission buffer.
+ * @return The number of bytes that can be put to the buffer.
+ */
+uint32_t TransmitQueue_GetFreeSpace()
+{
+  return CONFIG_TRANSMIT_BUFFER_SIZE - (TransmitQueue_Head - TransmitQueue_Tail);
+}
+
+/**
+ * @brief Checks if all the queued data have been transmitted.
+ * @return <i>true</i> if the buffer is empty and the transmitter is idle, otherwise <i>false</i>.
+ */
+bool TransmitQueue_IsEmpty()
+{
+  return TransmitQueue_Head == TransmitQueue_Tail;
+}
+
+/**
+ * @brief Starts the transmission of the queued data if the transmitter is idle. Safe to call from any context.
+ * @remarks All the data up to the buffer end are passed in a single transfer, so the USB stack splits them into full
+ *   64-byte packets and terminates the transfer with a short or a zero-length packet.
+ */
+void TransmitQueue_Kick()
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  uint32_t tail = TransmitQueue_Tail;
+  uint32_t length = TransmitQueue_Head - tail;
+  if (TransmitQueue_PendingLength == 0 && length > 0)
+  {
+    uint32_t offset = tail & (CONFIG_TRANSMIT_BUFFER_SIZE - 1);
+    if (length > CONFIG_TRANSMIT_BUFFER_SIZE - offset)
+      length = CONFIG_TRANSMIT_BUFFER_SIZE - offset;
+
+    if (CDC_Transmit_FS(&TransmitQueue_Buffer[offset], (uint16_t) length) == USBD_OK)
+      TransmitQueue_PendingLength = length;
+  }
+
+  __set_PRIMASK(primask);
+}
+
+/**
+ * @brief Releases the transmitted data and starts the transmission of the next queued data. Must be called when the
+ *   USB CDC transmission is completed.
+ */
+void TransmitQueue_Completed()
+{
+  TransmitQueue_Tail += TransmitQueue_PendingLength;
+  TransmitQueue_PendingLength = 0;
+  TransmitQueue_Kick();
+}
+
+/**
+ * @brief Drops the queued data and the transfer in progress. Must be called when the USB CDC interface is initialized
+ *   or deinitialized (e.g. on a USB bus reset or a host reconnection), as the USB stack drops the transfer in progress
+ *   then without signaling its completion, so the transmitter would be considered busy forever.
+ * @note The producer owns the head count, so the queue is emptied by moving the tail count to it instead of clearing
+ *   both counts, which would corrupt a message being put by the interrupted main loop.
+ */
+void TransmitQueue_Reset()
+{
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+
+  TransmitQueue_Tail = TransmitQueue_Head;
+  TransmitQueue_PendingLength = 0;
+
+  __set_PRIMASK(primask);
+}
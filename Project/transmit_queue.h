@@ -0,0 +1,29 @@
+/**
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * Copyright © 2021 Maxim Yudin <stibiu@yandex.ru>
+ */
+
+#ifndef BME_READER_TRANSMIT_QUEUE_H
+#define BME_READER_TRANSMIT_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config.h"
+
+bool TransmitQueue_Put(const char *string, uint16_t length);
+
+uint32_t TransmitQueue_GetFreeSpace();
+
+bool TransmitQueue_IsEmpty();
+
+void TransmitQueue_Kick();
+
+void TransmitQueue_Completed();
+
+void TransmitQueue_Reset();
+
+#endif //BME_READER_TRANSMIT_QUEUE_H
@@ -156,6 +156,7 @@ static int8_t CDC_Init_FS(void)
   /* Set Application Buffers */
   USBD_CDC_SetTxBuffer(&hUsbDeviceFS, UserTxBufferFS, 0);
   USBD_CDC_SetRxBuffer(&hUsbDeviceFS, UserRxBufferFS);
+  TransmitQueue_Reset();
   return (USBD_OK);
   /* USER CODE END 3 */
 }
@@ -167,6 +168,7 @@ static int8_t CDC_Init_FS(void)
 static int8_t CDC_DeInit_FS(void)
 {
   /* USER CODE BEGIN 4 */
+  TransmitQueue_Reset();
   return (USBD_OK);
   /* USER CODE END 4 */
 }